@@ -0,0 +1,70 @@
+#include "bench.h"
+#include "../hstring.h"
+
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::Result;
+
+typedef basic_hstring<char, basic_hstring_core<slab_allocator>> slab_hstring;
+typedef basic_hstring<char, basic_hstring_core<malloc_allocator>> malloc_hstring;
+typedef basic_hstring<char, basic_hstring_core<pmr_allocator<>>> pmr_hstring;
+
+// 中字符串的拷贝/析构混合负载：每个线程维护一组字符串，不停地用模板字符串的拷贝替换掉其中一个
+template <class S>
+static Result churn(unsigned threads, size_t minLen, size_t maxLen)
+{
+    constexpr size_t kTemplates = 64;
+    constexpr size_t kSlots = 1024;
+    std::vector<S> templates;
+    std::mt19937 rng(7);
+    for (size_t i = 0; i < kTemplates; ++i)
+    {
+        auto const len = minLen + rng() % (maxLen - minLen + 1);
+        templates.emplace_back(S(len, char('a' + i % 26)));
+    }
+    return bench::measureThreads(threads, [&](unsigned tid, size_t iters) {
+        std::vector<S> slots(kSlots);
+        uint32_t x = 2463534242u + tid;
+        for (size_t i = 0; i < iters; ++i)
+        {
+            // xorshift，比mt19937便宜，不会干扰测量
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            slots[x % kSlots] = S(templates[(x >> 10) % kTemplates]);
+            doNotOptimize(slots[x % kSlots]);
+        }
+    });
+}
+
+static void row(const char *what, unsigned threads, size_t minLen, size_t maxLen)
+{
+    auto const name = std::string(what) + " len=" + std::to_string(minLen) + "-" + std::to_string(maxLen) + " x" + std::to_string(threads);
+    bench::printRow(name + " [slab]", churn<slab_hstring>(threads, minLen, maxLen));
+    bench::printRow(name + " [malloc]", churn<malloc_hstring>(threads, minLen, maxLen));
+    bench::printRow(name + " [pmr sync pool]", churn<pmr_hstring>(threads, minLen, maxLen));
+    bench::printRow(name + " [std::string]", churn<std::string>(threads, minLen, maxLen));
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    // pmr用线程安全的池，和slab的线程缓存对比
+    std::pmr::synchronized_pool_resource pool;
+    pmr_allocator<>::setResource(&pool);
+
+    bench::printHeader("copy/destroy churn");
+    for (unsigned threads : {1u, bench::options().threads})
+    {
+        row("churn", threads, 24, 254);
+        row("churn", threads, 24, 64);
+        row("churn", threads, 128, 254);
+    }
+    printf("\nslab reserved bytes: %zu\n", slab_allocator::reservedBytes());
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "bench.h"
+#include "../hstring.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+
+// 一个字符串一段一段append到10MB-1GB：比较默认的分配（malloc的realloc）和mmap_allocator（mremap扩容、可选透明大页）
+// 每次16KB，看吞吐和缺页次数。同一个用例连续跑几轮，报最后一轮：
+// glibc释放过mmap的大块以后会调高mmap阈值，后面几轮的malloc行为和第一轮不一样，稳定以后的才是长期运行的进程看到的
+typedef basic_hstring<char, basic_hstring_core<mmap_allocator<slab_allocator, size_t(1) << 20, true>>> huge_page_hstring;
+
+static const size_t kChunk = 16 * 1024;
+static const int kRounds = 3;
+
+static long minorFaults()
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_minflt;
+}
+
+template <class S>
+static void grow(const char *name, size_t total)
+{
+    auto const label = std::string(name) + " " + std::to_string(total >> 20) + "MB";
+    if (!bench::selected(label))
+    {
+        return;
+    }
+    std::vector<char> chunk(kChunk, 'x');
+    double seconds = 0;
+    long faults = 0;
+    for (int round = 0; round < kRounds; ++round)
+    {
+        auto const faultsBefore = minorFaults();
+        auto const start = std::chrono::steady_clock::now();
+        {
+            S s;
+            for (size_t done = 0; done < total; done += kChunk)
+            {
+                s.append(chunk.data(), kChunk);
+            }
+            doNotOptimize(std::as_const(s).data());
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        faults = minorFaults() - faultsBefore;
+    }
+    auto const mb = double(total) / 1048576.0;
+    printf("%-34s | %10.0f | %10.2f | %12ld | %10.1f\n", label.c_str(), mb / seconds, seconds * 1e3, faults,
+           double(faults) / mb);
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    printf("\n== append %zuKB at a time until the string reaches the target size (last of %d rounds) ==\n",
+           kChunk / 1024, kRounds);
+    printf("%-34s | %10s | %10s | %12s | %10s\n", "case", "MB/s", "ms", "minor faults", "faults/MB");
+    for (size_t total : {size_t(10) << 20, size_t(100) << 20, size_t(1) << 30})
+    {
+        grow<hstring>("hstring (malloc)", total);
+        grow<mmap_hstring>("mmap_hstring (mremap)", total);
+        grow<huge_page_hstring>("mmap_allocator + hugepages", total);
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "bench.h"
+#include "../hascii.h"
+
+#include <string>
+#include <vector>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::measure;
+
+static const hsearch::Level kLevels[] = {hsearch::Level::Scalar, hsearch::Level::SSE2, hsearch::Level::AVX2};
+
+// 大部分已经是小写的HTTP头名字，少数是首字母大写的写法
+static std::vector<hstring> headerNames()
+{
+    static const char *const kNames[] = {"content-type", "accept", "x-request-id", "user-agent", "accept-encoding",
+                                         "cache-control", "Content-Length", "host", "x-forwarded-for", "authorization"};
+    std::vector<hstring> out;
+    for (size_t i = 0; i < 1024; ++i)
+    {
+        out.emplace_back(kNames[i % 10]);
+    }
+    return out;
+}
+
+// 原来的写法：逐个字节构造一个新字符串
+static hstring lowerCopy(const hstring &s)
+{
+    hstring out;
+    out.reserve(s.size());
+    for (char c : std::string_view(s))
+    {
+        out.push_back((c >= 'A' && c <= 'Z') ? char(c + 32) : c);
+    }
+    return out;
+}
+
+// 原来的原地写法：直接拿可写的指针，共享的大字符串一定会被复制
+static void lowerMutable(hstring &s)
+{
+    auto const p = s.data();
+    for (size_t i = 0; i < s.size(); ++i)
+    {
+        p[i] = (p[i] >= 'A' && p[i] <= 'Z') ? char(p[i] + 32) : p[i];
+    }
+}
+
+static void run(const char *what, const std::vector<hstring> &pool)
+{
+    auto const n = pool.size();
+    bench::printRow(std::string(what) + " copy loop", measure([&](size_t iters) {
+                        for (size_t i = 0; i < iters; ++i)
+                        {
+                            auto const out = lowerCopy(pool[i % n]);
+                            doNotOptimize(out);
+                        }
+                    }));
+    bench::printRow(std::string(what) + " data() loop", measure([&](size_t iters) {
+                        for (size_t i = 0; i < iters; ++i)
+                        {
+                            hstring s(pool[i % n]);
+                            lowerMutable(s);
+                            doNotOptimize(s);
+                        }
+                    }));
+    for (auto lv : kLevels)
+    {
+        hascii::setLevel(lv);
+        if (hascii::level() != lv)
+        {
+            continue;
+        }
+        bench::printRow(std::string(what) + " to_lower [" + hsearch::levelName(lv) + "]", measure([&](size_t iters) {
+                            for (size_t i = 0; i < iters; ++i)
+                            {
+                                hstring s(pool[i % n]);
+                                to_lower(s);
+                                doNotOptimize(s);
+                            }
+                        }));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    if (bench::selected("headers"))
+    {
+        bench::printHeader("headers: short names, 10% need lowercasing");
+        run("headers", headerNames());
+    }
+    if (bench::selected("shared"))
+    {
+        // 缓存里共享的大字符串，已经全是小写
+        bench::printHeader("shared: 4KB lowercase values, copied from a shared pool");
+        std::vector<hstring> pool;
+        for (size_t i = 0; i < 64; ++i)
+        {
+            pool.emplace_back(4096, char('a' + i % 26));
+        }
+        run("shared 4KB", pool);
+    }
+    if (bench::selected("trim"))
+    {
+        bench::printHeader("trim");
+        const hstring header("  application/json; charset=utf-8 \r\n");
+        bench::printRow("trim header", measure([&](size_t iters) {
+                            for (size_t i = 0; i < iters; ++i)
+                            {
+                                hstring s(header);
+                                trim(s);
+                                doNotOptimize(s);
+                            }
+                        }));
+        const hstring body = hstring(" ") + hstring(4096, 'b') + hstring("\n");
+        bench::printRow("trim shared 4KB", measure([&](size_t iters) {
+                            for (size_t i = 0; i < iters; ++i)
+                            {
+                                hstring s(body);
+                                trim(s);
+                                doNotOptimize(s);
+                            }
+                        }));
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include "bench.h"
+#include "../hstring.h"
+
+#include <string>
+#include <vector>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::measure;
+using fool::bench::Result;
+
+// 循环里反复给同一个字符串赋值，比如解析时复用的字段缓冲区
+// 来源的长度在[len/2, len]之间变化，目标已经有足够的容量时不应该再分配
+static const size_t kLengths[] = {16, 40, 100, 200, 254, 400, 1024, 16384};
+static const size_t kSources = 64;
+
+template <class S>
+static std::vector<S> sources(size_t len)
+{
+    std::vector<S> out;
+    for (size_t i = 0; i < kSources; ++i)
+    {
+        auto const n = len / 2 + (len / 2) * i / (kSources - 1);
+        out.emplace_back(n, char('a' + i % 26));
+    }
+    return out;
+}
+
+template <class S>
+static Result copyAssign(size_t len)
+{
+    auto const src = sources<S>(len);
+    S dst;
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            dst = src[i % kSources];
+            doNotOptimize(dst);
+        }
+    });
+}
+
+template <class S>
+static Result assignChars(size_t len)
+{
+    auto const src = sources<std::string>(len);
+    S dst;
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            auto const &s = src[i % kSources];
+            dst.assign(s.data(), s.size());
+            doNotOptimize(dst);
+        }
+    });
+}
+
+template <class S>
+static Result moveAssign(size_t len)
+{
+    auto const src = sources<S>(len);
+    S dst;
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            S tmp(src[i % kSources]);
+            dst = std::move(tmp);
+            doNotOptimize(dst);
+        }
+    });
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    struct Case
+    {
+        const char *name;
+        Result (*h)(size_t);
+        Result (*s)(size_t);
+    };
+    const Case cases[] = {
+        {"operator=(const&)", copyAssign<hstring>, copyAssign<std::string>},
+        {"assign(const char*, n)", assignChars<hstring>, assignChars<std::string>},
+        {"copy+operator=(&&)", moveAssign<hstring>, moveAssign<std::string>},
+    };
+    for (auto const &c : cases)
+    {
+        if (!bench::selected(c.name))
+        {
+            continue;
+        }
+        bench::printHeader(c.name, "hstring", "std::string");
+        for (size_t len : kLengths)
+        {
+            bench::printRow(std::string(c.name) + " len<=" + std::to_string(len), c.h(len), c.s(len));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "bench.h"
+#include "../hatomic.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::measureThreads;
+
+// 读多写少的发布：N个线程不停地读当前值的几个字节，另一个线程每隔一会儿发布一个新值
+// 对照是互斥锁保护的std::string，读者加锁、读、解锁
+static const size_t kValueSize = 4096;
+
+static std::string makeValue(size_t v)
+{
+    return std::string(kValueSize, char('a' + v % 26));
+}
+
+// 后台的写者，析构时停下
+class Writer
+{
+public:
+    template <class F>
+    explicit Writer(F publish)
+        : thread_([this, publish] {
+              for (size_t v = 1; !stop_.load(std::memory_order_relaxed); ++v)
+              {
+                  publish(v);
+                  std::this_thread::sleep_for(std::chrono::microseconds(100));
+              }
+          })
+    {
+    }
+    ~Writer()
+    {
+        stop_ = true;
+        thread_.join();
+    }
+
+private:
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+static void run(unsigned threads)
+{
+    auto const suffix = " threads=" + std::to_string(threads);
+
+    {
+        std::mutex mu;
+        std::string value = makeValue(0);
+        Writer writer([&](size_t v) {
+            auto fresh = makeValue(v);
+            std::lock_guard<std::mutex> lock(mu);
+            value.swap(fresh);
+        });
+        bench::printRow("mutex std::string" + suffix, measureThreads(threads, [&](unsigned t, size_t iters) {
+                            for (size_t i = 0; i < iters; ++i)
+                            {
+                                std::lock_guard<std::mutex> lock(mu);
+                                doNotOptimize(value[(i + t) % kValueSize]);
+                            }
+                        }));
+    }
+    {
+        atomic_hstring value(hstring(makeValue(0)));
+        Writer writer([&](size_t v) { value.store(hstring(makeValue(v))); });
+        bench::printRow("atomic_hstring load" + suffix, measureThreads(threads, [&](unsigned t, size_t iters) {
+                            for (size_t i = 0; i < iters; ++i)
+                            {
+                                auto const s = value.load();
+                                doNotOptimize(s[(i + t) % kValueSize]);
+                            }
+                        }));
+        bench::printRow("atomic_hstring visit" + suffix, measureThreads(threads, [&](unsigned t, size_t iters) {
+                            for (size_t i = 0; i < iters; ++i)
+                            {
+                                value.visit([&](const hstring &s) { doNotOptimize(s[(i + t) % kValueSize]); });
+                            }
+                        }));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    bench::printHeader("read-mostly publication, 4KB value");
+    for (unsigned threads : {1u, 8u, 32u})
+    {
+        if (bench::selected("threads=" + std::to_string(threads)))
+        {
+            run(threads);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,214 @@
+#ifndef HXMMXH_BENCH_H
+#define HXMMXH_BENCH_H
+
+// 自带的微基准测试框架，不依赖第三方库
+// 每个用例给出 ns/op、allocs/op、bytes/op，分配次数由bench_malloc.cpp里替换的malloc统计
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fool
+{
+    namespace bench
+    {
+        struct AllocStats
+        {
+            uint64_t allocs;
+            uint64_t bytes;
+        };
+        // 当前线程到目前为止的分配统计
+        AllocStats threadAllocStats();
+
+        struct Result
+        {
+            double nsPerOp = 0;
+            double allocsPerOp = 0;
+            double bytesPerOp = 0;
+        };
+
+        struct Options
+        {
+            // 每个用例至少跑多少毫秒
+            double minMillis = 50;
+            // 多线程用例的线程数
+            unsigned threads = std::max(2u, std::thread::hardware_concurrency());
+            // 只跑名字里包含filter的用例
+            const char *filter = nullptr;
+        };
+
+        inline Options &options()
+        {
+            static Options opts;
+            return opts;
+        }
+
+        // 解析 --time=ms --threads=N --filter=str
+        inline void init(int argc, char **argv)
+        {
+            auto &opts = options();
+            for (int i = 1; i < argc; ++i)
+            {
+                if (strncmp(argv[i], "--time=", 7) == 0)
+                {
+                    opts.minMillis = atof(argv[i] + 7);
+                }
+                else if (strncmp(argv[i], "--threads=", 10) == 0)
+                {
+                    opts.threads = unsigned(atoi(argv[i] + 10));
+                }
+                else if (strncmp(argv[i], "--filter=", 9) == 0)
+                {
+                    opts.filter = argv[i] + 9;
+                }
+                else
+                {
+                    fprintf(stderr, "usage: %s [--time=ms] [--threads=N] [--filter=str]\n", argv[0]);
+                    exit(1);
+                }
+            }
+        }
+
+        inline bool selected(const std::string &name)
+        {
+            return options().filter == nullptr || name.find(options().filter) != std::string::npos;
+        }
+
+        // 阻止编译器把结果优化掉
+        template <class T>
+        inline void doNotOptimize(const T &value)
+        {
+            asm volatile(""
+                         :
+                         : "r,m"(value)
+                         : "memory");
+        }
+
+        inline void clobber()
+        {
+            asm volatile(""
+                         :
+                         :
+                         : "memory");
+        }
+
+        // f(iters)执行iters次操作，自动加倍迭代次数直到运行时间超过minMillis
+        template <class F>
+        Result measure(F &&f)
+        {
+            typedef std::chrono::steady_clock clock;
+            size_t iters = 1;
+            for (;;)
+            {
+                auto const before = threadAllocStats();
+                auto const start = clock::now();
+                f(iters);
+                auto const elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+                auto const after = threadAllocStats();
+                if (elapsed >= options().minMillis * 1e6 || iters >= (size_t(1) << 40))
+                {
+                    Result r;
+                    r.nsPerOp = elapsed / iters;
+                    r.allocsPerOp = double(after.allocs - before.allocs) / iters;
+                    r.bytesPerOp = double(after.bytes - before.bytes) / iters;
+                    return r;
+                }
+                // 按已经跑出的速度估算下一轮的次数，最多放大10倍
+                auto const target = options().minMillis * 1e6 * 1.2;
+                auto const scale = elapsed > 0 ? std::min(10.0, target / elapsed) : 10.0;
+                iters = std::max(iters * 2, size_t(iters * scale));
+            }
+        }
+
+        // n个线程同时执行f(tid, iters)，ns/op按所有线程的总操作数平摊
+        template <class F>
+        Result measureThreads(unsigned n, F &&f)
+        {
+            typedef std::chrono::steady_clock clock;
+            size_t iters = 1;
+            for (;;)
+            {
+                std::atomic<unsigned> ready(0);
+                std::atomic<bool> go(false);
+                std::vector<AllocStats> deltas(n);
+                std::vector<std::thread> threads;
+                for (unsigned t = 0; t < n; ++t)
+                {
+                    threads.emplace_back([&, t] {
+                        ready.fetch_add(1);
+                        while (!go.load(std::memory_order_acquire))
+                        {
+                        }
+                        auto const before = threadAllocStats();
+                        f(t, iters);
+                        auto const after = threadAllocStats();
+                        deltas[t] = AllocStats{after.allocs - before.allocs, after.bytes - before.bytes};
+                    });
+                }
+                while (ready.load() != n)
+                {
+                }
+                auto const start = clock::now();
+                go.store(true, std::memory_order_release);
+                for (auto &th : threads)
+                {
+                    th.join();
+                }
+                auto const elapsed = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+                if (elapsed >= options().minMillis * 1e6 || iters >= (size_t(1) << 40))
+                {
+                    Result r;
+                    auto const ops = double(iters) * n;
+                    r.nsPerOp = elapsed / ops;
+                    for (auto const &d : deltas)
+                    {
+                        r.allocsPerOp += double(d.allocs) / ops;
+                        r.bytesPerOp += double(d.bytes) / ops;
+                    }
+                    return r;
+                }
+                auto const target = options().minMillis * 1e6 * 1.2;
+                auto const scale = elapsed > 0 ? std::min(10.0, target / elapsed) : 10.0;
+                iters = std::max(iters * 2, size_t(iters * scale));
+            }
+        }
+
+        // 两列对比的表头，lhs/rhs是两边实现的名字
+        inline void printHeader(const char *title, const char *lhs, const char *rhs)
+        {
+            printf("\n== %s ==\n", title);
+            printf("%-44s | %-30s | %-30s | %s\n", "case", lhs, rhs, "speedup");
+            printf("%-44s | %10s %8s %10s | %10s %8s %10s |\n", "", "ns/op", "allocs", "bytes", "ns/op", "allocs", "bytes");
+        }
+
+        inline void printRow(const std::string &name, const Result &lhs, const Result &rhs)
+        {
+            printf("%-44s | %10.2f %8.2f %10.1f | %10.2f %8.2f %10.1f | %6.2fx\n",
+                   name.c_str(),
+                   lhs.nsPerOp, lhs.allocsPerOp, lhs.bytesPerOp,
+                   rhs.nsPerOp, rhs.allocsPerOp, rhs.bytesPerOp,
+                   lhs.nsPerOp > 0 ? rhs.nsPerOp / lhs.nsPerOp : 0.0);
+        }
+
+        // 单列的表头和行，用于没有对照组的用例
+        inline void printHeader(const char *title)
+        {
+            printf("\n== %s ==\n", title);
+            printf("%-44s | %10s %8s %10s\n", "case", "ns/op", "allocs", "bytes");
+        }
+
+        inline void printRow(const std::string &name, const Result &r)
+        {
+            printf("%-44s | %10.2f %8.2f %10.1f\n", name.c_str(), r.nsPerOp, r.allocsPerOp, r.bytesPerOp);
+        }
+    }
+}
+
+#endif
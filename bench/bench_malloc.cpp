@@ -0,0 +1,54 @@
+#include "bench.h"
+
+#include <cstddef>
+
+// 在可执行文件里重新定义malloc族函数，转调glibc真正的实现，顺便统计分配次数和字节数
+// std::string走operator new最终也会到malloc，所以两边的统计口径一致
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t n, size_t size);
+    void *__libc_realloc(void *p, size_t size);
+    void __libc_free(void *p);
+}
+
+namespace
+{
+    // 每个线程自己计数，多线程测试时不会因为统计本身产生竞争
+    __thread uint64_t tAllocs __attribute__((tls_model("initial-exec")));
+    __thread uint64_t tBytes __attribute__((tls_model("initial-exec")));
+}
+
+extern "C"
+{
+    void *malloc(size_t size)
+    {
+        ++tAllocs;
+        tBytes += size;
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t n, size_t size)
+    {
+        ++tAllocs;
+        tBytes += n * size;
+        return __libc_calloc(n, size);
+    }
+
+    void *realloc(void *p, size_t size)
+    {
+        ++tAllocs;
+        tBytes += size;
+        return __libc_realloc(p, size);
+    }
+
+    void free(void *p)
+    {
+        __libc_free(p);
+    }
+}
+
+fool::bench::AllocStats fool::bench::threadAllocStats()
+{
+    return AllocStats{tAllocs, tBytes};
+}
@@ -0,0 +1,98 @@
+#include "bench.h"
+#include "../hstring.h"
+
+#include <chrono>
+#include <cstdio>
+#include <malloc.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+
+// 长期保存的缓存经历一阵大的值：每个值先涨到几KB，再缩回几十字节
+// 看缩回去以后堆上还占着多少，compact()和自动收缩各能还回去多少
+typedef basic_hstring<char, basic_hstring_core<slab_allocator, atomic_refcount, compacting_hstring_traits>> compacting_hstring;
+
+static const size_t kEntries = 100000;
+
+// malloc正在使用的字节数，slab从malloc申请，也算在里面
+static double heapMB()
+{
+    auto const mi = mallinfo2();
+    return double(mi.uordblks + mi.hblkhd) / 1048576.0;
+}
+
+static double rssMB()
+{
+    auto const f = fopen("/proc/self/statm", "r");
+    long pages = 0, resident = 0;
+    if (f != nullptr)
+    {
+        if (fscanf(f, "%ld %ld", &pages, &resident) != 2)
+        {
+            resident = 0;
+        }
+        fclose(f);
+    }
+    return double(resident) * double(sysconf(_SC_PAGESIZE)) / 1048576.0;
+}
+
+template <class S>
+static void churn(const char *name, bool bulk)
+{
+    if (!bench::selected(name))
+    {
+        return;
+    }
+    double spike, after, compacted;
+    double nsPerString = 0;
+    {
+        std::vector<S> cache(kEntries);
+        uint64_t x = 1;
+        for (size_t i = 0; i < kEntries; ++i)
+        {
+            x = x * 6364136223846793005ull + 1442695040888963407ull;
+            cache[i].assign(40 + (x >> 33) % 40, char('a' + i % 26));
+        }
+        auto const filled = heapMB();
+        // 高峰：每个值追加到2-8KB
+        for (size_t i = 0; i < kEntries; ++i)
+        {
+            x = x * 6364136223846793005ull + 1442695040888963407ull;
+            cache[i].append(2048 + (x >> 33) % 6144, 'z');
+        }
+        spike = heapMB() - filled;
+        // 高峰过去，值回到原来的长度
+        for (size_t i = 0; i < kEntries; ++i)
+        {
+            x = x * 6364136223846793005ull + 1442695040888963407ull;
+            cache[i].resize(40 + (x >> 33) % 40);
+        }
+        after = heapMB() - filled;
+        compacted = after;
+        if (bulk)
+        {
+            auto const start = std::chrono::steady_clock::now();
+            doNotOptimize(compact(cache));
+            nsPerString = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kEntries;
+            compacted = heapMB() - filled;
+        }
+        malloc_trim(0);
+        printf("%-32s | %10.1f | %10.1f | %10.1f | %10.1f | %8.1f\n", name, spike, after, compacted, rssMB(),
+               nsPerString);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    printf("\n== cache churn: %zu values, 40-80B -> 2-8KB -> 40-80B ==\n", kEntries);
+    printf("heap MB above the filled cache; RSS after malloc_trim; ns/string for compact()\n");
+    printf("%-32s | %10s | %10s | %10s | %10s | %8s\n", "case", "spike", "shrunk", "compacted", "RSS", "ns/str");
+    churn<hstring>("hstring (no compaction)", false);
+    churn<hstring>("hstring + compact()", true);
+    churn<compacting_hstring>("compacting_hstring_traits", false);
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "bench.h"
+#include "../hconcat.h"
+
+#include <string>
+#include <vector>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::measure;
+using fool::bench::Result;
+
+// 拼接缓存的键 tenant:shard:id，三种总长度分别落在小、中、大字符串
+struct KeyShape
+{
+    const char *name;
+    size_t tenantLen;
+    size_t shardLen;
+};
+
+static const KeyShape kShapes[] = {
+    {"key small", 6, 4},
+    {"key medium", 40, 60},
+    {"key large", 300, 200},
+};
+
+static Result chainedPlus(const hstring &tenant, const hstring &shard)
+{
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            hstring key = tenant + ":" + shard + ":" + hstring(std::to_string(i).c_str());
+            doNotOptimize(key);
+        }
+    });
+}
+
+static Result concat(const hstring &tenant, const hstring &shard)
+{
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            auto key = hconcat(tenant, ':', shard, ':', i);
+            doNotOptimize(key);
+        }
+    });
+}
+
+static Result stdPlus(const std::string &tenant, const std::string &shard)
+{
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            std::string key = tenant + ":" + shard + ":" + std::to_string(i);
+            doNotOptimize(key);
+        }
+    });
+}
+
+static Result joinFields(const std::vector<hstring> &fields)
+{
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            auto line = hjoin(fields, ',');
+            doNotOptimize(line);
+        }
+    });
+}
+
+static Result appendFields(const std::vector<hstring> &fields)
+{
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            hstring line;
+            for (size_t k = 0; k < fields.size(); ++k)
+            {
+                if (k > 0)
+                {
+                    line += ',';
+                }
+                line += fields[k];
+            }
+            doNotOptimize(line);
+        }
+    });
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    if (bench::selected("concat"))
+    {
+        bench::printHeader("concat tenant:shard:id", "hconcat", "chained operator+");
+        for (auto const &s : kShapes)
+        {
+            hstring tenant(s.tenantLen, 't'), shard(s.shardLen, 's');
+            bench::printRow(s.name, concat(tenant, shard), chainedPlus(tenant, shard));
+        }
+        bench::printHeader("concat tenant:shard:id", "hconcat", "std::string operator+");
+        for (auto const &s : kShapes)
+        {
+            hstring tenant(s.tenantLen, 't'), shard(s.shardLen, 's');
+            bench::printRow(s.name, concat(tenant, shard),
+                            stdPlus(std::string(s.tenantLen, 't'), std::string(s.shardLen, 's')));
+        }
+    }
+    if (bench::selected("join"))
+    {
+        bench::printHeader("join CSV line", "hjoin", "append loop");
+        for (size_t n : {4, 16, 64})
+        {
+            std::vector<hstring> fields;
+            for (size_t k = 0; k < n; ++k)
+            {
+                fields.emplace_back(8 + k % 16, char('a' + k % 26));
+            }
+            auto const name = "join fields=" + std::to_string(n);
+            bench::printRow(name, joinFields(fields), appendFields(fields));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include "bench.h"
+#include "../hconv.h"
+
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::measure;
+using fool::bench::Result;
+
+// 日志和指标的编码：往一行里不停地追加数字，每写满一行清空一次
+static const size_t kLine = 4096;
+
+static std::vector<int64_t> makeInts(int64_t magnitude)
+{
+    std::vector<int64_t> out;
+    uint64_t x = 88172645463325252ull;
+    for (size_t i = 0; i < 1024; ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        auto const v = int64_t(x % uint64_t(magnitude));
+        out.push_back(i % 3 == 0 ? -v : v);
+    }
+    return out;
+}
+
+static std::vector<double> makeDoubles()
+{
+    std::vector<double> out;
+    uint64_t x = 88172645463325252ull;
+    for (size_t i = 0; i < 1024; ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        // 一半是像延迟这样的短小数，一半是随机的完整精度
+        out.push_back(i % 2 ? double(x % 100000) / 100 : double(x >> 11) / double(1ull << 40));
+    }
+    return out;
+}
+
+template <class F>
+static Result encode(F &&f)
+{
+    hstring line;
+    line.reserve(kLine + 64);
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            if (line.size() > kLine)
+            {
+                line.clear();
+            }
+            f(line, i % 1024);
+            line.push_back(' ');
+        }
+        doNotOptimize(line);
+    });
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    if (bench::selected("int"))
+    {
+        bench::printHeader("format int");
+        for (int64_t magnitude : {int64_t(100), int64_t(1000000), INT64_MAX})
+        {
+            auto const ints = makeInts(magnitude);
+            auto const suffix = " |v|<" + std::to_string(magnitude);
+            bench::printRow("append_int" + suffix, encode([&](hstring &s, size_t i) { append_int(s, ints[i]); }));
+            bench::printRow("std::to_chars+append" + suffix, encode([&](hstring &s, size_t i) {
+                                char buf[24];
+                                auto const r = std::to_chars(buf, buf + sizeof(buf), ints[i]);
+                                s.append(buf, size_t(r.ptr - buf));
+                            }));
+            bench::printRow("snprintf+append" + suffix, encode([&](hstring &s, size_t i) {
+                                char buf[24];
+                                auto const n = snprintf(buf, sizeof(buf), "%lld", (long long)ints[i]);
+                                s.append(buf, size_t(n));
+                            }));
+        }
+    }
+    if (bench::selected("double"))
+    {
+        bench::printHeader("format double");
+        auto const doubles = makeDoubles();
+        bench::printRow("append_double", encode([&](hstring &s, size_t i) { append_double(s, doubles[i]); }));
+        bench::printRow("std::to_chars+append", encode([&](hstring &s, size_t i) {
+                            char buf[32];
+                            auto const r = std::to_chars(buf, buf + sizeof(buf), doubles[i]);
+                            s.append(buf, size_t(r.ptr - buf));
+                        }));
+        // %.17g才能保证读回来相等，但往往比最短表示长
+        bench::printRow("snprintf %.17g+append", encode([&](hstring &s, size_t i) {
+                            char buf[32];
+                            auto const n = snprintf(buf, sizeof(buf), "%.17g", doubles[i]);
+                            s.append(buf, size_t(n));
+                        }));
+    }
+    if (bench::selected("parse"))
+    {
+        bench::printHeader("parse");
+        std::vector<hstring> ints, doubles;
+        for (auto v : makeInts(INT64_MAX))
+        {
+            ints.push_back(to_hstring(v));
+        }
+        for (auto v : makeDoubles())
+        {
+            doubles.push_back(to_hstring(v));
+        }
+        auto run = [](const std::vector<hstring> &in, auto &&f) {
+            return measure([&](size_t iters) {
+                for (size_t i = 0; i < iters; ++i)
+                {
+                    doNotOptimize(f(in[i % in.size()]));
+                }
+            });
+        };
+        bench::printRow("parse_int", run(ints, [](const hstring &s) { return parse_int(s); }));
+        bench::printRow("strtoll", run(ints, [](const hstring &s) { return strtoll(s.c_str(), nullptr, 10); }));
+        bench::printRow("parse_double", run(doubles, [](const hstring &s) { return parse_double(s); }));
+        bench::printRow("strtod", run(doubles, [](const hstring &s) { return strtod(s.c_str(), nullptr); }));
+    }
+    return 0;
+}
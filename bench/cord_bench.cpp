@@ -0,0 +1,115 @@
+#include "bench.h"
+#include "../hcord.h"
+
+#include <string>
+#include <vector>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::measure;
+using fool::bench::Result;
+
+// 模拟拼一个HTTP响应：若干个短的头部片段，中间夹着已经存在的大块正文（模板、缓存的文件内容）
+struct Response
+{
+    std::vector<hstring> headers;
+    std::vector<hstring> bodies;
+};
+
+static Response makeResponse(size_t parts, size_t bodySize)
+{
+    Response r;
+    for (size_t i = 0; i < parts; ++i)
+    {
+        r.headers.push_back(hstring("X-Header-" + std::to_string(i) + ": some-value\r\n"));
+        r.bodies.push_back(hstring(bodySize, char('a' + i % 26)));
+    }
+    return r;
+}
+
+template <class Sink>
+static void assemble(const Response &r, Sink &&sink)
+{
+    for (size_t i = 0; i < r.headers.size(); ++i)
+    {
+        sink(r.headers[i]);
+        sink(r.bodies[i]);
+    }
+}
+
+static Result cordOnly(const Response &r)
+{
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            hcord c;
+            assemble(r, [&](const hstring &s) { c.append(s); });
+            doNotOptimize(c);
+        }
+    });
+}
+
+static Result cordFlatten(const Response &r)
+{
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            hcord c;
+            assemble(r, [&](const hstring &s) { c.append(s); });
+            auto const s = c.toString();
+            doNotOptimize(s);
+        }
+    });
+}
+
+static Result hstringAppend(const Response &r)
+{
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            hstring out;
+            assemble(r, [&](const hstring &s) { out.append(s); });
+            doNotOptimize(out);
+        }
+    });
+}
+
+static Result hstringPushBack(const Response &r)
+{
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            hstring out;
+            assemble(r, [&](const hstring &s) {
+                for (char ch : s)
+                {
+                    out.push_back(ch);
+                }
+            });
+            doNotOptimize(out);
+        }
+    });
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    if (!bench::selected("assemble"))
+    {
+        return 0;
+    }
+    bench::printHeader("assemble");
+    for (size_t parts : {8, 32})
+    {
+        for (size_t bodySize : {1024, 16384, 262144})
+        {
+            auto const r = makeResponse(parts, bodySize);
+            auto const name = "parts=" + std::to_string(parts) + " body=" + std::to_string(bodySize);
+            bench::printRow(name + " [hcord]", cordOnly(r));
+            bench::printRow(name + " [hcord+toString]", cordFlatten(r));
+            bench::printRow(name + " [hstring append]", hstringAppend(r));
+            bench::printRow(name + " [hstring push_back]", hstringPushBack(r));
+        }
+    }
+    return 0;
+}
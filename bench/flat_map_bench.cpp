@@ -0,0 +1,152 @@
+#include "bench.h"
+#include "../hflat_map.h"
+
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::measure;
+
+// 路由表和会话表：大部分键是放得进小字符串的会话号，另有一组几百字节的URL作为大字符串的键
+// 查找的键是表里那个键的拷贝（hstring共享同一块内存，std::string各自一份）
+
+static std::vector<std::string> sessionKeys(size_t n, uint64_t seed)
+{
+    std::vector<std::string> out;
+    out.reserve(n);
+    char buf[32];
+    uint64_t x = seed;
+    for (size_t i = 0; i < n; ++i)
+    {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        snprintf(buf, sizeof(buf), "sess:%016llx", static_cast<unsigned long long>(x));
+        out.emplace_back(buf);
+    }
+    return out;
+}
+
+static std::vector<std::string> urlKeys(size_t n)
+{
+    std::vector<std::string> out;
+    out.reserve(n);
+    const std::string prefix = "https://example.com/api/v2/tenants/acme/projects/" + std::string(300, 'p') + "/objects/";
+    for (size_t i = 0; i < n; ++i)
+    {
+        out.push_back(prefix + std::to_string(i * 2654435761u));
+    }
+    return out;
+}
+
+static void run(const char *what, const std::vector<std::string> &keys, const std::vector<std::string> &misses)
+{
+    auto const n = keys.size();
+    auto const prefix = std::string(what) + " n=" + (n >= 1000000 ? std::to_string(n / 1000000) + "M" : std::to_string(n / 1000) + "K");
+
+    std::vector<hstring> hkeys;
+    hkeys.reserve(n);
+    for (auto const &k : keys)
+    {
+        hkeys.emplace_back(k.data(), k.size());
+    }
+
+    bench::printRow(prefix + " build flat", measure([&](size_t iters) {
+                        flat_hstring_map<uint64_t> m;
+                        for (size_t i = 0; i < iters; ++i)
+                        {
+                            if (m.size() == n)
+                            {
+                                flat_hstring_map<uint64_t>().swap(m);
+                            }
+                            m.try_emplace(hkeys[i % n], i);
+                        }
+                        doNotOptimize(m);
+                    }));
+    bench::printRow(prefix + " build std", measure([&](size_t iters) {
+                        std::unordered_map<std::string, uint64_t> m;
+                        for (size_t i = 0; i < iters; ++i)
+                        {
+                            if (m.size() == n)
+                            {
+                                std::unordered_map<std::string, uint64_t>().swap(m);
+                            }
+                            m.emplace(keys[i % n], i);
+                        }
+                        doNotOptimize(m);
+                    }));
+
+    flat_hstring_map<uint64_t> flat;
+    std::unordered_map<std::string, uint64_t> std_;
+    for (size_t i = 0; i < n; ++i)
+    {
+        flat.try_emplace(hkeys[i], i);
+        std_.emplace(keys[i], i);
+    }
+    // 打乱查找顺序，大表上两边都要付出缓存不命中的代价
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        order[i] = (i * 2654435761u) % n;
+    }
+
+    bench::printRow(prefix + " find hit flat(hstring)", measure([&](size_t iters) {
+                        for (size_t i = 0; i < iters; ++i)
+                        {
+                            doNotOptimize(flat.find(hkeys[order[i % n]])->second);
+                        }
+                    }));
+    bench::printRow(prefix + " find hit flat(string_view)", measure([&](size_t iters) {
+                        for (size_t i = 0; i < iters; ++i)
+                        {
+                            doNotOptimize(flat.find(std::string_view(keys[order[i % n]]))->second);
+                        }
+                    }));
+    bench::printRow(prefix + " find hit std", measure([&](size_t iters) {
+                        for (size_t i = 0; i < iters; ++i)
+                        {
+                            doNotOptimize(std_.find(keys[order[i % n]])->second);
+                        }
+                    }));
+    auto const m = misses.size();
+    bench::printRow(prefix + " find miss flat", measure([&](size_t iters) {
+                        for (size_t i = 0; i < iters; ++i)
+                        {
+                            doNotOptimize(flat.find(std::string_view(misses[i % m])) == flat.end());
+                        }
+                    }));
+    bench::printRow(prefix + " find miss std", measure([&](size_t iters) {
+                        for (size_t i = 0; i < iters; ++i)
+                        {
+                            doNotOptimize(std_.find(misses[i % m]) == std_.end());
+                        }
+                    }));
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    bench::printHeader("flat_hstring_map vs std::unordered_map");
+    for (size_t n : {size_t(1000), size_t(100000), size_t(1000000), size_t(10000000)})
+    {
+        auto const tag = n >= 1000000 ? std::to_string(n / 1000000) + "M" : std::to_string(n / 1000) + "K";
+        // 1000万个键占好几GB，只有用--filter明确选中时才跑
+        if (!bench::selected("sessions n=" + tag) || (n >= 10000000 && bench::options().filter == nullptr))
+        {
+            continue;
+        }
+        run("sessions", sessionKeys(n, 1), sessionKeys(std::min<size_t>(n, 100000), 2));
+    }
+    for (size_t n : {size_t(1000), size_t(100000)})
+    {
+        auto const tag = std::to_string(n / 1000) + "K";
+        if (!bench::selected("urls n=" + tag))
+        {
+            continue;
+        }
+        auto const keys = urlKeys(2 * n);
+        run("urls", std::vector<std::string>(keys.begin(), keys.begin() + n), std::vector<std::string>(keys.begin() + n, keys.end()));
+    }
+    return 0;
+}
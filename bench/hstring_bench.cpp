@@ -0,0 +1,249 @@
+#include "bench.h"
+#include "../hstring.h"
+
+#include <new>
+#include <string>
+#include <type_traits>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::measure;
+using fool::bench::measureThreads;
+using fool::bench::Result;
+
+// 覆盖三种存储方式：0-23是小字符串，24-254是中字符串，255以上是大字符串
+static const size_t kLengths[] = {0, 8, 23, 24, 100, 254, 255, 1024, 16384};
+
+static std::string makeSource(size_t len)
+{
+    std::string s(len, 'x');
+    for (size_t i = 0; i < len; ++i)
+    {
+        s[i] = char('a' + i % 26);
+    }
+    return s;
+}
+
+static const char *category(size_t len)
+{
+    return len <= 23 ? "small" : (len <= 254 ? "medium" : "large");
+}
+
+static std::string caseName(const char *op, size_t len)
+{
+    return std::string(op) + " len=" + std::to_string(len) + " (" + category(len) + ")";
+}
+
+// 构造和析构分开计时：每批在一块原始内存上placement new若干个对象，再统一析构
+template <class S>
+static void constructDestroy(const std::string &src, Result *construct, Result *destroy)
+{
+    typedef std::chrono::steady_clock clock;
+    constexpr size_t kBatch = 256;
+    typename std::aligned_storage<sizeof(S), alignof(S)>::type storage[kBatch];
+    auto objs = reinterpret_cast<S *>(storage);
+
+    size_t iters = 0;
+    double ctorNs = 0, dtorNs = 0;
+    fool::bench::AllocStats ctorAllocs{0, 0};
+    while (ctorNs + dtorNs < bench::options().minMillis * 1e6)
+    {
+        auto const a0 = bench::threadAllocStats();
+        auto const t0 = clock::now();
+        for (size_t i = 0; i < kBatch; ++i)
+        {
+            new (&objs[i]) S(src.data(), src.size());
+        }
+        auto const t1 = clock::now();
+        auto const a1 = bench::threadAllocStats();
+        bench::clobber();
+        for (size_t i = 0; i < kBatch; ++i)
+        {
+            objs[i].~S();
+        }
+        auto const t2 = clock::now();
+        ctorNs += std::chrono::duration<double, std::nano>(t1 - t0).count();
+        dtorNs += std::chrono::duration<double, std::nano>(t2 - t1).count();
+        ctorAllocs.allocs += a1.allocs - a0.allocs;
+        ctorAllocs.bytes += a1.bytes - a0.bytes;
+        iters += kBatch;
+    }
+    construct->nsPerOp = ctorNs / iters;
+    construct->allocsPerOp = double(ctorAllocs.allocs) / iters;
+    construct->bytesPerOp = double(ctorAllocs.bytes) / iters;
+    destroy->nsPerOp = dtorNs / iters;
+}
+
+template <class S>
+static Result copy(const std::string &src)
+{
+    const S s(src.data(), src.size());
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            S c(s);
+            doNotOptimize(c);
+        }
+    });
+}
+
+template <class S>
+static Result move(const std::string &src)
+{
+    S a(src.data(), src.size());
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            S m(std::move(a));
+            a = std::move(m);
+            doNotOptimize(a);
+        }
+    });
+}
+
+template <class S>
+static Result pushBack(const std::string &src)
+{
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            S s;
+            for (size_t j = 0; j < src.size(); ++j)
+            {
+                s.push_back(src[j]);
+            }
+            doNotOptimize(s);
+        }
+    });
+}
+
+template <class S>
+static Result reserve(const std::string &src)
+{
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            S s;
+            s.reserve(src.size());
+            doNotOptimize(s);
+        }
+    });
+}
+
+// 拷贝之后马上修改，大字符串会在这里触发mutableDataLarge/unshare
+template <class S>
+static Result copyThenMutate(const std::string &src)
+{
+    const S s(src.data(), src.size());
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            S c(s);
+            if (!c.empty())
+            {
+                c[0] = 'y';
+            }
+            doNotOptimize(c);
+        }
+    });
+}
+
+// 多个线程同时拷贝同一个大字符串，hstring只是增加引用计数，std::string每次都是深拷贝
+template <class S>
+static Result sharedCopy(const std::string &src, bool mutate)
+{
+    const S s(src.data(), src.size());
+    return measureThreads(bench::options().threads, [&](unsigned, size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            S c(s);
+            if (mutate)
+            {
+                c[0] = 'y';
+            }
+            doNotOptimize(c);
+        }
+    });
+}
+
+template <class F>
+static void table(const char *title, F &&f)
+{
+    if (!bench::selected(title))
+    {
+        return;
+    }
+    bench::printHeader(title, "hstring", "std::string");
+    for (size_t len : kLengths)
+    {
+        auto const src = makeSource(len);
+        Result h, s;
+        f(src, &h, &s);
+        bench::printRow(caseName(title, len), h, s);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+
+    Result hDestroy[sizeof(kLengths) / sizeof(kLengths[0])], sDestroy[sizeof(kLengths) / sizeof(kLengths[0])];
+    size_t idx = 0;
+    table("construct", [&](const std::string &src, Result *h, Result *s) {
+        constructDestroy<hstring>(src, h, &hDestroy[idx]);
+        constructDestroy<std::string>(src, s, &sDestroy[idx]);
+        ++idx;
+    });
+    if (bench::selected("construct"))
+    {
+        bench::printHeader("destroy", "hstring", "std::string");
+        for (size_t i = 0; i < idx; ++i)
+        {
+            bench::printRow(caseName("destroy", kLengths[i]), hDestroy[i], sDestroy[i]);
+        }
+    }
+    table("copy", [](const std::string &src, Result *h, Result *s) {
+        *h = copy<hstring>(src);
+        *s = copy<std::string>(src);
+    });
+    table("move", [](const std::string &src, Result *h, Result *s) {
+        *h = move<hstring>(src);
+        *s = move<std::string>(src);
+    });
+    table("push_back", [](const std::string &src, Result *h, Result *s) {
+        *h = pushBack<hstring>(src);
+        *s = pushBack<std::string>(src);
+    });
+    // malloc策略下容量按malloc_usable_size取整，push_back的重新分配次数更少
+    table("push_back malloc", [](const std::string &src, Result *h, Result *s) {
+        *h = pushBack<basic_hstring<char, basic_hstring_core<malloc_allocator>>>(src);
+        *s = pushBack<std::string>(src);
+    });
+    table("reserve", [](const std::string &src, Result *h, Result *s) {
+        *h = reserve<hstring>(src);
+        *s = reserve<std::string>(src);
+    });
+    table("copy+mutate", [](const std::string &src, Result *h, Result *s) {
+        *h = copyThenMutate<hstring>(src);
+        *s = copyThenMutate<std::string>(src);
+    });
+
+    // 多线程只测大字符串，这是引用计数真正起作用的地方
+    for (int mutate = 0; mutate < 2; ++mutate)
+    {
+        auto const title = mutate ? "threads copy+mutate" : "threads copy";
+        if (!bench::selected(title))
+        {
+            continue;
+        }
+        bench::printHeader(title, "hstring", "std::string");
+        for (size_t len : {size_t(255), size_t(1024), size_t(16384)})
+        {
+            auto const src = makeSource(len);
+            auto const h = sharedCopy<hstring>(src, mutate);
+            auto const s = sharedCopy<std::string>(src, mutate);
+            bench::printRow(caseName(title, len) + " x" + std::to_string(bench::options().threads), h, s);
+        }
+    }
+    return 0;
+}
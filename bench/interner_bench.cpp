@@ -0,0 +1,70 @@
+#include "bench.h"
+#include "../hinterner.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::Result;
+
+// 大量重复的中等长度记号（头部名、租户ID、指标标签），每个线程把解析出来的记号保存下来
+// 直接构造每次都是一次深拷贝，驻留之后重复的值只增加引用计数
+static std::vector<std::string> makeVocabulary(size_t n, size_t len)
+{
+    std::vector<std::string> v;
+    for (size_t i = 0; i < n; ++i)
+    {
+        auto s = "label-" + std::to_string(i) + "-";
+        s.resize(len, char('a' + i % 26));
+        v.push_back(s);
+    }
+    return v;
+}
+
+template <class Make>
+static Result keep(const std::vector<std::string> &vocab, unsigned threads, Make &&make)
+{
+    return bench::measureThreads(threads, [&](unsigned tid, size_t iters) {
+        std::vector<hstring> kept;
+        kept.reserve(iters);
+        uint32_t x = 2463534242u + tid;
+        for (size_t i = 0; i < iters; ++i)
+        {
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            auto const &s = vocab[x % vocab.size()];
+            kept.push_back(make(std::string_view(s)));
+        }
+        doNotOptimize(kept);
+    });
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    if (!bench::selected("keep tokens"))
+    {
+        return 0;
+    }
+    bench::printHeader("keep tokens");
+    for (unsigned threads : {1u, bench::options().threads})
+    {
+        for (size_t len : {32, 100, 200})
+        {
+            auto const vocab = makeVocabulary(1000, len);
+            hstring_interner pool;
+            auto const name = "len=" + std::to_string(len) + " vocab=1000 x" + std::to_string(threads);
+            // 中字符串的深拷贝走slab分配器，不经过malloc，用slab向系统申请的总量来看内存占用
+            auto const reserved = slab_allocator::reservedBytes();
+            bench::printRow(name + " [hstring]", keep(vocab, threads, [](std::string_view sv) { return hstring(sv); }));
+            printf("    hstring: slab grew by %zu bytes\n", slab_allocator::reservedBytes() - reserved);
+            bench::printRow(name + " [interner]", keep(vocab, threads, [&](std::string_view sv) { return pool.intern(sv); }));
+            auto const s = pool.stats();
+            printf("    interner: entries=%zu hit rate=%.4f bytes=%zu saved=%zu\n", s.entries, s.hitRate(), s.bytes, s.bytesSaved);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include "bench.h"
+#include "../hio.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::measure;
+using fool::bench::Result;
+
+// 一个32MB的日志文件，每行40到200字节，都在页缓存里，比较的是拷贝和分配的开销
+static const size_t kFileSize = 32 * 1024 * 1024;
+
+static std::string makeFile()
+{
+    char path[] = "/tmp/hio_benchXXXXXX";
+    int fd = mkstemp(path);
+    std::string line;
+    size_t total = 0;
+    uint64_t x = 88172645463325252ull;
+    while (total < kFileSize)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        line.assign(40 + x % 160, char('a' + x % 26));
+        line.push_back('\n');
+        if (write(fd, line.data(), line.size()) != ssize_t(line.size()))
+        {
+            abort();
+        }
+        total += line.size();
+    }
+    close(fd);
+    return path;
+}
+
+static size_t fileSize(int fd)
+{
+    struct stat st;
+    fstat(fd, &st);
+    return size_t(st.st_size);
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    auto const path = makeFile();
+
+    if (bench::selected("read whole file"))
+    {
+        bench::printHeader("read whole file 32MB", "hio::readAll", "ifstream::read");
+        auto const h = measure([&](size_t iters) {
+            for (size_t i = 0; i < iters; ++i)
+            {
+                int fd = open(path.c_str(), O_RDONLY);
+                hstring s;
+                hio::readAll(fd, s, fileSize(fd));
+                close(fd);
+                doNotOptimize(s);
+            }
+        });
+        auto const s = measure([&](size_t iters) {
+            for (size_t i = 0; i < iters; ++i)
+            {
+                std::ifstream in(path, std::ios::binary);
+                in.seekg(0, std::ios::end);
+                std::string str(size_t(in.tellg()), '\0');
+                in.seekg(0);
+                in.read(&str[0], std::streamsize(str.size()));
+                doNotOptimize(str);
+            }
+        });
+        bench::printRow("sized", h, s);
+        auto const h2 = measure([&](size_t iters) {
+            for (size_t i = 0; i < iters; ++i)
+            {
+                int fd = open(path.c_str(), O_RDONLY);
+                hstring s;
+                hio::readAll(fd, s);
+                close(fd);
+                doNotOptimize(s);
+            }
+        });
+        auto const s2 = measure([&](size_t iters) {
+            for (size_t i = 0; i < iters; ++i)
+            {
+                std::ifstream in(path, std::ios::binary);
+                std::ostringstream out;
+                out << in.rdbuf();
+                auto str = out.str();
+                doNotOptimize(str);
+            }
+        });
+        bench::printRow("unsized (stringstream)", h2, s2);
+    }
+
+    if (bench::selected("getline"))
+    {
+        bench::printHeader("getline 32MB", "hio::LineReader", "std::getline");
+        auto const h = measure([&](size_t iters) {
+            for (size_t i = 0; i < iters; ++i)
+            {
+                int fd = open(path.c_str(), O_RDONLY);
+                hio::LineReader<hstring> reader(fd);
+                hstring line;
+                size_t bytes = 0;
+                while (reader.getline(line))
+                {
+                    bytes += line.size();
+                }
+                close(fd);
+                doNotOptimize(bytes);
+            }
+        });
+        auto const s = measure([&](size_t iters) {
+            for (size_t i = 0; i < iters; ++i)
+            {
+                std::ifstream in(path);
+                std::string line;
+                size_t bytes = 0;
+                while (std::getline(in, line))
+                {
+                    bytes += line.size();
+                }
+                doNotOptimize(bytes);
+            }
+        });
+        bench::printRow("per file", h, s);
+    }
+
+    if (bench::selected("write"))
+    {
+        // 一次响应由很多段拼成，比如头部的字段和body的分块
+        std::vector<hstring> parts;
+        for (size_t i = 0; i < 4096; ++i)
+        {
+            parts.emplace_back(16 + i % 600, char('a' + i % 26));
+        }
+        auto const out = path + ".out";
+        bench::printHeader("write 4096 pieces", "hio::writeAll", "ofstream <<");
+        auto const h = measure([&](size_t iters) {
+            for (size_t i = 0; i < iters; ++i)
+            {
+                int fd = open(out.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+                hio::writeAll(fd, parts.begin(), parts.end());
+                close(fd);
+            }
+        });
+        auto const s = measure([&](size_t iters) {
+            for (size_t i = 0; i < iters; ++i)
+            {
+                std::ofstream o(out, std::ios::binary | std::ios::trunc);
+                for (auto const &p : parts)
+                {
+                    o.write(p.data(), std::streamsize(p.size()));
+                }
+            }
+        });
+        bench::printRow("per batch", h, s);
+        unlink(out.c_str());
+    }
+    unlink(path.c_str());
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "bench.h"
+#include "../hmmap.h"
+#include "../hstring.h"
+
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::measure;
+using fool::bench::Result;
+
+// 加载一个文件：hstring::mapFile超过64页的直接映射、更小的读进来，std::string走读文件再拷贝的老路
+// 从16K到1M逐级看映射和读文件的交叉点
+static const size_t kSizes[] = {16 * 1024, 64 * 1024, 128 * 1024, 256 * 1024, 512 * 1024, 1024 * 1024, 64 * 1024 * 1024};
+
+static std::string sizeName(size_t n)
+{
+    return n >= 1024 * 1024 ? std::to_string(n >> 20) + "M" : std::to_string(n >> 10) + "K";
+}
+
+static std::string readFile(const char *path)
+{
+    hmmap::File file(path);
+    std::string s(file.size(), '\0');
+    file.read(&s[0], s.size());
+    return s;
+}
+
+// scan为true时再把每一页都读一遍，映射的缺页开销算进去
+template <class Load>
+static Result load(Load &&f, bool scan)
+{
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            auto const s = f();
+            if (scan)
+            {
+                size_t sum = 0;
+                for (size_t j = 0; j < s.size(); j += 4096)
+                {
+                    sum += static_cast<unsigned char>(s.data()[j]);
+                }
+                doNotOptimize(sum);
+            }
+            doNotOptimize(s);
+        }
+    });
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    for (int scan = 0; scan < 2; ++scan)
+    {
+        auto const title = scan ? "load+touch" : "load";
+        if (!bench::selected(title))
+        {
+            continue;
+        }
+        bench::printHeader(title, "hstring::mapFile", "read into std::string");
+        for (size_t n : kSizes)
+        {
+            char path[] = "/tmp/mmap_benchXXXXXX";
+            int fd = mkstemp(path);
+            std::string content(n, 'x');
+            if (fd < 0 || write(fd, content.data(), n) != ssize_t(n))
+            {
+                perror("mmap_bench");
+                return 1;
+            }
+            close(fd);
+            auto const h = load([&] { return hstring::mapFile(path); }, scan);
+            auto const s = load([&] { return readFile(path); }, scan);
+            bench::printRow(std::string(title) + " size=" + sizeName(n), h, s);
+            unlink(path);
+        }
+    }
+    return 0;
+}
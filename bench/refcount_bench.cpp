@@ -0,0 +1,135 @@
+#include "bench.h"
+#include "../hstring.h"
+
+#include <string>
+#include <vector>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::measure;
+using fool::bench::measureThreads;
+using fool::bench::Result;
+
+// 大字符串的拷贝只是增加引用计数，这里比较原子计数和普通计数的开销
+static const size_t kLengths[] = {1024, 16 * 1024, 256 * 1024, 1024 * 1024};
+
+static std::string caseName(const char *op, size_t len)
+{
+    return std::string(op) + " len=" + (len >= 1024 * 1024 ? std::to_string(len >> 20) + "M" : std::to_string(len >> 10) + "K");
+}
+
+// 拷贝一次，马上析构
+template <class S>
+static Result copyDestroy(size_t len)
+{
+    const S s(len, 'x');
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            S c(s);
+            doNotOptimize(c);
+        }
+    });
+}
+
+// 一次拷贝出一批，再统一析构，模拟把一个大字符串分发给多个持有者
+template <class S>
+static Result fanOut(size_t len)
+{
+    constexpr size_t kFan = 16;
+    const S s(len, 'x');
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; i += kFan)
+        {
+            S c[kFan] = {s, s, s, s, s, s, s, s, s, s, s, s, s, s, s, s};
+            doNotOptimize(c);
+        }
+    });
+}
+
+// 在共享状态下查询容量，每次都要读一次引用计数
+template <class S>
+static Result sharedCapacity(size_t len)
+{
+    const S s(len, 'x');
+    const S c(s);
+    return measure([&](size_t iters) {
+        size_t sum = 0;
+        for (size_t i = 0; i < iters; ++i)
+        {
+            doNotOptimize(c);
+            sum += c.capacity();
+        }
+        doNotOptimize(sum);
+    });
+}
+
+// 所有线程同时拷贝和析构同一个共享的模板，atomic_refcount的计数器所在的缓存行在核之间来回搬
+// fan为1是拷贝一次马上析构，否则每个线程先攒fan个拷贝再一起析构
+template <class S>
+static Result scaling(unsigned threads, size_t fan)
+{
+    const S tmpl(16 * 1024, 't');
+    auto const r = measureThreads(threads, [&](unsigned, size_t iters) {
+        std::vector<S> held;
+        held.reserve(fan);
+        for (size_t i = 0; i < iters; ++i)
+        {
+            held.push_back(tmpl);
+            if (held.size() == fan)
+            {
+                doNotOptimize(held);
+                held.clear();
+            }
+        }
+    });
+    // 线程缓存的引用在线程退出时已经还回去了
+    return r;
+}
+
+template <class F>
+static void table(const char *title, F &&f)
+{
+    if (!bench::selected(title))
+    {
+        return;
+    }
+    bench::printHeader(title, "plain_refcount", "atomic_refcount");
+    for (size_t len : kLengths)
+    {
+        Result p, a;
+        f(len, &p, &a);
+        bench::printRow(caseName(title, len), p, a);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    table("copy+destroy", [](size_t len, Result *p, Result *a) {
+        *p = copyDestroy<local_hstring>(len);
+        *a = copyDestroy<hstring>(len);
+    });
+    table("fan-out x16", [](size_t len, Result *p, Result *a) {
+        *p = fanOut<local_hstring>(len);
+        *a = fanOut<hstring>(len);
+    });
+    table("shared capacity", [](size_t len, Result *p, Result *a) {
+        *p = sharedCapacity<local_hstring>(len);
+        *a = sharedCapacity<hstring>(len);
+    });
+    for (size_t fan : {size_t(1), size_t(16)})
+    {
+        auto const title = fan == 1 ? std::string("threads copy+destroy") : "threads fan-out x" + std::to_string(fan);
+        if (!bench::selected(title))
+        {
+            continue;
+        }
+        bench::printHeader(title.c_str(), "deferred_refcount", "atomic_refcount");
+        for (unsigned n : {1u, 2u, 4u, 8u, 16u, 32u, 64u})
+        {
+            bench::printRow(title + " threads=" + std::to_string(n), scaling<deferred_hstring>(n, fan), scaling<hstring>(n, fan));
+        }
+    }
+    return 0;
+}
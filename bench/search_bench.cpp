@@ -0,0 +1,171 @@
+#include "bench.h"
+#include "../hstring.h"
+#include "../hsearch.h"
+
+#include <string.h>
+#include <string>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::measure;
+using fool::bench::Result;
+
+static const hsearch::Level kLevels[] = {hsearch::Level::Scalar, hsearch::Level::SSE2, hsearch::Level::AVX2};
+
+// 类似HTTP头和日志的文本，目标放在最后，前面只有部分匹配
+static std::string makeHaystack(size_t len)
+{
+    static const char kLine[] = "Accept-Encoding: gzip, deflate\r\nX-Request-Id: 4f1c2a9e\r\n";
+    std::string s;
+    while (s.size() < len)
+    {
+        s += kLine;
+    }
+    s.resize(len);
+    return s;
+}
+
+static void runFind(const std::string &hay, const std::string &needle, const char *what)
+{
+    auto const name = std::string(what) + " hay=" + std::to_string(hay.size()) + " needle=" + std::to_string(needle.size());
+    for (auto lv : kLevels)
+    {
+        hsearch::setLevel(lv);
+        if (hsearch::level() != lv)
+        {
+            continue;
+        }
+        const hstring h(hay.data(), hay.size());
+        auto const r = measure([&](size_t iters) {
+            for (size_t i = 0; i < iters; ++i)
+            {
+                doNotOptimize(h.find(needle.data(), 0, needle.size()));
+            }
+        });
+        bench::printRow(name + " [hstring " + hsearch::levelName(lv) + "]", r);
+    }
+    auto const s = measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            doNotOptimize(hay.find(needle));
+        }
+    });
+    bench::printRow(name + " [std::string]", s);
+    auto const mm = measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            doNotOptimize(memmem(hay.data(), hay.size(), needle.data(), needle.size()));
+        }
+    });
+    bench::printRow(name + " [memmem]", mm);
+}
+
+template <bool kNot>
+static void runSet(const std::string &hay, const std::string &set, const char *what)
+{
+    auto const name = std::string(what) + " hay=" + std::to_string(hay.size()) + " set=" + std::to_string(set.size());
+    for (auto lv : kLevels)
+    {
+        hsearch::setLevel(lv);
+        if (hsearch::level() != lv)
+        {
+            continue;
+        }
+        const hstring h(hay.data(), hay.size());
+        auto const r = measure([&](size_t iters) {
+            for (size_t i = 0; i < iters; ++i)
+            {
+                doNotOptimize(kNot ? h.find_first_not_of(set.data(), 0, set.size()) : h.find_first_of(set.data(), 0, set.size()));
+            }
+        });
+        bench::printRow(name + " [hstring " + hsearch::levelName(lv) + "]", r);
+    }
+    auto const s = measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            doNotOptimize(kNot ? hay.find_first_not_of(set) : hay.find_first_of(set));
+        }
+    });
+    bench::printRow(name + " [std::string]", s);
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    const size_t sizes[] = {64, 1024, 65536, 1 << 20};
+
+    if (bench::selected("find"))
+    {
+        bench::printHeader("find (needle at the end)");
+        for (size_t len : sizes)
+        {
+            for (const char *needle : {"\r\n\r\n", "Content-Length: ", "Authorization: Bearer abcdef0123456789"})
+            {
+                auto hay = makeHaystack(len);
+                hay.replace(hay.size() - strlen(needle), strlen(needle), needle);
+                runFind(hay, needle, "find");
+            }
+        }
+        bench::printHeader("find (not found)");
+        for (size_t len : sizes)
+        {
+            runFind(makeHaystack(len), "X-Missing-Header", "miss");
+        }
+    }
+    if (bench::selected("rfind"))
+    {
+        bench::printHeader("rfind (needle at the start)");
+        for (size_t len : sizes)
+        {
+            auto hay = makeHaystack(len);
+            hay.replace(0, 6, "Cookie");
+            auto const name = "rfind hay=" + std::to_string(len);
+            for (auto lv : kLevels)
+            {
+                hsearch::setLevel(lv);
+                if (hsearch::level() != lv)
+                {
+                    continue;
+                }
+                const hstring h(hay.data(), hay.size());
+                auto const r = measure([&](size_t iters) {
+                    for (size_t i = 0; i < iters; ++i)
+                    {
+                        doNotOptimize(h.rfind("Cookie"));
+                    }
+                });
+                bench::printRow(name + " [hstring " + hsearch::levelName(lv) + "]", r);
+            }
+            bench::printRow(name + " [std::string]", measure([&](size_t iters) {
+                                for (size_t i = 0; i < iters; ++i)
+                                {
+                                    doNotOptimize(hay.rfind("Cookie"));
+                                }
+                            }));
+        }
+    }
+    if (bench::selected("first_of"))
+    {
+        bench::printHeader("find_first_of (match at the end)");
+        for (size_t len : sizes)
+        {
+            std::string hay(len, 'a');
+            for (size_t i = 0; i < len; ++i)
+            {
+                hay[i] = char('a' + i % 26);
+            }
+            hay.back() = ';';
+            runSet<false>(hay, "\r\n", "first_of");
+            runSet<false>(hay, ";=,\"\\\r\n\t", "first_of");
+        }
+        bench::printHeader("find_first_not_of (skip whitespace)");
+        for (size_t len : sizes)
+        {
+            std::string hay(len, ' ');
+            hay.back() = 'x';
+            runSet<true>(hay, " \t\r\n", "first_not_of");
+        }
+    }
+    hsearch::setLevel(hsearch::bestLevel());
+    return 0;
+}
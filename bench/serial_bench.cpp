@@ -0,0 +1,240 @@
+#include "bench.h"
+#include "../hserial.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::measure;
+using fool::bench::Result;
+
+// 缓存快照：大部分是键一样的短字符串，一部分几十到一百多字节的值，少量几KB的值
+
+static std::vector<hstring> makeStrings(size_t n)
+{
+    std::vector<hstring> out;
+    out.reserve(n);
+    uint64_t x = 1;
+    for (size_t i = 0; i < n; ++i)
+    {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        auto const r = x >> 33;
+        size_t len;
+        if (r % 100 < 80)
+        {
+            len = 8 + r % 16;
+        }
+        else if (r % 100 < 97)
+        {
+            len = 24 + r % 200;
+        }
+        else
+        {
+            len = 600 + r % 4000;
+        }
+        out.emplace_back(len, char('a' + r % 26));
+    }
+    return out;
+}
+
+// 对照组：每个字符串写长度和内容，stdio自己缓冲
+static void saveStdio(const char *path, const std::vector<hstring> &v)
+{
+    auto const f = fopen(path, "wb");
+    for (auto const &s : v)
+    {
+        uint64_t const len = s.size();
+        fwrite(&len, sizeof(len), 1, f);
+        fwrite(std::as_const(s).data(), 1, s.size(), f);
+    }
+    fclose(f);
+}
+
+// 对照组：整个文件读进来，再逐个解析、每个字符串拷贝一份（中字符串和大字符串都要分配一次）
+static std::vector<hstring> loadParse(const char *path)
+{
+    std::string buf;
+    {
+        hmmap::File file(path);
+        buf.resize(file.size());
+        file.read(&buf[0], buf.size());
+    }
+    size_t index;
+    auto const count = hserial::checkFile(buf.data(), buf.size(), &index);
+    std::vector<hstring> out;
+    out.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto const off = hserial::loadU64(buf.data() + index + i * sizeof(uint64_t));
+        out.emplace_back(buf.data() + off + sizeof(uint64_t), hserial::loadU64(buf.data() + off));
+    }
+    return out;
+}
+
+// 把每个字符串都读一遍，映射的缺页开销算进去
+static size_t touch(const std::vector<hstring> &v)
+{
+    size_t sum = 0;
+    for (auto const &s : v)
+    {
+        auto const p = std::as_const(s).data();
+        for (size_t j = 0; j < s.size(); j += 64)
+        {
+            sum += static_cast<unsigned char>(p[j]);
+        }
+    }
+    return sum;
+}
+
+static size_t statusKB(const char *field)
+{
+    auto const f = fopen("/proc/self/status", "r");
+    char line[256];
+    size_t kb = 0;
+    auto const len = strlen(field);
+    while (f != nullptr && fgets(line, sizeof(line), f) != nullptr)
+    {
+        if (strncmp(line, field, len) == 0)
+        {
+            kb = size_t(atol(line + len + 1));
+        }
+    }
+    if (f != nullptr)
+    {
+        fclose(f);
+    }
+    return kb;
+}
+
+// 在新的进程里加载并读一遍，返回峰值RSS比加载前多出来的KB数
+// 不能只fork：子进程会复用父进程已经驻留的堆和slab，拷贝加载的内存增长就看不出来了
+static long peakRssKB(const char *mode, const char *path)
+{
+    char exe[4096];
+    auto const len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (len <= 0)
+    {
+        return -1;
+    }
+    exe[len] = '\0';
+    auto const cmd = std::string(exe) + " --rss " + mode + " " + path;
+    auto const f = popen(cmd.c_str(), "r");
+    long kb = -1;
+    if (f != nullptr)
+    {
+        if (fscanf(f, "%ld", &kb) != 1)
+        {
+            kb = -1;
+        }
+        pclose(f);
+    }
+    return kb;
+}
+
+static int rssChild(const char *mode, const char *path)
+{
+    auto const before = long(statusKB("VmRSS"));
+    auto const v = strcmp(mode, "mmap") == 0 ? hserial::load(path) : loadParse(path);
+    doNotOptimize(touch(v));
+    printf("%ld\n", long(statusKB("VmHWM")) - before);
+    return 0;
+}
+
+// 整个文件一次操作，折算成每个字符串
+static Result perString(Result r, size_t n)
+{
+    r.nsPerOp /= double(n);
+    r.allocsPerOp /= double(n);
+    r.bytesPerOp /= double(n);
+    return r;
+}
+
+static void run(size_t n, const std::string &tag)
+{
+    char path[] = "/tmp/serial_benchXXXXXX";
+    auto const fd = mkstemp(path);
+    if (fd < 0)
+    {
+        perror("serial_bench");
+        return;
+    }
+    close(fd);
+
+    size_t fileBytes = 0;
+    {
+        auto const v = makeStrings(n);
+        size_t payload = 0;
+        for (auto const &s : v)
+        {
+            payload += s.size();
+        }
+        auto const save = perString(measure([&](size_t iters) {
+                                        for (size_t i = 0; i < iters; ++i)
+                                        {
+                                            fileBytes = hserial::save(path, v.begin(), v.end());
+                                        }
+                                    }),
+                                    n);
+        auto const stdio = perString(measure([&](size_t iters) {
+                                         for (size_t i = 0; i < iters; ++i)
+                                         {
+                                             saveStdio(path, v);
+                                         }
+                                     }),
+                                     n);
+        hserial::save(path, v.begin(), v.end());
+        printf("\n%s: %zu strings, %.1f MB payload, %.1f MB file\n", tag.c_str(), n, payload / 1048576.0, fileBytes / 1048576.0);
+        bench::printHeader(("save " + tag + " (per string)").c_str(), "hserial::save (writev)", "stdio fwrite");
+        bench::printRow("save " + tag, save, stdio);
+    }
+    bench::printHeader(("load " + tag + " (per string)").c_str(), "hserial::load (mmap)", "read + parse + copy");
+    for (int scan = 0; scan < 2; ++scan)
+    {
+        auto const name = std::string(scan ? "load+touch " : "load ") + tag;
+        auto const mapped = perString(measure([&](size_t iters) {
+                                          for (size_t i = 0; i < iters; ++i)
+                                          {
+                                              auto const v = hserial::load(path);
+                                              doNotOptimize(scan ? touch(v) : v.size());
+                                          }
+                                      }),
+                                      n);
+        auto const parsed = perString(measure([&](size_t iters) {
+                                          for (size_t i = 0; i < iters; ++i)
+                                          {
+                                              auto const v = loadParse(path);
+                                              doNotOptimize(scan ? touch(v) : v.size());
+                                          }
+                                      }),
+                                      n);
+        bench::printRow(name, mapped, parsed);
+    }
+    // 映射进来的页是页缓存，多个进程加载同一个快照时共享，内存紧张时可以直接丢掉
+    printf("%-44s | %27.1f MB | %27.1f MB |\n", ("peak RSS " + tag).c_str(),
+           peakRssKB("mmap", path) / 1024.0, peakRssKB("parse", path) / 1024.0);
+    unlink(path);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 4 && strcmp(argv[1], "--rss") == 0)
+    {
+        return rssChild(argv[2], argv[3]);
+    }
+    bench::init(argc, argv);
+    for (size_t n : {size_t(100000), size_t(1000000), size_t(10000000)})
+    {
+        auto const tag = n >= 1000000 ? "n=" + std::to_string(n / 1000000) + "M" : "n=" + std::to_string(n / 1000) + "K";
+        // 1000万个字符串的快照有好几GB，只有用--filter明确选中时才跑
+        if (!bench::selected(tag) || (n >= 10000000 && bench::options().filter == nullptr))
+        {
+            continue;
+        }
+        run(n, tag);
+    }
+    return 0;
+}
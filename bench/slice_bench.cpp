@@ -0,0 +1,69 @@
+#include "bench.h"
+#include "../hstring.h"
+
+#include <string>
+#include <vector>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::measure;
+using fool::bench::Result;
+
+// 把一个4MB的请求体按固定长度切成字段。hstring的切片要以\0结尾，中间的字段后面不是\0，和std::string一样复制；
+// 只有切到结尾的子串和原字符串共享内存
+static const size_t kBodySize = 4 * 1024 * 1024;
+static const size_t kFieldSizes[] = {16, 64, 256, 4096};
+
+template <class S>
+static Result carve(const S &body, size_t fieldSize, bool terminate)
+{
+    auto const n = body.size() / fieldSize;
+    std::vector<S> fields;
+    fields.reserve(n);
+    auto r = measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            auto const k = i % n;
+            if (k == 0)
+            {
+                fields.clear();
+            }
+            fields.push_back(body.substr(k * fieldSize, fieldSize));
+            if (terminate)
+            {
+                // 切片在创建时就以\0结尾，c_str()只是读
+                doNotOptimize(fields.back().c_str());
+            }
+            doNotOptimize(fields.back());
+        }
+    });
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    std::string src(kBodySize, 'x');
+    for (size_t i = 0; i < src.size(); ++i)
+    {
+        src[i] = char('a' + i % 26);
+    }
+    const hstring hbody(src.data(), src.size());
+
+    for (int terminate = 0; terminate < 2; ++terminate)
+    {
+        auto const title = terminate ? "substr+c_str 4MB body" : "substr 4MB body";
+        if (!bench::selected(title))
+        {
+            continue;
+        }
+        bench::printHeader(title, "hstring", "std::string");
+        for (size_t fieldSize : kFieldSizes)
+        {
+            auto const h = carve(hbody, fieldSize, terminate);
+            auto const s = carve(src, fieldSize, terminate);
+            bench::printRow(std::string(title) + " field=" + std::to_string(fieldSize), h, s);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include "bench.h"
+#include "../small_vector.h"
+#include "../hstring.h"
+
+#include <string>
+#include <vector>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::measure;
+using fool::bench::Result;
+
+// 热点结构体里通常只有1到4个元素的小数组，超过内部容量的情况也要看
+static const size_t kCounts[] = {1, 2, 4, 8, 32};
+
+template <class V>
+static Result push(size_t n)
+{
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            V v;
+            for (size_t k = 0; k < n; ++k)
+            {
+                v.push_back(typename V::value_type(k));
+            }
+            doNotOptimize(v);
+        }
+    });
+}
+
+// 一批对象，每个里面有一个小数组，遍历所有元素求和，看局部性
+template <class V>
+static Result iterate(size_t n)
+{
+    std::vector<V> objs(1024);
+    for (auto &v : objs)
+    {
+        for (size_t k = 0; k < n; ++k)
+        {
+            v.push_back(typename V::value_type(k));
+        }
+    }
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            size_t sum = 0;
+            for (auto const &x : objs[i % objs.size()])
+            {
+                sum += size_t(x);
+            }
+            doNotOptimize(sum);
+        }
+    });
+}
+
+template <class V>
+static Result copy(size_t n)
+{
+    V src;
+    for (size_t k = 0; k < n; ++k)
+    {
+        src.push_back(typename V::value_type(k));
+    }
+    return measure([&](size_t iters) {
+        for (size_t i = 0; i < iters; ++i)
+        {
+            V v(src);
+            doNotOptimize(v);
+        }
+    });
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    typedef small_vector<int, 4> SV;
+    typedef std::vector<int> V;
+    struct Case
+    {
+        const char *name;
+        Result (*sv)(size_t);
+        Result (*v)(size_t);
+    };
+    const Case cases[] = {
+        {"push_back", push<SV>, push<V>},
+        {"iterate", iterate<SV>, iterate<V>},
+        {"copy", copy<SV>, copy<V>},
+    };
+    for (auto const &c : cases)
+    {
+        if (!bench::selected(c.name))
+        {
+            continue;
+        }
+        bench::printHeader(c.name, "small_vector<int, 4>", "std::vector<int>");
+        for (size_t n : kCounts)
+        {
+            bench::printRow(std::string(c.name) + " n=" + std::to_string(n), c.sv(n), c.v(n));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "bench.h"
+#include "../hstring.h"
+
+#include <string>
+#include <vector>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::measure;
+using fool::bench::measureThreads;
+using fool::bench::Result;
+
+// 不同分界的预设在同一个长度分布下的表现
+// 读多写少的缓存：按值取出、取出后追加一点再用、多个线程同时取同一批值
+template <class Traits>
+using traits_hstring = basic_hstring<char, basic_hstring_core<slab_allocator, atomic_refcount, Traits>>;
+
+struct Distribution
+{
+    const char *name;
+    size_t lo;
+    size_t hi;
+};
+
+static const Distribution kDistributions[] = {
+    {"len=24-254", 24, 254},
+    {"len=300-600", 300, 600},
+    {"len=1k-4k", 1024, 4096},
+    {"len=8-2k", 8, 2048},
+};
+
+static const size_t kPoolSize = 4096;
+
+// 固定种子，每个预设看到的长度序列一样
+static std::vector<size_t> lengths(const Distribution &d)
+{
+    std::vector<size_t> out;
+    uint64_t x = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < kPoolSize; ++i)
+    {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        out.push_back(d.lo + (x >> 33) % (d.hi - d.lo + 1));
+    }
+    return out;
+}
+
+template <class S>
+static void sweep(const char *preset, const Distribution &d)
+{
+    std::vector<S> pool;
+    for (auto len : lengths(d))
+    {
+        pool.emplace_back(len, char('a' + len % 26));
+    }
+    auto const prefix = std::string(d.name) + " " + preset;
+
+    bench::printRow(prefix + " get", measure([&](size_t iters) {
+                        for (size_t i = 0; i < iters; ++i)
+                        {
+                            S v(pool[i % kPoolSize]);
+                            doNotOptimize(v);
+                        }
+                    }));
+    bench::printRow(prefix + " get+append", measure([&](size_t iters) {
+                        for (size_t i = 0; i < iters; ++i)
+                        {
+                            S v(pool[i % kPoolSize]);
+                            v.append("-suffix!");
+                            doNotOptimize(v);
+                        }
+                    }));
+    bench::printRow(prefix + " get threads=" + std::to_string(bench::options().threads),
+                    measureThreads(bench::options().threads, [&](unsigned t, size_t iters) {
+                        for (size_t i = 0; i < iters; ++i)
+                        {
+                            S v(pool[(i + t * 7) % kPoolSize]);
+                            doNotOptimize(v);
+                        }
+                    }));
+    bench::printRow(prefix + " build", measure([&](size_t iters) {
+                        for (size_t i = 0; i < iters; ++i)
+                        {
+                            auto const n = pool[i % kPoolSize].size();
+                            S v;
+                            for (size_t k = 0; k < n; k += 16)
+                            {
+                                v.append("0123456789abcdef", std::min<size_t>(16, n - k));
+                            }
+                            doNotOptimize(v);
+                        }
+                    }));
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    for (auto const &d : kDistributions)
+    {
+        if (!bench::selected(d.name))
+        {
+            continue;
+        }
+        bench::printHeader(d.name);
+        sweep<traits_hstring<default_hstring_traits>>("default", d);
+        sweep<traits_hstring<nocow_hstring_traits>>("nocow", d);
+        sweep<traits_hstring<wide_medium_hstring_traits>>("wide_medium", d);
+    }
+    return 0;
+}
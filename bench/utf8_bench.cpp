@@ -0,0 +1,103 @@
+#include "bench.h"
+#include "../hutf8.h"
+
+#include <string>
+
+using namespace fool;
+using fool::bench::doNotOptimize;
+using fool::bench::measure;
+
+static const hsearch::Level kLevels[] = {hsearch::Level::Scalar, hsearch::Level::SSE2, hsearch::Level::AVX2};
+
+struct Corpus
+{
+    const char *name;
+    const char *text;
+};
+
+// 英文日志里偶尔有几个带重音的字母；多语言混排的中文、俄文和表情
+static const Corpus kCorpora[] = {
+    {"ascii-heavy", "2024-05-01T12:00:00Z INFO request served path=/api/v1/items status=200 user=Ren\xC3\xA9 latency=12ms\n"},
+    {"multilingual", "\xE4\xB8\xAD\xE6\x96\x87\xE6\x96\x87\xE6\x9C\xAC\xE5\x92\x8C English words "
+                     "\xD0\xA0\xD1\x83\xD1\x81\xD1\x81\xD0\xBA\xD0\xB8\xD0\xB9 \xD1\x82\xD0\xB5\xD0\xBA\xD1\x81\xD1\x82 "
+                     "\xF0\x9F\x98\x80\xF0\x9F\x8E\x89 \xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E\n"},
+};
+
+static hstring makeText(const char *unit, size_t len)
+{
+    hstring s;
+    while (s.size() < len)
+    {
+        s.append(unit);
+    }
+    // 截断后去掉末尾不完整的码点
+    s.resize(len);
+    while (!utf8_validate(s))
+    {
+        s.resize(s.size() - 1);
+    }
+    return s;
+}
+
+static void run(const Corpus &c, size_t len)
+{
+    const hstring text = makeText(c.text, len);
+    auto const sv = std::string_view(text);
+    auto const u16 = utf8_to_utf16(sv);
+    auto const prefix = std::string(c.name) + " len=" + std::to_string(sv.size());
+    for (auto lv : kLevels)
+    {
+        hutf8::setLevel(lv);
+        if (hutf8::level() != lv)
+        {
+            continue;
+        }
+        auto const tag = std::string(" [") + hsearch::levelName(lv) + "]";
+        bench::printRow(prefix + " validate" + tag, measure([&](size_t iters) {
+                            for (size_t i = 0; i < iters; ++i)
+                            {
+                                doNotOptimize(utf8_validate(sv));
+                            }
+                        }));
+        bench::printRow(prefix + " length" + tag, measure([&](size_t iters) {
+                            for (size_t i = 0; i < iters; ++i)
+                            {
+                                doNotOptimize(utf8_length(sv));
+                            }
+                        }));
+        bench::printRow(prefix + " to_utf16" + tag, measure([&](size_t iters) {
+                            std::u16string out;
+                            for (size_t i = 0; i < iters; ++i)
+                            {
+                                out.clear();
+                                append_utf16(out, sv);
+                                doNotOptimize(out);
+                            }
+                        }));
+        bench::printRow(prefix + " to_utf8" + tag, measure([&](size_t iters) {
+                            for (size_t i = 0; i < iters; ++i)
+                            {
+                                auto const out = utf16_to_utf8(u16);
+                                doNotOptimize(out);
+                            }
+                        }));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bench::init(argc, argv);
+    for (auto const &c : kCorpora)
+    {
+        if (!bench::selected(c.name))
+        {
+            continue;
+        }
+        bench::printHeader(c.name);
+        for (size_t len : {64, 1024, 65536})
+        {
+            run(c, len);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+#ifndef HXMMXH_ALLOCATOR_H
+#define HXMMXH_ALLOCATOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory_resource>
+#include <assert.h>
+
+#include "hmalloc.h"
+#include "hmmap.h"
+#include "hslab.h"
+
+// hstring_core的分配策略
+// 分配策略是一个只有静态函数的类，字符串对象里不保存任何分配器状态，布局仍然是24字节：
+//   static constexpr bool kMallocCompatible;  分配出来的内存能不能直接用free释放
+//   static size_t goodSize(size_t bytes);      按这个大小申请不会有浪费，字符串把多出来的部分记进容量
+//   static void *allocate(size_t bytes);
+//   static void deallocate(void *p, size_t bytes);       bytes和分配时的大小一致
+//   static void *reallocate(void *p, size_t currentSize, size_t currentCapacity, size_t newCapacity);
+//                                                        只需要保留前currentSize个字节，语义同smartRealloc
+namespace fool
+{
+    // 直接使用malloc/free，和原来的行为一致
+    struct malloc_allocator
+    {
+        static constexpr bool kMallocCompatible = true;
+
+        static size_t goodSize(size_t bytes) { return goodMallocSize(bytes); }
+        static void *allocate(size_t bytes)
+        {
+            auto const p = checkedMalloc(bytes);
+            assert(mallocUsableSize(p) >= bytes);
+            return p;
+        }
+        static void deallocate(void *p, size_t bytes) { sizedFree(p, bytes); }
+        static void *reallocate(void *p, size_t currentSize, size_t currentCapacity, size_t newCapacity)
+        {
+            return smartRealloc(p, currentSize, currentCapacity, newCapacity);
+        }
+    };
+
+    // 把std::pmr::memory_resource适配成分配策略
+    // 分配策略没有状态，资源是按Tag区分的全局设置，不同的Tag可以使用不同的资源
+    // 已经有字符串用某个资源分配过内存之后就不能再更换资源
+    template <class Tag = void>
+    struct pmr_allocator
+    {
+        static constexpr bool kMallocCompatible = false;
+
+        static std::pmr::memory_resource *resource()
+        {
+            auto const r = resource_.load(std::memory_order_acquire);
+            return r != nullptr ? r : std::pmr::get_default_resource();
+        }
+        static void setResource(std::pmr::memory_resource *r) { resource_.store(r, std::memory_order_release); }
+
+        // memory_resource没有办法查询实际的块大小，只能按申请的大小来
+        static size_t goodSize(size_t bytes) { return bytes; }
+        static void *allocate(size_t bytes) { return resource()->allocate(bytes, alignof(std::max_align_t)); }
+        static void deallocate(void *p, size_t bytes) { resource()->deallocate(p, bytes, alignof(std::max_align_t)); }
+        static void *reallocate(void *p, size_t currentSize, size_t currentCapacity, size_t newCapacity)
+        {
+            assert(currentSize <= currentCapacity && currentCapacity < newCapacity);
+            auto const result = allocate(newCapacity);
+            std::memcpy(result, p, currentSize);
+            FOOL_HSTATS_ADD(ReallocBytesCopied, currentSize);
+            deallocate(p, currentCapacity);
+            return result;
+        }
+
+    private:
+        static inline std::atomic<std::pmr::memory_resource *> resource_{nullptr};
+    };
+
+    // 几百MB的字符串一路append上去时用的分配策略：不小于kThreshold字节的块直接向内核要匿名映射，更小的交给Base
+    // 扩容时mremap把页表整体挪到更大的地址范围，已有的内容不拷贝；释放时munmap，内存马上还给系统
+    // malloc做不到这些：glibc释放过一个mmap的块以后会调高自己的mmap阈值，之后同样大的块从堆上分配，realloc又变回拷贝
+    // kHugePages时按2MB取整并请求透明大页，写满2MB只缺一次页，TLB也省得多；代价是每个字符串最多多占2MB
+    // 走哪条路只看字节数，分配策略本来就要求deallocate和reallocate传入的大小和分配时一致
+    template <class Base = slab_allocator, size_t kThreshold = size_t(1) << 20, bool kHugePages = false>
+    struct mmap_allocator
+    {
+        static constexpr bool kMallocCompatible = false;
+
+        static size_t goodSize(size_t bytes)
+        {
+            if (bytes < kThreshold)
+            {
+                return Base::goodSize(bytes);
+            }
+            auto const granule = kHugePages ? hmmap::kHugePageSize : hmmap::pageSize();
+            return (bytes + granule - 1) & ~(granule - 1);
+        }
+        static void *allocate(size_t bytes)
+        {
+            return bytes < kThreshold ? Base::allocate(bytes) : hmmap::mapAnonymous(bytes, kHugePages);
+        }
+        static void deallocate(void *p, size_t bytes)
+        {
+            if (bytes < kThreshold)
+            {
+                Base::deallocate(p, bytes);
+            }
+            else
+            {
+                hmmap::unmapAnonymous(p, bytes);
+            }
+        }
+        static void *reallocate(void *p, size_t currentSize, size_t currentCapacity, size_t newCapacity)
+        {
+            assert(currentSize <= currentCapacity && currentCapacity < newCapacity);
+            if (newCapacity < kThreshold)
+            {
+                return Base::reallocate(p, currentSize, currentCapacity, newCapacity);
+            }
+            if (currentCapacity >= kThreshold)
+            {
+                return hmmap::remapAnonymous(p, currentCapacity, newCapacity, kHugePages);
+            }
+            // 第一次越过阈值，搬进映射里，只拷贝用到的部分
+            auto const result = hmmap::mapAnonymous(newCapacity, kHugePages);
+            std::memcpy(result, p, currentSize);
+            FOOL_HSTATS_ADD(ReallocBytesCopied, currentSize);
+            Base::deallocate(p, currentCapacity);
+            return result;
+        }
+    };
+}
+
+#endif
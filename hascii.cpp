@@ -0,0 +1,204 @@
+#include "hascii.h"
+#include "likely.h"
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FOOL_ASCII_X86 1
+#include <immintrin.h>
+#else
+#define FOOL_ASCII_X86 0
+#endif
+
+using namespace fool;
+using hascii::npos;
+
+namespace
+{
+    typedef size_t (*FindRangeFn)(const char *s, size_t n, uint8_t lo, uint8_t span);
+    typedef void (*XorRangeFn)(char *s, size_t n, uint8_t lo, uint8_t span, char bits);
+
+    // 内核里的范围都写成lo和span = hi - lo，字节c在范围里就是 uint8_t(c - lo) <= span
+
+    /*------------------------------------------------标量实现------------------------------------------------------------------------*/
+
+    inline bool inRange(char c, uint8_t lo, uint8_t span)
+    {
+        return uint8_t(uint8_t(c) - lo) <= span;
+    }
+
+    size_t findRangeScalar(const char *s, size_t n, uint8_t lo, uint8_t span)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (inRange(s[i], lo, span))
+            {
+                return i;
+            }
+        }
+        return npos;
+    }
+
+    void xorRangeScalar(char *s, size_t n, uint8_t lo, uint8_t span, char bits)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            // 写成无分支的形式，编译器能自动向量化
+            s[i] ^= char(-char(inRange(s[i], lo, span)) & bits);
+        }
+    }
+
+#if FOOL_ASCII_X86
+    /*------------------------------------------------SSE2实现------------------------------------------------------------------------*/
+
+    // 无符号的 x - lo <= span 用 min(x - lo, span) == x - lo 判断
+    __attribute__((target("sse2"))) inline __m128i rangeMaskSSE2(__m128i x, __m128i lo, __m128i span)
+    {
+        const __m128i d = _mm_sub_epi8(x, lo);
+        return _mm_cmpeq_epi8(_mm_min_epu8(d, span), d);
+    }
+
+    __attribute__((target("sse2"))) size_t findRangeSSE2(const char *s, size_t n, uint8_t lo, uint8_t span)
+    {
+        const __m128i vlo = _mm_set1_epi8(char(lo));
+        const __m128i vspan = _mm_set1_epi8(char(span));
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            auto const mask = unsigned(_mm_movemask_epi8(rangeMaskSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i)), vlo, vspan)));
+            if (mask != 0)
+            {
+                return i + unsigned(__builtin_ctz(mask));
+            }
+        }
+        auto const r = findRangeScalar(s + i, n - i, lo, span);
+        return r == npos ? npos : i + r;
+    }
+
+    __attribute__((target("sse2"))) void xorRangeSSE2(char *s, size_t n, uint8_t lo, uint8_t span, char bits)
+    {
+        const __m128i vlo = _mm_set1_epi8(char(lo));
+        const __m128i vspan = _mm_set1_epi8(char(span));
+        const __m128i vbits = _mm_set1_epi8(bits);
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            auto const p = reinterpret_cast<__m128i *>(s + i);
+            const __m128i x = _mm_loadu_si128(p);
+            _mm_storeu_si128(p, _mm_xor_si128(x, _mm_and_si128(rangeMaskSSE2(x, vlo, vspan), vbits)));
+        }
+        xorRangeScalar(s + i, n - i, lo, span, bits);
+    }
+
+    /*------------------------------------------------AVX2实现------------------------------------------------------------------------*/
+
+    __attribute__((target("avx2"))) inline __m256i rangeMaskAVX2(__m256i x, __m256i lo, __m256i span)
+    {
+        const __m256i d = _mm256_sub_epi8(x, lo);
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(d, span), d);
+    }
+
+    __attribute__((target("avx2"))) size_t findRangeAVX2(const char *s, size_t n, uint8_t lo, uint8_t span)
+    {
+        const __m256i vlo = _mm256_set1_epi8(char(lo));
+        const __m256i vspan = _mm256_set1_epi8(char(span));
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32)
+        {
+            auto const mask = unsigned(_mm256_movemask_epi8(rangeMaskAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i)), vlo, vspan)));
+            if (mask != 0)
+            {
+                return i + unsigned(__builtin_ctz(mask));
+            }
+        }
+        _mm256_zeroupper();
+        auto const r = findRangeSSE2(s + i, n - i, lo, span);
+        return r == npos ? npos : i + r;
+    }
+
+    __attribute__((target("avx2"))) void xorRangeAVX2(char *s, size_t n, uint8_t lo, uint8_t span, char bits)
+    {
+        const __m256i vlo = _mm256_set1_epi8(char(lo));
+        const __m256i vspan = _mm256_set1_epi8(char(span));
+        const __m256i vbits = _mm256_set1_epi8(bits);
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32)
+        {
+            auto const p = reinterpret_cast<__m256i *>(s + i);
+            const __m256i x = _mm256_loadu_si256(p);
+            _mm256_storeu_si256(p, _mm256_xor_si256(x, _mm256_and_si256(rangeMaskAVX2(x, vlo, vspan), vbits)));
+        }
+        _mm256_zeroupper();
+        xorRangeSSE2(s + i, n - i, lo, span, bits);
+    }
+#endif
+
+    /*------------------------------------------------运行时分发------------------------------------------------------------------------*/
+
+    struct Kernels
+    {
+        hsearch::Level level;
+        FindRangeFn findRange;
+        XorRangeFn xorRange;
+    };
+
+    const Kernels kScalarKernels = {hsearch::Level::Scalar, findRangeScalar, xorRangeScalar};
+#if FOOL_ASCII_X86
+    const Kernels kSSE2Kernels = {hsearch::Level::SSE2, findRangeSSE2, xorRangeSSE2};
+    const Kernels kAVX2Kernels = {hsearch::Level::AVX2, findRangeAVX2, xorRangeAVX2};
+#endif
+
+    const Kernels *kernelsFor(hsearch::Level l)
+    {
+#if FOOL_ASCII_X86
+        switch (l)
+        {
+        case hsearch::Level::AVX2:
+            return &kAVX2Kernels;
+        case hsearch::Level::SSE2:
+            return &kSSE2Kernels;
+        case hsearch::Level::Scalar:
+            break;
+        }
+#endif
+        (void)l;
+        return &kScalarKernels;
+    }
+
+    std::atomic<const Kernels *> gKernels(nullptr);
+
+    const Kernels *kernels()
+    {
+        auto k = gKernels.load(std::memory_order_acquire);
+        if (FOOL_UNLIKELY(k == nullptr))
+        {
+            k = kernelsFor(hsearch::bestLevel());
+            gKernels.store(k, std::memory_order_release);
+        }
+        return k;
+    }
+}
+
+hsearch::Level hascii::level()
+{
+    return kernels()->level;
+}
+
+void hascii::setLevel(hsearch::Level l)
+{
+    auto const best = hsearch::bestLevel();
+    gKernels.store(kernelsFor(static_cast<int>(l) > static_cast<int>(best) ? best : l), std::memory_order_release);
+}
+
+/*------------------------------------------------对外接口------------------------------------------------------------------------*/
+
+size_t hascii::findRange(const char *s, size_t n, char lo, char hi)
+{
+    return kernels()->findRange(s, n, uint8_t(lo), uint8_t(uint8_t(hi) - uint8_t(lo)));
+}
+
+void hascii::xorRange(char *s, size_t n, char lo, char hi, char bits)
+{
+    kernels()->xorRange(s, n, uint8_t(lo), uint8_t(uint8_t(hi) - uint8_t(lo)), bits);
+}
@@ -0,0 +1,103 @@
+#ifndef HXMMXH_ASCII_H
+#define HXMMXH_ASCII_H
+
+#include <cstddef>
+#include <utility>
+
+#include "hsearch.h"
+#include "hstring.h"
+
+// 原地的ASCII变换：to_lower/to_upper/replace_char/trim
+// 先只读地扫一遍，找到第一个需要改的字节才去拿可写的指针（共享的大字符串这时才脱离共享），
+// 从这个字节开始原地改；什么都不用改时字符串保持原样，共享的也不会被复制
+// 扫描和变换都是一次处理16/32个字节：字节减去lo之后无符号地不超过hi - lo就在范围里，命中的字节异或上一个常数
+// 和hsearch一样运行时按CPU选择AVX2、SSE2或者纯标量实现
+namespace fool
+{
+    namespace hascii
+    {
+        constexpr size_t npos = size_t(-1);
+
+        // 级别和hsearch共用同一套定义，但是各自独立设置
+        hsearch::Level level();
+        void setLevel(hsearch::Level l);
+
+        // 第一个在[lo, hi]里的字节的下标，没有时返回npos，按无符号比较
+        size_t findRange(const char *s, size_t n, char lo, char hi);
+        // 所有在[lo, hi]里的字节异或上bits
+        void xorRange(char *s, size_t n, char lo, char hi, char bits);
+    }
+
+    namespace hascii_detail
+    {
+        // 只有真的有字节在[lo, hi]里时才调用非const的data()
+        template <class String>
+        String &xorRange(String &s, char lo, char hi, char bits)
+        {
+            auto const sz = s.size();
+            auto const i = hascii::findRange(std::as_const(s).data(), sz, lo, hi);
+            if (i != hascii::npos)
+            {
+                hascii::xorRange(s.data() + i, sz - i, lo, hi, bits);
+            }
+            return s;
+        }
+
+        inline bool isSpace(char c)
+        {
+            return c == ' ' || (c >= '\t' && c <= '\r');
+        }
+    }
+
+    template <class String>
+    String &to_lower(String &s)
+    {
+        return hascii_detail::xorRange(s, 'A', 'Z', 0x20);
+    }
+
+    template <class String>
+    String &to_upper(String &s)
+    {
+        return hascii_detail::xorRange(s, 'a', 'z', 0x20);
+    }
+
+    template <class String>
+    String &replace_char(String &s, char from, char to)
+    {
+        if (from == to)
+        {
+            return s;
+        }
+        return hascii_detail::xorRange(s, from, from, char(from ^ to));
+    }
+
+    // 去掉两头的ASCII空白（空格和\t\n\v\f\r）
+    // 两头的空白一般只有几个字节，从两头逐个字节看就够了，不需要向量化
+    // 只去掉尾部时直接缩短，开头也要去掉时交给右值的substr，其它的在自己身上移动
+    // 大字符串只有自己持有整块内存时才变成切片（原地写\0），共享的要复制出自己的一份
+    template <class String>
+    String &trim(String &s)
+    {
+        auto const p = std::as_const(s).data();
+        size_t b = 0, e = s.size();
+        while (b < e && hascii_detail::isSpace(p[b]))
+        {
+            ++b;
+        }
+        while (e > b && hascii_detail::isSpace(p[e - 1]))
+        {
+            --e;
+        }
+        if (b != 0)
+        {
+            s = std::move(s).substr(b, e - b);
+        }
+        else if (e != s.size())
+        {
+            s.resize(e);
+        }
+        return s;
+    }
+}
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef HXMMXH_ATOMIC_H
+#define HXMMXH_ATOMIC_H
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <assert.h>
+
+#include "hstring.h"
+
+namespace fool
+{
+    // 一个写者发布、很多读者读取的字符串，比如热加载的配置
+    // 读者不加锁：load()拿到的快照是一份普通的拷贝，大字符串只增加RefCounted里的引用计数
+    //
+    // 回收用的是拆分的引用计数：当前的值放在一个Node里，word_的低48位是Node的地址，高16位是“借出去”的本地计数
+    // 读者先fetch_add本地计数，拿到Node的地址，这时Node一定还活着，拷贝出值之后再把本地计数还回去
+    // 如果还的时候Node已经被换掉，写者换下Node时把借出去的本地计数折算进了Node的全局计数，读者改为减全局计数
+    // Node发布时全局计数预先加上kBias，保证读者先减、写者后折算时计数不会提前减到0
+    template <class String = hstring>
+    class basic_atomic_hstring
+    {
+    public:
+        basic_atomic_hstring() : basic_atomic_hstring(String()) {}
+        explicit basic_atomic_hstring(String value) : word_(pack(makeNode(std::move(value)))) {}
+        // 析构时不能有别的线程还在访问
+        ~basic_atomic_hstring();
+
+        basic_atomic_hstring(const basic_atomic_hstring &) = delete;
+        basic_atomic_hstring &operator=(const basic_atomic_hstring &) = delete;
+
+        // 当前值的快照，之后的store不会影响它
+        String load() const;
+        // f(const String&)在不拷贝的情况下访问当前值，f执行期间这个值不会被释放，f不能保存这个引用
+        template <class F>
+        auto visit(F &&f) const -> decltype(f(std::declval<const String &>()));
+        void store(String value) { exchange(std::move(value)); }
+        // 发布新值，返回原来的值
+        String exchange(String value);
+
+    private:
+        struct Node
+        {
+            explicit Node(String &&v) : refs(1 + kBias), value(std::move(v)) {}
+            std::atomic<size_t> refs;
+            const String value;
+        };
+
+        constexpr static unsigned kCountShift = 48;
+        constexpr static uintptr_t kOne = uintptr_t(1) << kCountShift;
+        constexpr static uintptr_t kPtrMask = kOne - 1;
+        // 同时借出去的本地计数的上限，也就是同时在读的线程数的上限
+        constexpr static size_t kBias = (size_t(1) << (64 - kCountShift)) - 1;
+
+        static Node *makeNode(String &&value)
+        {
+            return new Node(std::move(value));
+        }
+        static uintptr_t pack(Node *n)
+        {
+            auto const p = reinterpret_cast<uintptr_t>(n);
+            assert((p & ~kPtrMask) == 0);
+            return p;
+        }
+        static Node *nodeOf(uintptr_t w) { return reinterpret_cast<Node *>(w & kPtrMask); }
+        static size_t countOf(uintptr_t w) { return size_t(w >> kCountShift); }
+
+        // 借一个本地计数，返回当前的Node
+        Node *acquire() const;
+        // 还回本地计数
+        void release(Node *n) const;
+        static void dropRefs(Node *n, size_t k)
+        {
+            if (n->refs.fetch_sub(k, std::memory_order_acq_rel) == k)
+            {
+                delete n;
+            }
+        }
+
+        mutable std::atomic<uintptr_t> word_;
+    };
+
+    typedef basic_atomic_hstring<> atomic_hstring;
+
+    template <class String>
+    basic_atomic_hstring<String>::~basic_atomic_hstring()
+    {
+        auto const w = word_.load(std::memory_order_acquire);
+        assert(countOf(w) == 0);
+        delete nodeOf(w);
+    }
+
+    template <class String>
+    typename basic_atomic_hstring<String>::Node *basic_atomic_hstring<String>::acquire() const
+    {
+        auto const w = word_.fetch_add(kOne, std::memory_order_acquire);
+        assert(countOf(w) < kBias);
+        return nodeOf(w);
+    }
+
+    template <class String>
+    void basic_atomic_hstring<String>::release(Node *n) const
+    {
+        auto w = word_.load(std::memory_order_relaxed);
+        while (nodeOf(w) == n)
+        {
+            // 持有本地计数时n不会被释放，地址也就不会被新的Node复用，这里不会有ABA的问题
+            assert(countOf(w) > 0);
+            if (word_.compare_exchange_weak(w, w - kOne, std::memory_order_release, std::memory_order_relaxed))
+            {
+                return;
+            }
+        }
+        // 已经被换掉了，写者替我们加过全局计数
+        dropRefs(n, 1);
+    }
+
+    template <class String>
+    String basic_atomic_hstring<String>::load() const
+    {
+        auto const n = acquire();
+        String result(n->value);
+        release(n);
+        return result;
+    }
+
+    template <class String>
+    template <class F>
+    auto basic_atomic_hstring<String>::visit(F &&f) const -> decltype(f(std::declval<const String &>()))
+    {
+        struct Guard
+        {
+            const basic_atomic_hstring *self;
+            Node *n;
+            ~Guard() { self->release(n); }
+        } guard{this, acquire()};
+        return f(guard.n->value);
+    }
+
+    template <class String>
+    String basic_atomic_hstring<String>::exchange(String value)
+    {
+        auto const fresh = makeNode(std::move(value));
+        auto const w = word_.exchange(pack(fresh), std::memory_order_acq_rel);
+        auto const old = nodeOf(w);
+        String result(old->value);
+        // 借出去的L个本地计数折算成全局计数，再去掉预加的kBias和word_持有的那一个：共减去kBias + 1 - L
+        dropRefs(old, kBias + 1 - countOf(w));
+        return result;
+    }
+}
+
+#endif
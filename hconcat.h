@@ -0,0 +1,136 @@
+#ifndef HXMMXH_CONCAT_H
+#define HXMMXH_CONCAT_H
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+#include <assert.h>
+
+#include "hconv.h"
+#include "hstring.h"
+
+// 一次分配的拼接
+// hconcat(tenant, ':', shard, ':', id)先算出总长度，按总长度选好存储方式只扩容一次，再把每一段直接写进去，没有中间的临时字符串
+// 每一段可以是能转换成string_view的字符串（hstring、std::string、字符串字面量等）、单个char或者整数
+// 只有char当作字符，signed char/unsigned char和其他整数一样按十进制输出
+namespace fool
+{
+    namespace hconcat_detail
+    {
+        // 拼接的一段，字符串和char直接引用参数本身，整数先算好位数
+        struct Piece
+        {
+            const char *data; // 整数时是nullptr
+            size_t size;      // 写出来的字符数，整数包括负号
+            uint64_t value;   // 整数的绝对值
+            bool negative;
+        };
+
+        template <class T>
+        inline Piece makePiece(const T &x)
+        {
+            if constexpr (std::is_same<T, char>::value)
+            {
+                return Piece{&x, 1, 0, false};
+            }
+            else if constexpr (std::is_integral<T>::value)
+            {
+                static_assert(!std::is_same<T, bool>::value, "hconcat: bool is ambiguous, convert it explicitly");
+                bool negative;
+                auto const v = hconv_detail::absValue(x, negative);
+                return Piece{nullptr, hconv_detail::digits10(v) + negative, v, negative};
+            }
+            else
+            {
+                std::string_view sv(x);
+                return Piece{sv.data(), sv.size(), 0, false};
+            }
+        }
+
+        // 写完一段，返回下一段的位置
+        inline char *writePiece(const Piece &p, char *out)
+        {
+            if (p.data != nullptr)
+            {
+                if (p.size > 0)
+                {
+                    std::memcpy(out, p.data, p.size);
+                }
+            }
+            else
+            {
+                if (p.negative)
+                {
+                    *out = '-';
+                }
+                hconv_detail::writeDigits(p.value, p.size - p.negative, out + p.negative);
+            }
+            return out + p.size;
+        }
+    }
+
+    // 拼接所有的参数，String是结果的类型
+    template <class String = hstring, class... Args>
+    String hconcat(const Args &... args)
+    {
+        const hconcat_detail::Piece pieces[] = {hconcat_detail::makePiece(args)..., {nullptr, 0, 0, false}};
+        size_t total = 0;
+        for (auto const &p : pieces)
+        {
+            total += p.size;
+        }
+        String result;
+        if (total == 0)
+        {
+            return result;
+        }
+        auto out = result.appendNoinit(total, true);
+        for (size_t i = 0; i < sizeof...(Args); ++i)
+        {
+            out = hconcat_detail::writePiece(pieces[i], out);
+        }
+        assert(out == result.c_str() + total);
+        return result;
+    }
+
+    // 把range里的元素用sep连起来，元素和sep可以是hconcat支持的任何类型
+    // 先遍历一遍算总长度，range需要能遍历两次
+    template <class String = hstring, class Range, class Sep>
+    String hjoin(const Range &range, const Sep &sep)
+    {
+        using std::begin;
+        using std::end;
+        auto const sepPiece = hconcat_detail::makePiece(sep);
+        size_t total = 0;
+        size_t count = 0;
+        for (auto const &x : range)
+        {
+            total += hconcat_detail::makePiece(x).size;
+            ++count;
+        }
+        String result;
+        if (count == 0)
+        {
+            return result;
+        }
+        total += sepPiece.size * (count - 1);
+        if (total == 0)
+        {
+            return result;
+        }
+        auto out = result.appendNoinit(total, true);
+        auto it = begin(range);
+        out = hconcat_detail::writePiece(hconcat_detail::makePiece(*it), out);
+        for (++it; it != end(range); ++it)
+        {
+            out = hconcat_detail::writePiece(sepPiece, out);
+            out = hconcat_detail::writePiece(hconcat_detail::makePiece(*it), out);
+        }
+        assert(out == result.c_str() + total);
+        return result;
+    }
+}
+
+#endif
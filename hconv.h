@@ -0,0 +1,203 @@
+#ifndef HXMMXH_CONV_H
+#define HXMMXH_CONV_H
+
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <assert.h>
+
+#include "hexception.h"
+#include "hstring.h"
+
+// 数字和字符串之间的转换，直接写进字符串的空间里，不经过栈上的缓冲区再拷贝一次
+//   append_int(s, v)      整数按十进制追加，一次除100查两位的表；char和bool不算整数
+//   append_double(s, v)   追加能原样读回来的最短表示（std::to_chars）
+//   to_hstring(v)         上面两个的便捷形式
+//   parse_int/parse_double  从字符串开头解析，失败时抛出std::invalid_argument，越界时抛出std::out_of_range
+namespace fool
+{
+    namespace hconv_detail
+    {
+        // 十进制的位数
+        inline size_t digits10(uint64_t v)
+        {
+            size_t n = 1;
+            for (;;)
+            {
+                // 一次除以10000，少做几次除法
+                if (v < 10)
+                {
+                    return n;
+                }
+                if (v < 100)
+                {
+                    return n + 1;
+                }
+                if (v < 1000)
+                {
+                    return n + 2;
+                }
+                if (v < 10000)
+                {
+                    return n + 3;
+                }
+                v /= 10000;
+                n += 4;
+            }
+        }
+
+        // 把v的十进制写到out开始的n个字符里，n必须等于digits10(v)
+        inline void writeDigits(uint64_t v, size_t n, char *out)
+        {
+            static const char kPairs[] =
+                "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                "8081828384858687888990919293949596979899";
+            auto p = out + n;
+            while (v >= 100)
+            {
+                auto const r = size_t(v % 100) * 2;
+                v /= 100;
+                *--p = kPairs[r + 1];
+                *--p = kPairs[r];
+            }
+            if (v >= 10)
+            {
+                *--p = kPairs[v * 2 + 1];
+                *--p = kPairs[v * 2];
+            }
+            else
+            {
+                *--p = char('0' + v);
+            }
+            assert(p == out);
+        }
+
+        // 整数的绝对值，先转成无符号再取反，最小的负数也不会溢出
+        template <class T>
+        inline uint64_t absValue(T x, bool &negative)
+        {
+            static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value, "hconv: integer required");
+            uint64_t v = static_cast<uint64_t>(x);
+            negative = false;
+            if constexpr (std::is_signed<T>::value)
+            {
+                if (x < 0)
+                {
+                    v = 0 - v;
+                    negative = true;
+                }
+            }
+            return v;
+        }
+
+        // double最短表示的最大长度，比如-2.2250738585072014e-308
+        constexpr size_t kMaxDoubleChars = 24;
+    }
+
+    // 追加整数的十进制，先算出位数，只扩容一次
+    // 和hconcat一样把char当成字符，这里不接受；signed char/unsigned char按整数输出
+    template <class String, class T>
+    String &append_int(String &s, T v)
+    {
+        static_assert(!std::is_same<T, char>::value, "append_int: char is a character, append it with push_back or hconcat");
+        bool negative;
+        auto const u = hconv_detail::absValue(v, negative);
+        auto const n = hconv_detail::digits10(u);
+        auto out = s.appendNoinit(n + negative);
+        if (negative)
+        {
+            *out++ = '-';
+        }
+        hconv_detail::writeDigits(u, n, out);
+        return s;
+    }
+
+    // 追加double的最短表示，读回来和v完全相同；nan和inf按std::to_chars的写法
+    template <class String>
+    String &append_double(String &s, double v)
+    {
+        auto const size = s.size();
+        if (s.capacity() - size >= hconv_detail::kMaxDoubleChars)
+        {
+            // 剩下的空间够写最长的结果，直接写进去再截掉多出来的部分
+            auto const out = s.appendNoinit(hconv_detail::kMaxDoubleChars);
+            auto const r = std::to_chars(out, out + hconv_detail::kMaxDoubleChars, v);
+            assert(r.ec == std::errc());
+            s.resize(size + size_t(r.ptr - out));
+        }
+        else
+        {
+            // 空间不够时按最长的结果扩容会白白把字符串升级，先写在栈上，知道长度之后只扩容一次
+            char buf[hconv_detail::kMaxDoubleChars];
+            auto const r = std::to_chars(buf, buf + sizeof(buf), v);
+            assert(r.ec == std::errc());
+            auto const n = size_t(r.ptr - buf);
+            std::memcpy(s.appendNoinit(n), buf, n);
+        }
+        return s;
+    }
+
+    template <class String = hstring, class T>
+    String to_hstring(T v)
+    {
+        String s;
+        if constexpr (std::is_floating_point<T>::value)
+        {
+            append_double(s, double(v));
+        }
+        else
+        {
+            append_int(s, v);
+        }
+        return s;
+    }
+
+    // 从sv的开头解析一个整数，可以有负号，不跳过空白
+    // consumed不为空时写入用掉的字符数，否则sv必须整个都是数字
+    template <class T = int64_t>
+    T parse_int(std::string_view sv, size_t *consumed = nullptr)
+    {
+        T value;
+        auto const r = std::from_chars(sv.data(), sv.data() + sv.size(), value);
+        if (FOOL_UNLIKELY(r.ec == std::errc::result_out_of_range))
+        {
+            throw_exception<std::out_of_range>("parse_int");
+        }
+        if (FOOL_UNLIKELY(r.ec != std::errc() || (consumed == nullptr && r.ptr != sv.data() + sv.size())))
+        {
+            throw_exception<std::invalid_argument>("parse_int");
+        }
+        if (consumed != nullptr)
+        {
+            *consumed = size_t(r.ptr - sv.data());
+        }
+        return value;
+    }
+
+    // 和parse_int一样，接受定点和科学计数法，以及nan、inf
+    inline double parse_double(std::string_view sv, size_t *consumed = nullptr)
+    {
+        double value;
+        auto const r = std::from_chars(sv.data(), sv.data() + sv.size(), value);
+        if (FOOL_UNLIKELY(r.ec == std::errc::result_out_of_range))
+        {
+            throw_exception<std::out_of_range>("parse_double");
+        }
+        if (FOOL_UNLIKELY(r.ec != std::errc() || (consumed == nullptr && r.ptr != sv.data() + sv.size())))
+        {
+            throw_exception<std::invalid_argument>("parse_double");
+        }
+        if (consumed != nullptr)
+        {
+            *consumed = size_t(r.ptr - sv.data());
+        }
+        return value;
+    }
+}
+
+#endif
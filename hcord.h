@@ -0,0 +1,261 @@
+#ifndef HXMMXH_CORD_H
+#define HXMMXH_CORD_H
+
+#include <deque>
+#include <string_view>
+#include <utility>
+#include <assert.h>
+#include <sys/uio.h>
+
+#include "hstring.h"
+
+namespace fool
+{
+    // 由多个字符串块拼起来的长字符串，拼接时不拷贝数据
+    // 每个块就是一个String，大字符串的块和原来的字符串共享内存，追加/前插一个已有的字符串只增加一次引用计数
+    // 块放在deque里，两头的追加都是O(1)；只有在需要连续内存时才调用flatten()拼成一个字符串
+    // 很短的片段直接并进两头的块里，免得块的数量跟着片段数一起涨
+    template <class String = hstring>
+    class basic_hcord
+    {
+    public:
+        typedef String string_type;
+        typedef typename String::value_type value_type;
+        typedef typename String::size_type size_type;
+        typedef std::basic_string_view<value_type> view_type;
+        typedef typename std::deque<String>::const_iterator const_iterator;
+
+        // 不超过这个长度的片段拷贝进相邻的块，而不是单独成块
+        static constexpr size_type kMaxMergeSize = 128;
+        // 被合并的块最多长到这么大，再大就另起一块，保证合并时的拷贝量有上限
+        static constexpr size_type kMaxMergedChunk = 4096;
+
+        basic_hcord() noexcept {}
+        explicit basic_hcord(const String &s) { append(s); }
+        explicit basic_hcord(String &&s) { append(std::move(s)); }
+        explicit basic_hcord(view_type sv) { append(sv); }
+
+        size_type size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+        void clear()
+        {
+            chunks_.clear();
+            size_ = 0;
+        }
+        void swap(basic_hcord &rhs)
+        {
+            chunks_.swap(rhs.chunks_);
+            std::swap(size_, rhs.size_);
+        }
+
+        // 追加
+        // 短的片段可能直接并进相邻的块，不需要先拷贝一份
+        basic_hcord &append(const String &s) { return s.size() <= kMaxMergeSize ? append(view_type(s.data(), s.size())) : append(String(s)); }
+        basic_hcord &append(String &&s);
+        basic_hcord &append(view_type sv);
+        basic_hcord &append(const value_type *s, size_type n) { return append(view_type(s, n)); }
+        basic_hcord &append(const value_type *s) { return append(view_type(s)); }
+        basic_hcord &append(const basic_hcord &cord);
+        basic_hcord &operator+=(const String &s) { return append(s); }
+        basic_hcord &operator+=(String &&s) { return append(std::move(s)); }
+        basic_hcord &operator+=(view_type sv) { return append(sv); }
+        basic_hcord &operator+=(const value_type *s) { return append(view_type(s)); }
+        basic_hcord &operator+=(const basic_hcord &cord) { return append(cord); }
+
+        // 前插
+        basic_hcord &prepend(const String &s) { return s.size() <= kMaxMergeSize ? prepend(view_type(s.data(), s.size())) : prepend(String(s)); }
+        basic_hcord &prepend(String &&s);
+        basic_hcord &prepend(view_type sv);
+        basic_hcord &prepend(const value_type *s) { return prepend(view_type(s)); }
+        basic_hcord &prepend(const basic_hcord &cord);
+
+        // 块的遍历，每个块都不为空
+        size_type chunkCount() const { return chunks_.size(); }
+        const_iterator begin() const { return chunks_.begin(); }
+        const_iterator end() const { return chunks_.end(); }
+        template <class F>
+        void forEachChunk(F &&f) const
+        {
+            for (auto &c : chunks_)
+            {
+                f(view_type(c.data(), c.size()));
+            }
+        }
+
+        // 从第first个块开始填iovec，最多maxIov个，返回填了几个，配合writev使用
+        size_type fillIovec(struct iovec *iov, size_type maxIov, size_type first = 0) const;
+
+        // 拷贝成一个连续的字符串，只分配一次
+        String toString() const;
+        // 把所有块合并成一个，之后再调用不需要拷贝
+        const String &flatten();
+
+    private:
+        // 能不能把n个字符直接并进块c，和别人共享的块不能并，否则要先把整块拷贝一遍
+        static bool mergeable(const String &c, size_type n)
+        {
+            return n <= kMaxMergeSize && c.size() + n <= kMaxMergedChunk && !c.isShared();
+        }
+
+        std::deque<String> chunks_;
+        size_type size_ = 0;
+    };
+
+    typedef basic_hcord<> hcord;
+
+    template <class String>
+    basic_hcord<String> &basic_hcord<String>::append(String &&s)
+    {
+        auto const n = s.size();
+        if (n == 0)
+        {
+            return *this;
+        }
+        if (!chunks_.empty() && mergeable(chunks_.back(), n))
+        {
+            chunks_.back().append(s);
+        }
+        else
+        {
+            chunks_.push_back(std::move(s));
+        }
+        size_ += n;
+        return *this;
+    }
+
+    template <class String>
+    basic_hcord<String> &basic_hcord<String>::append(view_type sv)
+    {
+        if (sv.empty())
+        {
+            return *this;
+        }
+        if (!chunks_.empty() && mergeable(chunks_.back(), sv.size()))
+        {
+            chunks_.back().append(sv.data(), sv.size());
+        }
+        else
+        {
+            chunks_.emplace_back(sv.data(), sv.size());
+        }
+        size_ += sv.size();
+        return *this;
+    }
+
+    template <class String>
+    basic_hcord<String> &basic_hcord<String>::append(const basic_hcord &cord)
+    {
+        if (&cord == this)
+        {
+            return append(basic_hcord(cord));
+        }
+        for (auto &c : cord.chunks_)
+        {
+            append(c);
+        }
+        return *this;
+    }
+
+    template <class String>
+    basic_hcord<String> &basic_hcord<String>::prepend(String &&s)
+    {
+        auto const n = s.size();
+        if (n == 0)
+        {
+            return *this;
+        }
+        if (!chunks_.empty() && mergeable(chunks_.front(), n))
+        {
+            chunks_.front().insert(0, s.data(), s.size());
+        }
+        else
+        {
+            chunks_.push_front(std::move(s));
+        }
+        size_ += n;
+        return *this;
+    }
+
+    template <class String>
+    basic_hcord<String> &basic_hcord<String>::prepend(view_type sv)
+    {
+        if (sv.empty())
+        {
+            return *this;
+        }
+        if (!chunks_.empty() && mergeable(chunks_.front(), sv.size()))
+        {
+            chunks_.front().insert(0, sv.data(), sv.size());
+        }
+        else
+        {
+            chunks_.emplace_front(sv.data(), sv.size());
+        }
+        size_ += sv.size();
+        return *this;
+    }
+
+    template <class String>
+    basic_hcord<String> &basic_hcord<String>::prepend(const basic_hcord &cord)
+    {
+        if (&cord == this)
+        {
+            return prepend(basic_hcord(cord));
+        }
+        for (auto it = cord.chunks_.rbegin(); it != cord.chunks_.rend(); ++it)
+        {
+            prepend(*it);
+        }
+        return *this;
+    }
+
+    template <class String>
+    typename basic_hcord<String>::size_type basic_hcord<String>::fillIovec(struct iovec *iov, size_type maxIov, size_type first) const
+    {
+        size_type n = 0;
+        for (size_type i = first; i < chunks_.size() && n < maxIov; ++i, ++n)
+        {
+            auto const &c = chunks_[i];
+            iov[n].iov_base = const_cast<value_type *>(c.data());
+            iov[n].iov_len = c.size();
+        }
+        return n;
+    }
+
+    template <class String>
+    String basic_hcord<String>::toString() const
+    {
+        if (chunks_.size() == 1)
+        {
+            // 只有一块时就是这个块的拷贝，大字符串只增加引用计数
+            return chunks_.front();
+        }
+        String result;
+        result.reserve(size_);
+        for (auto &c : chunks_)
+        {
+            result.append(c.data(), c.size());
+        }
+        assert(result.size() == size_);
+        return result;
+    }
+
+    template <class String>
+    const String &basic_hcord<String>::flatten()
+    {
+        if (chunks_.empty())
+        {
+            static const String kEmpty;
+            return kEmpty;
+        }
+        if (chunks_.size() > 1)
+        {
+            String s = toString();
+            chunks_.clear();
+            chunks_.push_back(std::move(s));
+        }
+        return chunks_.front();
+    }
+}
+
+#endif
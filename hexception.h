@@ -0,0 +1,16 @@
+#ifndef HXMMXH_EXCEPTION_H
+#define HXMMXH_EXCEPTION_H
+
+#include <utility>
+
+namespace fool
+{
+    // 统一的抛异常入口，把throw放在一个不内联的函数里，调用处只剩一条call指令，热路径更紧凑
+    template <class Ex, class... Args>
+    [[noreturn]] __attribute__((noinline, cold)) void throw_exception(Args &&...args)
+    {
+        throw Ex(std::forward<Args>(args)...);
+    }
+}
+
+#endif
@@ -0,0 +1,603 @@
+#ifndef HXMMXH_FLAT_MAP_H
+#define HXMMXH_FLAT_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <assert.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "hexception.h"
+#include "hmalloc.h"
+#include "hstring.h"
+#include "likely.h"
+
+namespace fool
+{
+    // 以hstring为键的开放寻址哈希表，元素直接放在一个数组里，没有节点分配
+    // 每个槽位有一个控制字节：空、删除过、或者哈希值的低7位；16个槽位一组，一条SSE2指令比较一组的控制字节，
+    // 只有低7位相同的槽位才去比较键，大部分不命中的探测不会碰到键本身
+    // 哈希值用hstring::hash()：小字符串直接在对象里的small_上算，大字符串的哈希值缓存在共享的RefCounted里，
+    // 同一个大字符串的拷贝拿来查找或者扩容时重新放置都不用再算
+    // 查找可以直接用std::string_view，不需要先构造一个hstring
+    // 和std::unordered_map不同，插入导致扩容时所有的迭代器和引用都会失效
+    template <class V, class String = hstring>
+    class flat_hstring_map
+    {
+        template <bool kConst>
+        class Iterator;
+
+    public:
+        typedef String key_type;
+        typedef V mapped_type;
+        typedef std::pair<const String, V> value_type;
+        typedef size_t size_type;
+        typedef Iterator<false> iterator;
+        typedef Iterator<true> const_iterator;
+
+        flat_hstring_map() noexcept {}
+        explicit flat_hstring_map(size_type n) { reserve(n); }
+        flat_hstring_map(const flat_hstring_map &rhs);
+        flat_hstring_map(flat_hstring_map &&rhs) noexcept { swap(rhs); }
+        ~flat_hstring_map() { destroy(); }
+
+        flat_hstring_map &operator=(const flat_hstring_map &rhs)
+        {
+            if (this != &rhs)
+            {
+                flat_hstring_map(rhs).swap(*this);
+            }
+            return *this;
+        }
+        flat_hstring_map &operator=(flat_hstring_map &&rhs) noexcept
+        {
+            flat_hstring_map(std::move(rhs)).swap(*this);
+            return *this;
+        }
+
+        // 大小和容量
+        size_type size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+        // 槽位的个数，最多装到7/8
+        size_type capacity() const { return capacity_; }
+        // 保证放得下n个元素，之后插入到n个以前不会扩容
+        void reserve(size_type n);
+        void clear();
+        void swap(flat_hstring_map &rhs) noexcept;
+
+        // 迭代器
+        iterator begin() { return iterator(ctrl_, slots_, capacity_); }
+        iterator end() { return iterator(ctrl_ + capacity_, slots_ + capacity_, 0); }
+        const_iterator begin() const { return const_iterator(ctrl_, slots_, capacity_); }
+        const_iterator end() const { return const_iterator(ctrl_ + capacity_, slots_ + capacity_, 0); }
+        const_iterator cbegin() const { return begin(); }
+        const_iterator cend() const { return end(); }
+
+        // 查找，键可以是String或者能转换成std::string_view的类型
+        template <class K>
+        iterator find(const K &key) { return iteratorAt(findIndex(key)); }
+        template <class K>
+        const_iterator find(const K &key) const { return iteratorAt(findIndex(key)); }
+        template <class K>
+        bool contains(const K &key) const { return findIndex(key) != kNotFound; }
+        template <class K>
+        size_type count(const K &key) const { return contains(key) ? 1 : 0; }
+        template <class K>
+        V &at(const K &key);
+        template <class K>
+        const V &at(const K &key) const;
+
+        // 插入，键已经存在时什么都不做，返回已有的元素
+        // 键是std::string_view时只有真的插入才构造String
+        template <class K, class... Args>
+        std::pair<iterator, bool> try_emplace(K &&key, Args &&... args);
+        std::pair<iterator, bool> insert(const value_type &v) { return try_emplace(v.first, v.second); }
+        std::pair<iterator, bool> insert(std::pair<String, V> &&v) { return try_emplace(std::move(v.first), std::move(v.second)); }
+        template <class K, class M>
+        std::pair<iterator, bool> insert_or_assign(K &&key, M &&value);
+        template <class K>
+        V &operator[](K &&key) { return try_emplace(std::forward<K>(key)).first->second; }
+
+        // 删除
+        template <class K>
+        size_type erase(const K &key);
+        // 返回下一个元素
+        iterator erase(const_iterator pos);
+        iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+    private:
+        // 控制字节：最高位为1的是空槽或者删除过的槽，0-127是占用的槽里键的哈希值低7位
+        constexpr static int8_t kEmpty = -128;
+        constexpr static int8_t kDeleted = -2;
+        constexpr static size_t kGroupWidth = 16;
+        constexpr static size_t kNotFound = size_t(-1);
+
+        // 键和值放在一起，对外是pair<const String, V>，内部搬动时当作pair<String, V>
+        union Slot
+        {
+            value_type value;
+            std::pair<String, V> mutableValue;
+
+            Slot() {}
+            ~Slot() {}
+        };
+
+        // 一组16个控制字节，match返回的每一位对应一个槽位
+        class Group
+        {
+        public:
+            explicit Group(const int8_t *ctrl);
+            unsigned match(int8_t h2) const;
+            unsigned matchEmpty() const;
+            unsigned matchEmptyOrDeleted() const;
+
+        private:
+#if defined(__SSE2__)
+            __m128i ctrl_;
+#else
+            const int8_t *ctrl_;
+#endif
+        };
+
+        template <bool kConst>
+        class Iterator
+        {
+            friend class flat_hstring_map;
+            template <bool>
+            friend class Iterator;
+
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef typename flat_hstring_map::value_type value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef typename std::conditional<kConst, const value_type, value_type>::type &reference;
+            typedef typename std::conditional<kConst, const value_type, value_type>::type *pointer;
+
+            Iterator() = default;
+            // iterator可以转换成const_iterator
+            template <bool kOther, class = typename std::enable_if<kConst && !kOther>::type>
+            Iterator(const Iterator<kOther> &rhs) : ctrl_(rhs.ctrl_), slot_(rhs.slot_), left_(rhs.left_) {}
+
+            reference operator*() const { return slot_->value; }
+            pointer operator->() const { return &slot_->value; }
+            Iterator &operator++()
+            {
+                ++ctrl_, ++slot_, --left_;
+                skipEmpty();
+                return *this;
+            }
+            Iterator operator++(int)
+            {
+                auto tmp = *this;
+                ++*this;
+                return tmp;
+            }
+            friend bool operator==(const Iterator &a, const Iterator &b) { return a.ctrl_ == b.ctrl_; }
+            friend bool operator!=(const Iterator &a, const Iterator &b) { return a.ctrl_ != b.ctrl_; }
+
+        private:
+            // left是从这个位置到表尾的槽位数
+            Iterator(const int8_t *ctrl, Slot *slot, size_t left) : ctrl_(ctrl), slot_(slot), left_(left) { skipEmpty(); }
+            void skipEmpty()
+            {
+                while (left_ > 0 && *ctrl_ < 0)
+                {
+                    ++ctrl_, ++slot_, --left_;
+                }
+            }
+
+            const int8_t *ctrl_ = nullptr;
+            Slot *slot_ = nullptr;
+            size_t left_ = 0;
+        };
+
+        static size_t hashOf(const String &key) { return key.hash(); }
+        static size_t hashOf(std::string_view key) { return std::hash<std::string_view>()(key); }
+        static int8_t h2(size_t hash) { return int8_t(hash & 0x7F); }
+        static bool keyEquals(const String &k, std::string_view key)
+        {
+            std::string_view const sv(k);
+            return sv.size() == key.size() && std::memcmp(sv.data(), key.data(), key.size()) == 0;
+        }
+        // 装满7/8的槽位之后就扩容，保证每次探测最后都能碰到空槽
+        static size_t maxLoad(size_t capacity) { return capacity - capacity / 8; }
+        // 放得下n个元素的最小容量，至少一组，总是2的幂
+        static size_t capacityFor(size_t n);
+
+        template <class K>
+        size_t findIndex(const K &key) const;
+        size_t findIndex(std::string_view key, size_t hash) const;
+        // 找一个可以放hash的空槽或者删除过的槽，调用前保证表里还有空槽
+        size_t findSlotForInsert(size_t hash) const;
+        // 插入前调用，空槽用完时扩容或者就地清理删除标记
+        void prepareInsert();
+        void rehash(size_t newCapacity);
+        void destroy() noexcept;
+
+        iterator iteratorAt(size_t i) { return i == kNotFound ? end() : iterator(ctrl_ + i, slots_ + i, capacity_ - i); }
+        const_iterator iteratorAt(size_t i) const { return i == kNotFound ? end() : const_iterator(ctrl_ + i, slots_ + i, capacity_ - i); }
+
+        // 槽位和控制字节在同一块内存里，槽位在前
+        Slot *slots_ = nullptr;
+        int8_t *ctrl_ = nullptr;
+        size_t capacity_ = 0;
+        size_t size_ = 0;
+        // 还能占用的空槽数，删除标记不算空槽
+        size_t growthLeft_ = 0;
+    };
+
+    /*------------------------------------------------Group------------------------------------------------------------------------*/
+
+#if defined(__SSE2__)
+    template <class V, class String>
+    flat_hstring_map<V, String>::Group::Group(const int8_t *ctrl) : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl)))
+    {
+    }
+
+    template <class V, class String>
+    unsigned flat_hstring_map<V, String>::Group::match(int8_t h2) const
+    {
+        return unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl_, _mm_set1_epi8(h2))));
+    }
+
+    template <class V, class String>
+    unsigned flat_hstring_map<V, String>::Group::matchEmpty() const
+    {
+        return unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl_, _mm_set1_epi8(kEmpty))));
+    }
+
+    template <class V, class String>
+    unsigned flat_hstring_map<V, String>::Group::matchEmptyOrDeleted() const
+    {
+        // 空槽和删除标记的最高位都是1
+        return unsigned(_mm_movemask_epi8(ctrl_));
+    }
+#else
+    template <class V, class String>
+    flat_hstring_map<V, String>::Group::Group(const int8_t *ctrl) : ctrl_(ctrl)
+    {
+    }
+
+    template <class V, class String>
+    unsigned flat_hstring_map<V, String>::Group::match(int8_t h2) const
+    {
+        unsigned mask = 0;
+        for (size_t i = 0; i < kGroupWidth; ++i)
+        {
+            mask |= unsigned(ctrl_[i] == h2) << i;
+        }
+        return mask;
+    }
+
+    template <class V, class String>
+    unsigned flat_hstring_map<V, String>::Group::matchEmpty() const
+    {
+        return match(kEmpty);
+    }
+
+    template <class V, class String>
+    unsigned flat_hstring_map<V, String>::Group::matchEmptyOrDeleted() const
+    {
+        unsigned mask = 0;
+        for (size_t i = 0; i < kGroupWidth; ++i)
+        {
+            mask |= unsigned(ctrl_[i] < 0) << i;
+        }
+        return mask;
+    }
+#endif
+
+    /*------------------------------------------------构造和容量------------------------------------------------------------------------*/
+
+    template <class V, class String>
+    flat_hstring_map<V, String>::flat_hstring_map(const flat_hstring_map &rhs)
+    {
+        reserve(rhs.size());
+        for (auto const &v : rhs)
+        {
+            // 大字符串的键拷贝只加引用计数，哈希值也是缓存的
+            try_emplace(v.first, v.second);
+        }
+    }
+
+    template <class V, class String>
+    size_t flat_hstring_map<V, String>::capacityFor(size_t n)
+    {
+        size_t cap = kGroupWidth;
+        while (maxLoad(cap) < n)
+        {
+            cap *= 2;
+        }
+        return cap;
+    }
+
+    template <class V, class String>
+    void flat_hstring_map<V, String>::reserve(size_type n)
+    {
+        if (n > size_ + growthLeft_)
+        {
+            rehash(capacityFor(n));
+        }
+    }
+
+    template <class V, class String>
+    void flat_hstring_map<V, String>::clear()
+    {
+        for (size_t i = 0; i < capacity_; ++i)
+        {
+            if (ctrl_[i] >= 0)
+            {
+                slots_[i].mutableValue.~pair();
+            }
+        }
+        if (capacity_ > 0)
+        {
+            std::memset(ctrl_, kEmpty, capacity_);
+        }
+        size_ = 0;
+        growthLeft_ = maxLoad(capacity_);
+    }
+
+    template <class V, class String>
+    void flat_hstring_map<V, String>::swap(flat_hstring_map &rhs) noexcept
+    {
+        std::swap(slots_, rhs.slots_);
+        std::swap(ctrl_, rhs.ctrl_);
+        std::swap(capacity_, rhs.capacity_);
+        std::swap(size_, rhs.size_);
+        std::swap(growthLeft_, rhs.growthLeft_);
+    }
+
+    template <class V, class String>
+    void flat_hstring_map<V, String>::destroy() noexcept
+    {
+        if (capacity_ == 0)
+        {
+            return;
+        }
+        for (size_t i = 0; i < capacity_; ++i)
+        {
+            if (ctrl_[i] >= 0)
+            {
+                slots_[i].mutableValue.~pair();
+            }
+        }
+        sizedFree(slots_, capacity_ * (sizeof(Slot) + 1));
+    }
+
+    template <class V, class String>
+    void flat_hstring_map<V, String>::rehash(size_t newCapacity)
+    {
+        assert(newCapacity >= kGroupWidth && (newCapacity & (newCapacity - 1)) == 0 && maxLoad(newCapacity) >= size_);
+        static_assert(alignof(Slot) <= alignof(std::max_align_t), "flat_hstring_map: over-aligned value type");
+        auto const oldSlots = slots_;
+        auto const oldCtrl = ctrl_;
+        auto const oldCapacity = capacity_;
+        slots_ = static_cast<Slot *>(checkedMalloc(newCapacity * (sizeof(Slot) + 1)));
+        ctrl_ = reinterpret_cast<int8_t *>(slots_ + newCapacity);
+        std::memset(ctrl_, kEmpty, newCapacity);
+        capacity_ = newCapacity;
+        growthLeft_ = maxLoad(newCapacity) - size_;
+        for (size_t i = 0; i < oldCapacity; ++i)
+        {
+            if (oldCtrl[i] >= 0)
+            {
+                // 键的哈希值：小字符串重新算一遍很便宜，大字符串是缓存的
+                auto &src = oldSlots[i].mutableValue;
+                auto const hash = hashOf(src.first);
+                auto const j = findSlotForInsert(hash);
+                ctrl_[j] = h2(hash);
+                new (&slots_[j].mutableValue) std::pair<String, V>(std::move(src));
+                src.~pair();
+            }
+        }
+        if (oldCapacity > 0)
+        {
+            sizedFree(oldSlots, oldCapacity * (sizeof(Slot) + 1));
+        }
+    }
+
+    /*------------------------------------------------查找------------------------------------------------------------------------*/
+
+    // 探测序列按组走：从哈希值高位选出的组开始，第k次跳过k组，组数是2的幂时能走遍所有的组
+    // 一组里有空槽就说明插入时没有越过这一组，查找可以到此为止
+
+    template <class V, class String>
+    template <class K>
+    size_t flat_hstring_map<V, String>::findIndex(const K &key) const
+    {
+        if (FOOL_UNLIKELY(size_ == 0))
+        {
+            return kNotFound;
+        }
+        if constexpr (std::is_same<K, String>::value)
+        {
+            return findIndex(std::string_view(key), hashOf(key));
+        }
+        else
+        {
+            std::string_view const sv(key);
+            return findIndex(sv, hashOf(sv));
+        }
+    }
+
+    template <class V, class String>
+    size_t flat_hstring_map<V, String>::findIndex(std::string_view key, size_t hash) const
+    {
+        auto const groupMask = capacity_ / kGroupWidth - 1;
+        auto g = (hash >> 7) & groupMask;
+        for (size_t step = 1;; ++step)
+        {
+            const Group group(ctrl_ + g * kGroupWidth);
+            for (auto m = group.match(h2(hash)); m != 0; m &= m - 1)
+            {
+                auto const i = g * kGroupWidth + unsigned(__builtin_ctz(m));
+                if (FOOL_LIKELY(keyEquals(slots_[i].value.first, key)))
+                {
+                    return i;
+                }
+            }
+            if (FOOL_LIKELY(group.matchEmpty() != 0))
+            {
+                return kNotFound;
+            }
+            assert(step <= capacity_ / kGroupWidth);
+            g = (g + step) & groupMask;
+        }
+    }
+
+    template <class V, class String>
+    size_t flat_hstring_map<V, String>::findSlotForInsert(size_t hash) const
+    {
+        auto const groupMask = capacity_ / kGroupWidth - 1;
+        auto g = (hash >> 7) & groupMask;
+        for (size_t step = 1;; ++step)
+        {
+            auto const m = Group(ctrl_ + g * kGroupWidth).matchEmptyOrDeleted();
+            if (m != 0)
+            {
+                return g * kGroupWidth + unsigned(__builtin_ctz(m));
+            }
+            assert(step <= capacity_ / kGroupWidth);
+            g = (g + step) & groupMask;
+        }
+    }
+
+    template <class V, class String>
+    template <class K>
+    V &flat_hstring_map<V, String>::at(const K &key)
+    {
+        auto const i = findIndex(key);
+        if (i == kNotFound)
+        {
+            throw_exception<std::out_of_range>("flat_hstring_map::at");
+        }
+        return slots_[i].value.second;
+    }
+
+    template <class V, class String>
+    template <class K>
+    const V &flat_hstring_map<V, String>::at(const K &key) const
+    {
+        auto const i = findIndex(key);
+        if (i == kNotFound)
+        {
+            throw_exception<std::out_of_range>("flat_hstring_map::at");
+        }
+        return slots_[i].value.second;
+    }
+
+    /*------------------------------------------------插入和删除------------------------------------------------------------------------*/
+
+    template <class V, class String>
+    void flat_hstring_map<V, String>::prepareInsert()
+    {
+        if (FOOL_LIKELY(growthLeft_ > 0))
+        {
+            return;
+        }
+        // 空槽用完了：删除标记多于一半时原地清理，否则容量翻倍
+        auto const cap = capacity_ == 0 ? kGroupWidth : (size_ * 2 <= maxLoad(capacity_) ? capacity_ : capacity_ * 2);
+        rehash(cap);
+    }
+
+    template <class V, class String>
+    template <class K, class... Args>
+    std::pair<typename flat_hstring_map<V, String>::iterator, bool> flat_hstring_map<V, String>::try_emplace(K &&key, Args &&... args)
+    {
+        typedef typename std::decay<K>::type Key;
+        size_t hash;
+        std::string_view sv;
+        if constexpr (std::is_same<Key, String>::value)
+        {
+            sv = std::string_view(key);
+            hash = hashOf(key);
+        }
+        else
+        {
+            sv = std::string_view(key);
+            hash = hashOf(sv);
+        }
+        auto i = size_ == 0 ? kNotFound : findIndex(sv, hash);
+        if (i != kNotFound)
+        {
+            return {iteratorAt(i), false};
+        }
+        prepareInsert();
+        i = findSlotForInsert(hash);
+        auto &slot = slots_[i];
+        if constexpr (std::is_same<Key, String>::value)
+        {
+            new (&slot.mutableValue) std::pair<String, V>(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                                                          std::forward_as_tuple(std::forward<Args>(args)...));
+        }
+        else
+        {
+            new (&slot.mutableValue) std::pair<String, V>(std::piecewise_construct, std::forward_as_tuple(sv.data(), sv.size()),
+                                                          std::forward_as_tuple(std::forward<Args>(args)...));
+        }
+        // 构造成功之后才修改控制字节，构造时抛出异常表保持原样
+        growthLeft_ -= ctrl_[i] == kEmpty;
+        ctrl_[i] = h2(hash);
+        ++size_;
+        return {iteratorAt(i), true};
+    }
+
+    template <class V, class String>
+    template <class K, class M>
+    std::pair<typename flat_hstring_map<V, String>::iterator, bool> flat_hstring_map<V, String>::insert_or_assign(K &&key, M &&value)
+    {
+        auto r = try_emplace(std::forward<K>(key), std::forward<M>(value));
+        if (!r.second)
+        {
+            r.first->second = std::forward<M>(value);
+        }
+        return r;
+    }
+
+    template <class V, class String>
+    template <class K>
+    typename flat_hstring_map<V, String>::size_type flat_hstring_map<V, String>::erase(const K &key)
+    {
+        auto const i = findIndex(key);
+        if (i == kNotFound)
+        {
+            return 0;
+        }
+        erase(iteratorAt(i));
+        return 1;
+    }
+
+    template <class V, class String>
+    typename flat_hstring_map<V, String>::iterator flat_hstring_map<V, String>::erase(const_iterator pos)
+    {
+        auto const i = size_t(pos.ctrl_ - ctrl_);
+        assert(i < capacity_ && ctrl_[i] >= 0);
+        slots_[i].mutableValue.~pair();
+        --size_;
+        // 所在的组里原来就有空槽时，没有探测会越过这一组，可以直接标成空槽
+        auto const group = i & ~(kGroupWidth - 1);
+        if (Group(ctrl_ + group).matchEmpty() != 0)
+        {
+            ctrl_[i] = kEmpty;
+            ++growthLeft_;
+        }
+        else
+        {
+            ctrl_[i] = kDeleted;
+        }
+        return iterator(ctrl_ + i, slots_ + i, capacity_ - i);
+    }
+}
+
+#endif
@@ -0,0 +1,112 @@
+#include "hinterner.h"
+
+#include <mutex>
+#include <utility>
+
+using namespace fool;
+
+hstring hstring_interner::intern(std::string_view sv)
+{
+    // 放得进对象里的小字符串不驻留
+    if (sv.size() <= hstring::inline_capacity)
+    {
+        return hstring(sv);
+    }
+    auto const hash = std::hash<std::string_view>()(sv);
+    auto &shard = shardOf(hash);
+    shard.lookups.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::shared_lock<std::shared_mutex> guard(shard.mutex);
+        auto const it = shard.map.find(sv);
+        if (it != shard.map.end())
+        {
+            shard.hits.fetch_add(1, std::memory_order_relaxed);
+            shard.bytesSaved.fetch_add(sv.size(), std::memory_order_relaxed);
+            return it->second;
+        }
+    }
+    // 在锁外面分配，写锁里只做插入
+    hstring value(sv.data(), sv.size(), RefCountedStorage());
+    std::unique_lock<std::shared_mutex> guard(shard.mutex);
+    // 放掉读锁之后别的线程可能已经插进去了
+    auto const it = shard.map.find(sv);
+    if (it != shard.map.end())
+    {
+        shard.hits.fetch_add(1, std::memory_order_relaxed);
+        shard.bytesSaved.fetch_add(sv.size(), std::memory_order_relaxed);
+        return it->second;
+    }
+    std::string_view const key(std::as_const(value).data(), value.size());
+    shard.bytes += key.size();
+    return shard.map.emplace(key, std::move(value)).first->second;
+}
+
+bool hstring_interner::contains(std::string_view sv) const
+{
+    auto const &shard = shardOf(std::hash<std::string_view>()(sv));
+    std::shared_lock<std::shared_mutex> guard(shard.mutex);
+    return shard.map.count(sv) != 0;
+}
+
+size_t hstring_interner::purge()
+{
+    size_t n = 0;
+    for (auto &shard : shards_)
+    {
+        std::unique_lock<std::shared_mutex> guard(shard.mutex);
+        for (auto it = shard.map.begin(); it != shard.map.end();)
+        {
+            // 拿着写锁，没有人能再从池子里拷贝，引用计数为1就只剩池子自己
+            if (!it->second.isShared())
+            {
+                shard.bytes -= it->second.size();
+                it = shard.map.erase(it);
+                ++n;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+    return n;
+}
+
+void hstring_interner::clear()
+{
+    for (auto &shard : shards_)
+    {
+        std::unique_lock<std::shared_mutex> guard(shard.mutex);
+        shard.map.clear();
+        shard.bytes = 0;
+        shard.lookups.store(0, std::memory_order_relaxed);
+        shard.hits.store(0, std::memory_order_relaxed);
+        shard.bytesSaved.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t hstring_interner::size() const
+{
+    size_t n = 0;
+    for (auto &shard : shards_)
+    {
+        std::shared_lock<std::shared_mutex> guard(shard.mutex);
+        n += shard.map.size();
+    }
+    return n;
+}
+
+hstring_interner::Stats hstring_interner::stats() const
+{
+    Stats s{0, 0, 0, 0, 0};
+    for (auto &shard : shards_)
+    {
+        std::shared_lock<std::shared_mutex> guard(shard.mutex);
+        s.lookups += shard.lookups.load(std::memory_order_relaxed);
+        s.hits += shard.hits.load(std::memory_order_relaxed);
+        s.bytesSaved += shard.bytesSaved.load(std::memory_order_relaxed);
+        s.entries += shard.map.size();
+        s.bytes += shard.bytes;
+    }
+    return s;
+}
@@ -0,0 +1,68 @@
+#ifndef HXMMXH_INTERNER_H
+#define HXMMXH_INTERNER_H
+
+#include <atomic>
+#include <cstddef>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+
+#include "hstring.h"
+
+namespace fool
+{
+    // 字符串驻留池：同一个值只保存一份，intern返回的都是这一份的拷贝
+    // 超过小字符串长度的值用引用计数存储（RefCountedStorage），拷贝只增加引用计数，重复的值最后只占一次分配
+    // 小字符串本身就存在对象里，拷贝没有分配，直接构造返回，不进池子
+    // 按哈希值分成kShards个分片，每个分片一把读写锁，命中只需要读锁
+    class hstring_interner
+    {
+    public:
+        static constexpr size_t kShards = 64;
+
+        struct Stats
+        {
+            size_t lookups;    // 进池子查找的次数（不含小字符串）
+            size_t hits;       // 其中命中的次数
+            size_t entries;    // 池子里不同的值的个数
+            size_t bytes;      // 池子里保存的字符总数
+            size_t bytesSaved; // 命中时省下的字符数，也就是不驻留时多出来的拷贝
+
+            double hitRate() const { return lookups == 0 ? 0.0 : double(hits) / double(lookups); }
+        };
+
+        hstring_interner() = default;
+        hstring_interner(const hstring_interner &) = delete;
+        hstring_interner &operator=(const hstring_interner &) = delete;
+
+        // 查找时直接用string_view，不会先构造一个临时的hstring
+        hstring intern(std::string_view sv);
+        bool contains(std::string_view sv) const;
+
+        // 释放只剩池子自己持有的值，返回释放的个数
+        size_t purge();
+        // 清空池子和统计数据
+        void clear();
+        size_t size() const;
+        Stats stats() const;
+
+    private:
+        struct alignas(64) Shard
+        {
+            mutable std::shared_mutex mutex;
+            // 键指向值在堆上的数据，值不会被修改，地址一直有效
+            std::unordered_map<std::string_view, hstring> map;
+            size_t bytes = 0;
+            std::atomic<size_t> lookups{0};
+            std::atomic<size_t> hits{0};
+            std::atomic<size_t> bytesSaved{0};
+        };
+
+        Shard &shardOf(size_t hash) { return shards_[(hash >> 7) % kShards]; }
+        const Shard &shardOf(size_t hash) const { return shards_[(hash >> 7) % kShards]; }
+
+        Shard shards_[kShards];
+    };
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include "hio.h"
+#include "hexception.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <system_error>
+
+using namespace fool;
+
+namespace
+{
+    [[noreturn]] void throwErrno(const char *what)
+    {
+        throw_exception<std::system_error>(errno, std::generic_category(), what);
+    }
+}
+
+size_t hio::readSome(int fd, char *buf, size_t n)
+{
+    for (;;)
+    {
+        auto const r = ::read(fd, buf, n);
+        if (r >= 0)
+        {
+            return size_t(r);
+        }
+        if (errno != EINTR)
+        {
+            throwErrno("hio::readSome");
+        }
+    }
+}
+
+void hio::writevAll(int fd, struct iovec *iov, size_t n)
+{
+    while (n > 0)
+    {
+        auto const r = ::writev(fd, iov, int(std::min<size_t>(n, IOV_MAX)));
+        if (r < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throwErrno("hio::writevAll");
+        }
+        // 跳过已经写完的部分
+        auto done = size_t(r);
+        while (n > 0 && done >= iov->iov_len)
+        {
+            done -= iov->iov_len;
+            ++iov;
+            --n;
+        }
+        if (n > 0)
+        {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + done;
+            iov->iov_len -= done;
+        }
+    }
+}
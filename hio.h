@@ -0,0 +1,201 @@
+#ifndef HXMMXH_IO_H
+#define HXMMXH_IO_H
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <assert.h>
+#include <sys/uio.h>
+
+#include "hstring.h"
+
+// 文件描述符和hstring之间的读写，数据直接读进字符串没有初始化的容量里，不经过中间的缓冲区
+// 系统调用出错时抛std::system_error，EINTR自动重试
+namespace fool
+{
+    namespace hio
+    {
+        // 最多读n个字节到buf，返回读到的字节数，0表示文件结束
+        size_t readSome(int fd, char *buf, size_t n);
+        // 把iov里的数据全部写出去，部分写入时接着写剩下的，iov的内容会被修改
+        void writevAll(int fd, struct iovec *iov, size_t n);
+
+        // 最多读n个字节追加到s后面，返回读到的字节数，0表示文件结束
+        // 扩容按字符串原来的指数增长，读完再把没用上的尾巴截掉
+        template <class String>
+        size_t readAppend(int fd, String &s, size_t n)
+        {
+            auto const size = s.size();
+            auto const out = s.appendNoinit(n);
+            size_t got = 0;
+            try
+            {
+                got = readSome(fd, out, n);
+            }
+            catch (...)
+            {
+                s.resize(size);
+                throw;
+            }
+            s.resize(size + got);
+            return got;
+        }
+
+        // 一直读到文件结束，追加到s后面，返回读到的字节数
+        // sizeHint是预计的长度（比如文件大小），给对了只需要分配一次
+        template <class String>
+        size_t readAll(int fd, String &s, size_t sizeHint = 0)
+        {
+            // 剩下的空间不多时先读进栈上的小缓冲区，如果已经到了文件结尾就不用为了确认这一点而扩容
+            constexpr size_t kProbe = 4096;
+            // 确定后面还有数据时每次至少读这么多
+            constexpr size_t kMinRead = 16 * 1024;
+            auto const start = s.size();
+            if (sizeHint > 0)
+            {
+                s.reserve(start + sizeHint);
+            }
+            // 上一次读满了，后面多半还有数据
+            bool more = false;
+            for (;;)
+            {
+                auto const spare = s.capacity() - s.size();
+                size_t n;
+                if (spare >= kMinRead || (sizeHint > 0 && spare > 0))
+                {
+                    // 空间够大，或者是按预计的长度留出来的，直接读进去
+                    n = spare;
+                }
+                else if (more)
+                {
+                    // 按字符串的指数增长扩容以后读进去
+                    n = kMinRead;
+                }
+                else
+                {
+                    char probe[kProbe];
+                    auto const got = readSome(fd, probe, kProbe);
+                    if (got == 0)
+                    {
+                        break;
+                    }
+                    s.append(probe, got);
+                    more = got == kProbe;
+                    continue;
+                }
+                auto const got = readAppend(fd, s, n);
+                if (got == 0)
+                {
+                    break;
+                }
+                // 读满了按预计长度留出的空间多半已经到了结尾，先用小缓冲区确认
+                more = got == n && sizeHint == 0;
+            }
+            return s.size() - start;
+        }
+
+        // 按行读取，用memchr找换行符，行里不包括\n
+        // 读缓冲区是自己的，line赋值时复用已有的空间
+        template <class String>
+        class LineReader
+        {
+        public:
+            explicit LineReader(int fd, size_t bufferSize = 64 * 1024)
+                : fd_(fd), size_(bufferSize), buffer_(new char[bufferSize])
+            {
+                assert(bufferSize > 0);
+            }
+
+            // 读到一行返回true；文件结束并且没有剩下的数据时返回false
+            bool getline(String &line);
+
+        private:
+            int fd_;
+            size_t size_;
+            std::unique_ptr<char[]> buffer_;
+            size_t begin_ = 0;
+            size_t end_ = 0;
+            bool eof_ = false;
+        };
+
+        template <class String>
+        bool LineReader<String>::getline(String &line)
+        {
+            // 第一段用assign，line原来的空间够用时不重新分配
+            bool any = false;
+            auto const put = [&](const char *p, size_t n) {
+                if (any)
+                {
+                    line.append(p, n);
+                }
+                else
+                {
+                    line.assign(p, n);
+                    any = true;
+                }
+            };
+            for (;;)
+            {
+                if (begin_ == end_)
+                {
+                    if (eof_)
+                    {
+                        return any;
+                    }
+                    begin_ = 0;
+                    end_ = readSome(fd_, buffer_.get(), size_);
+                    if (end_ == 0)
+                    {
+                        // 最后一行没有\n时也当作一行
+                        eof_ = true;
+                        return any;
+                    }
+                }
+                auto const b = buffer_.get() + begin_;
+                auto const n = end_ - begin_;
+                auto const nl = static_cast<const char *>(std::memchr(b, '\n', n));
+                if (nl != nullptr)
+                {
+                    put(b, size_t(nl - b));
+                    begin_ += size_t(nl - b) + 1;
+                    return true;
+                }
+                // 这一段没有换行，先存进line，再读下一段
+                put(b, n);
+                begin_ = end_;
+            }
+        }
+
+        // 把[first, last)里的字符串依次写出去，每1024个（Linux的IOV_MAX）字符串一次writev
+        template <class It>
+        void writeAll(int fd, It first, It last)
+        {
+            constexpr size_t kBatch = 1024;
+            struct iovec iov[kBatch];
+            size_t n = 0;
+            for (; first != last; ++first)
+            {
+                auto const &s = *first;
+                if (s.empty())
+                {
+                    continue;
+                }
+                // 只读访问，不会让共享的大字符串脱离共享
+                iov[n].iov_base = const_cast<char *>(std::as_const(s).data());
+                iov[n].iov_len = s.size();
+                if (++n == kBatch)
+                {
+                    writevAll(fd, iov, n);
+                    n = 0;
+                }
+            }
+            if (n > 0)
+            {
+                writevAll(fd, iov, n);
+            }
+        }
+    }
+}
+
+#endif
@@ -3,12 +3,80 @@
 
 #include <malloc.h>
 #include <assert.h>
+#include <cstdint>
 #include <cstring>
+#include <new>
+
+#include "hexception.h"
+#include "hstats.h"
 
 
 
 namespace fool
 {
+  // 分配失败时抛出std::bad_alloc，而不是返回空指针
+  inline void *checkedMalloc(size_t size)
+  {
+    void *p = malloc(size);
+    if (!p)
+    {
+      throw_exception<std::bad_alloc>();
+    }
+    return p;
+  }
+
+  inline void *checkedCalloc(size_t n, size_t size)
+  {
+    void *p = calloc(n, size);
+    if (!p)
+    {
+      throw_exception<std::bad_alloc>();
+    }
+    return p;
+  }
+
+  inline void *checkedRealloc(void *ptr, size_t size)
+  {
+    void *p = realloc(ptr, size);
+    if (!p)
+    {
+      throw_exception<std::bad_alloc>();
+    }
+    return p;
+  }
+
+  // 带大小的释放，jemalloc可以用sdallocx省掉查找大小的开销，glibc没有对应的接口，直接free
+  inline void sizedFree(void *ptr, size_t /* size */)
+  {
+    free(ptr);
+  }
+
+  // 实际分配到的可用空间，至少是申请的大小
+  inline size_t mallocUsableSize(void *p)
+  {
+    return malloc_usable_size(p);
+  }
+
+  // glibc的malloc会把申请的大小向上取整到自己的分配粒度，多出来的部分本来就归我们所有
+  // 返回不小于minSize、并且申请之后恰好没有浪费的大小，用它作为容量，下一次扩容就能晚一些发生
+  // 普通的块：8字节的块头，16字节对齐，可用空间是16k+8，最小24
+  // 超过mmap阈值的块：按页分配，块头16字节，可用空间是整页减16
+  // 两种情况下按返回值去申请，得到的可用空间都不会比返回值小
+  constexpr size_t kMallocMmapThreshold = 128 * 1024;
+  constexpr size_t kMallocPageSize = 4096;
+
+  inline size_t goodMallocSize(size_t minSize) noexcept
+  {
+    if (minSize <= 24)
+    {
+      return 24;
+    }
+    if (minSize < kMallocMmapThreshold)
+    {
+      return ((minSize + 8 + 15) & ~size_t(15)) - 8;
+    }
+    return ((minSize + 16 + kMallocPageSize - 1) & ~(kMallocPageSize - 1)) - 16;
+  }
 
   inline void *smartRealloc(void *p, const size_t currentSize, const size_t currentCapacity, const size_t newCapacity)
   {
@@ -21,81 +89,24 @@ namespace fool
     if (slack * 2 > currentSize)
     {
       // auto会忽略顶层const和引用,如果确实需要，显示指出const
-      auto const result = malloc(newCapacity);
+      auto const result = checkedMalloc(newCapacity);
       std::memcpy(result, p, currentSize);
+      FOOL_HSTATS_ADD(ReallocBytesCopied, currentSize);
       free(p);
       return result;
     }
     // 因为realloc会把原来的内容全部拷贝到新的地址
     // 如果空闲的空间太大的话，浪费时间
-    return realloc(p, newCapacity);
-  }
-
-}
-
-
-
-
-
-// 有空时去完善throw_exception
-/*
-inline void* checkedMalloc(size_t size) {
-  void* p = malloc(size);
-  if (!p) {
-    throw_exception<std::bad_alloc>();
-  }
-  return p;
-}
-
-inline void* checkedCalloc(size_t n, size_t size) {
-  void* p = calloc(n, size);
-  if (!p) {
-    throw_exception<std::bad_alloc>();
+    auto const old = reinterpret_cast<uintptr_t>(p);
+    auto const result = checkedRealloc(p, newCapacity);
+    // 原地扩展时没有拷贝，搬到别处时拷贝了整个旧的块
+    if (reinterpret_cast<uintptr_t>(result) != old)
+    {
+      FOOL_HSTATS_ADD(ReallocBytesCopied, currentCapacity);
+    }
+    return result;
   }
-  return p;
-}
 
-inline void* checkedRealloc(void* ptr, size_t size) {
-  void* p = realloc(ptr, size);
-  if (!p) {
-    throw_exception<std::bad_alloc>();
-  }
-  return p;
 }
-
-inline void sizedFree(void* ptr, size_t size) {
-  if (canSdallocx()) {
-    sdallocx(ptr, size, 0);
-  } else {
-    free(ptr);
-  }
-}
-*/
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
 
 #endif
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include "hmmap.h"
+#include "hexception.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <new>
+#include <system_error>
+
+using namespace fool;
+
+namespace
+{
+    [[noreturn]] void throwErrno(const char *what)
+    {
+        throw_exception<std::system_error>(errno, std::generic_category(), what);
+    }
+
+    size_t roundUp(size_t n, size_t align)
+    {
+        return (n + align - 1) & ~(align - 1);
+    }
+
+    // 占一段按大页对齐的地址范围：多占一个大页，把首尾没对齐的部分还回去
+    char *reserveHugeAligned(size_t size)
+    {
+        auto const base = static_cast<char *>(::mmap(nullptr, size + hmmap::kHugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (base == MAP_FAILED)
+        {
+            throw_exception<std::bad_alloc>();
+        }
+        auto const aligned = reinterpret_cast<char *>(roundUp(reinterpret_cast<size_t>(base), hmmap::kHugePageSize));
+        if (aligned != base)
+        {
+            ::munmap(base, size_t(aligned - base));
+        }
+        ::munmap(aligned + size, size_t(base + hmmap::kHugePageSize - aligned));
+        return aligned;
+    }
+
+    // 头部一页，加上文件内容和至少一个字节的\0
+    size_t mappingSize(size_t size)
+    {
+        auto const page = hmmap::pageSize();
+        return page + roundUp(size + 1, page);
+    }
+}
+
+size_t hmmap::pageSize()
+{
+    static const size_t page = size_t(sysconf(_SC_PAGESIZE));
+    return page;
+}
+
+hmmap::File::File(const char *path)
+{
+    fd_ = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0)
+    {
+        throwErrno("hmmap::File: open");
+    }
+    struct stat st;
+    if (::fstat(fd_, &st) != 0)
+    {
+        auto const e = errno;
+        ::close(fd_);
+        errno = e;
+        throwErrno("hmmap::File: fstat");
+    }
+    size_ = size_t(st.st_size);
+}
+
+hmmap::File::~File()
+{
+    ::close(fd_);
+}
+
+void hmmap::File::read(char *buf, size_t n) const
+{
+    size_t done = 0;
+    while (done < n)
+    {
+        auto const r = ::pread(fd_, buf + done, n - done, off_t(done));
+        if (r < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throwErrno("hmmap::File::read");
+        }
+        if (r == 0)
+        {
+            errno = EIO;
+            throwErrno("hmmap::File::read: unexpected end of file");
+        }
+        done += size_t(r);
+    }
+}
+
+char *hmmap::mapFile(const File &file)
+{
+    auto const page = pageSize();
+    auto const total = mappingSize(file.size());
+    // 先占一整块匿名内存，再把文件覆盖到第二页开始的位置
+    // 文件最后一页超出文件结尾的部分由内核填0，文件正好是整页时后面还有一页匿名的0，所以结尾一定有\0
+    auto const base = static_cast<char *>(::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (base == MAP_FAILED)
+    {
+        throwErrno("hmmap::mapFile: reserve");
+    }
+    auto const data = base + page;
+    if (::mmap(data, roundUp(file.size(), page), PROT_READ, MAP_PRIVATE | MAP_FIXED, file.fd(), 0) == MAP_FAILED)
+    {
+        auto const e = errno;
+        ::munmap(base, total);
+        errno = e;
+        throwErrno("hmmap::mapFile: mmap");
+    }
+    return data;
+}
+
+void hmmap::unmapFile(char *data, size_t size)
+{
+    ::munmap(data - pageSize(), mappingSize(size));
+}
+
+void *hmmap::mapAnonymous(size_t bytes, bool hugePages)
+{
+    auto const size = roundUp(bytes, hugePages ? kHugePageSize : pageSize());
+    if (!hugePages)
+    {
+        auto const p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+        {
+            throw_exception<std::bad_alloc>();
+        }
+        return p;
+    }
+    auto const aligned = reserveHugeAligned(size);
+    // 失败时（内核不支持THP）照样能用，只是普通的页
+    ::madvise(aligned, size, MADV_HUGEPAGE);
+    return aligned;
+}
+
+void *hmmap::remapAnonymous(void *p, size_t oldBytes, size_t newBytes, bool hugePages)
+{
+    auto const granule = hugePages ? kHugePageSize : pageSize();
+    auto const oldSize = roundUp(oldBytes, granule);
+    auto const newSize = roundUp(newBytes, granule);
+    // VM_HUGEPAGE跟着映射走，扩出来的部分也会用大页
+    if (!hugePages)
+    {
+        auto const result = ::mremap(p, oldSize, newSize, MREMAP_MAYMOVE);
+        if (result == MAP_FAILED)
+        {
+            throw_exception<std::bad_alloc>();
+        }
+        return result;
+    }
+    // 大页的映射原地扩大才不会丢掉对齐；后面的地址被占用时先占一段对齐的范围，再把页表搬过去盖住它
+    if (::mremap(p, oldSize, newSize, 0) != MAP_FAILED)
+    {
+        return p;
+    }
+    auto const target = reserveHugeAligned(newSize);
+    auto const result = ::mremap(p, oldSize, newSize, MREMAP_MAYMOVE | MREMAP_FIXED, target);
+    if (result == MAP_FAILED)
+    {
+        ::munmap(target, newSize);
+        throw_exception<std::bad_alloc>();
+    }
+    return result;
+}
+
+void hmmap::unmapAnonymous(void *p, size_t bytes)
+{
+    ::munmap(p, roundUp(bytes, pageSize()));
+}
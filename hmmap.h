@@ -0,0 +1,52 @@
+#ifndef HXMMXH_MMAP_H
+#define HXMMXH_MMAP_H
+
+#include <cstddef>
+
+// 把文件只读映射成大字符串用到的系统调用封装，出错时抛std::system_error
+// 以及mmap_allocator用的匿名内存，申请失败时和其他分配一样抛std::bad_alloc
+namespace fool
+{
+    namespace hmmap
+    {
+        size_t pageSize();
+        // x86-64的透明大页
+        constexpr size_t kHugePageSize = size_t(2) << 20;
+
+        // 只读打开的文件，析构时关闭
+        class File
+        {
+        public:
+            explicit File(const char *path);
+            ~File();
+            File(const File &) = delete;
+            File &operator=(const File &) = delete;
+
+            int fd() const { return fd_; }
+            size_t size() const { return size_; }
+            // 从头读满n个字节
+            void read(char *buf, size_t n) const;
+
+        private:
+            int fd_;
+            size_t size_;
+        };
+
+        // 把整个文件映射进来，返回文件内容的首地址，映射是MAP_PRIVATE的只读页，多个进程映射同一个文件时共享页缓存
+        // 返回的地址前面有一整页可写的匿名内存，调用者把头部（比如引用计数）放在那里；文件内容后面至少有一个\0
+        // 映射期间文件被截短，访问截掉的部分会收到SIGBUS，和所有mmap的用法一样
+        char *mapFile(const File &file);
+        // size是映射时的文件大小
+        void unmapFile(char *data, size_t size);
+
+        // 可读写的匿名内存，大小按页取整，内容是0
+        // hugePages时按大页对齐，并用MADV_HUGEPAGE请求透明大页；内核没有开THP时就是普通的页
+        void *mapAnonymous(size_t bytes, bool hugePages);
+        // 用mremap扩大到newBytes，页表整体搬过去，不拷贝内容；后面的地址被占用时换一个地址
+        // hugePages时换的地址也按大页对齐
+        void *remapAnonymous(void *p, size_t oldBytes, size_t newBytes, bool hugePages);
+        void unmapAnonymous(void *p, size_t bytes);
+    }
+}
+
+#endif
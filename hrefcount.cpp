@@ -0,0 +1,127 @@
+#include "hrefcount.h"
+#include "likely.h"
+
+#include <cstdint>
+
+using namespace fool;
+
+namespace
+{
+    typedef deferred_refcount::counter_type Counter;
+
+    // 线程缓存的一个计数器：credit是已经加在计数上、还没有交给任何字符串的引用
+    // credit为0的表项不持有引用，对应的内存可能已经释放、地址被新的字符串复用，命中时只是当作热点处理，没有危害
+    struct Entry
+    {
+        Counter *counter;
+        void (*release)(Counter &);
+        size_t credit;
+    };
+
+    // 表本身没有构造和析构，访问时不经过thread_local的初始化检查
+    thread_local Entry tEntries[deferred_refcount::kSlots];
+    // 线程退出时表已经还回去了，之后（比如其他thread_local对象析构时）的拷贝不再缓存引用
+    thread_local bool tDead = false;
+
+    // 第一次缓存引用时才注册，线程退出时还回所有引用
+    struct ExitFlush
+    {
+        void arm() {}
+        ~ExitFlush()
+        {
+            deferred_refcount::flush();
+            tDead = true;
+        }
+    };
+    thread_local ExitFlush tExitFlush;
+
+    Entry &slotOf(Counter *c)
+    {
+        // RefCounted至少按16字节对齐，低位没有信息
+        auto const h = (reinterpret_cast<uintptr_t>(c) >> 4) * 0x9E3779B97F4A7C15ull;
+        return tEntries[h >> (64 - __builtin_ctzll(deferred_refcount::kSlots))];
+    }
+
+    void giveBack(Entry &e)
+    {
+        auto const k = e.credit;
+        if (k == 0)
+        {
+            return;
+        }
+        e.credit = 0;
+        // 缓存的引用是最后的引用：字符串都已经析构了，由这里释放
+        if (e.counter->fetch_sub(k, std::memory_order_acq_rel) == k)
+        {
+            e.release(*e.counter);
+        }
+    }
+}
+
+static_assert((deferred_refcount::kSlots & (deferred_refcount::kSlots - 1)) == 0, "kSlots must be a power of 2");
+
+size_t deferred_refcount::load(counter_type &c)
+{
+    auto &e = slotOf(&c);
+    if (e.counter == &c && e.credit > 0)
+    {
+        auto const k = e.credit;
+        e.credit = 0;
+        c.fetch_sub(k, std::memory_order_acq_rel);
+    }
+    return c.load(std::memory_order_acquire);
+}
+
+void deferred_refcount::increment(counter_type &c, void (*release)(counter_type &))
+{
+    auto &e = slotOf(&c);
+    if (FOOL_LIKELY(e.counter == &c))
+    {
+        if (FOOL_LIKELY(e.credit > 0))
+        {
+            --e.credit;
+            return;
+        }
+        if (FOOL_UNLIKELY(tDead))
+        {
+            c.fetch_add(1, std::memory_order_acq_rel);
+            return;
+        }
+        tExitFlush.arm();
+        // 这个线程第二次拷贝它，按批取引用
+        c.fetch_add(kBatch, std::memory_order_acq_rel);
+        e.release = release;
+        e.credit = kBatch - 1;
+        return;
+    }
+    // 第一次见到：只占住表项，不缓存引用，拷贝一次就扔的字符串不会被拖住
+    giveBack(e);
+    e.counter = &c;
+    e.release = release;
+    c.fetch_add(1, std::memory_order_acq_rel);
+}
+
+size_t deferred_refcount::decrement(counter_type &c)
+{
+    auto &e = slotOf(&c);
+    if (FOOL_LIKELY(e.counter == &c && e.credit > 0))
+    {
+        if (FOOL_UNLIKELY(++e.credit >= kMaxCredit))
+        {
+            // 留下kBatch个，计数不会在这里减到0
+            c.fetch_sub(e.credit - kBatch, std::memory_order_acq_rel);
+            e.credit = kBatch;
+        }
+        // 本线程还缓存着引用，肯定不是最后一个
+        return 2;
+    }
+    return c.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void deferred_refcount::flush()
+{
+    for (auto &e : tEntries)
+    {
+        giveBack(e);
+    }
+}
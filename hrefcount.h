@@ -0,0 +1,75 @@
+#ifndef HXMMXH_REFCOUNT_H
+#define HXMMXH_REFCOUNT_H
+
+#include <atomic>
+#include <cstddef>
+
+// 大字符串引用计数的线程策略
+// 线程策略也是一个只有静态函数的类，决定RefCounted里计数器的类型和加减的方式：
+//   typedef ... counter_type;
+//   static void init(counter_type &c, size_t n);
+//   static size_t load(const counter_type &c);
+//   static void increment(counter_type &c);
+//   static size_t decrement(counter_type &c);   返回减之前的值，返回1时调用者释放内存
+//   static constexpr bool kCachesReferences;
+// kCachesReferences为true的策略会在线程里缓存引用，计数可能在策略自己手里减到0，
+// 这时increment多一个参数release，策略用它释放计数器所在的整块内存：
+//   static void increment(counter_type &c, void (*release)(counter_type &));
+namespace fool
+{
+    // 默认策略，大字符串可以在线程之间共享
+    struct atomic_refcount
+    {
+        typedef std::atomic<size_t> counter_type;
+
+        static void init(counter_type &c, size_t n) { c.store(n, std::memory_order_release); }
+        static size_t load(const counter_type &c) { return c.load(std::memory_order_acquire); }
+        static void increment(counter_type &c) { c.fetch_add(1, std::memory_order_acq_rel); }
+        static size_t decrement(counter_type &c) { return c.fetch_sub(1, std::memory_order_acq_rel); }
+        static constexpr bool kCachesReferences = false;
+    };
+
+    // 只在一个线程里使用的字符串，拷贝和析构都是普通的加减
+    // 这种字符串（包括它的拷贝）不能交给其他线程，除非整组拷贝一起转移过去
+    struct plain_refcount
+    {
+        typedef size_t counter_type;
+
+        static void init(counter_type &c, size_t n) { c = n; }
+        static size_t load(const counter_type &c) { return c; }
+        static void increment(counter_type &c) { ++c; }
+        static size_t decrement(counter_type &c) { return c--; }
+        static constexpr bool kCachesReferences = false;
+    };
+
+    // 很多线程同时拷贝和析构同一个大字符串（比如响应模板）时，计数器所在的缓存行在核之间来回搬，原子加减成了瓶颈
+    // 这个策略让每个线程缓存一批引用：同一个线程第二次拷贝同一个字符串时一次性加kBatch，
+    // 之后的拷贝和析构只改线程自己的余额，余额超过kMaxCredit时把多出来的还回去
+    // 只拷贝一次的字符串不缓存，和atomic_refcount一样直接加减
+    //
+    // 代价：
+    // 1. 线程缓存的引用也算在计数里，别的线程缓存着引用时isShared()为true，修改会多复制一次（不会少复制）
+    //    load()会先把本线程的余额还回去，只有自己缓存的引用不影响判断
+    // 2. 所有字符串都析构以后，内存要等缓存它的线程还回引用才释放：表项被别的字符串挤掉、线程退出或者调用flush()时
+    //    每个线程最多缓存kSlots个字符串，长期空闲的线程持有热点字符串时可以调用flush()
+    struct deferred_refcount
+    {
+        typedef std::atomic<size_t> counter_type;
+
+        // 每个线程的缓存表大小（直接映射）和每次取的引用数
+        static constexpr size_t kSlots = 32;
+        static constexpr size_t kBatch = 64;
+        static constexpr size_t kMaxCredit = 2 * kBatch;
+        static constexpr bool kCachesReferences = true;
+
+        static void init(counter_type &c, size_t n) { c.store(n, std::memory_order_release); }
+        // 先还回本线程缓存的引用，再读计数；调用者自己持有一个引用，计数不会因此减到0
+        static size_t load(counter_type &c);
+        static void increment(counter_type &c, void (*release)(counter_type &));
+        static size_t decrement(counter_type &c);
+        // 还回本线程缓存的所有引用，计数减到0的字符串在这里释放
+        static void flush();
+    };
+}
+
+#endif
@@ -0,0 +1,498 @@
+#include "hsearch.h"
+#include "likely.h"
+
+#include <assert.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FOOL_SEARCH_X86 1
+#include <immintrin.h>
+#else
+#define FOOL_SEARCH_X86 0
+#endif
+
+using namespace fool;
+using hsearch::npos;
+
+namespace
+{
+    // 下面所有的内核函数都不处理pos，调用前已经保证 n >= m >= 2（子串）或者 m >= 1（字符集）
+    typedef size_t (*FindFn)(const char *hay, size_t n, const char *needle, size_t m);
+    typedef size_t (*SetFn)(const char *hay, size_t n, const char *set, size_t m);
+
+    // 256位的位图，标量实现用来判断一个字节是否在集合里
+    class ByteSet
+    {
+    public:
+        ByteSet(const char *set, size_t m)
+        {
+            memset(bits_, 0, sizeof(bits_));
+            for (size_t i = 0; i < m; ++i)
+            {
+                auto const c = static_cast<unsigned char>(set[i]);
+                bits_[c >> 6] |= uint64_t(1) << (c & 63);
+            }
+        }
+        bool has(char ch) const
+        {
+            auto const c = static_cast<unsigned char>(ch);
+            return (bits_[c >> 6] >> (c & 63)) & 1;
+        }
+
+    private:
+        uint64_t bits_[4];
+    };
+
+    // 半字节查找表：低4位作为下标，取出的字节是高4位的位图
+    // 高4位是0-7的放在lo_里，8-15的放在hi_里
+    struct NibbleTable
+    {
+        NibbleTable(const char *set, size_t m)
+        {
+            memset(lo_, 0, sizeof(lo_));
+            memset(hi_, 0, sizeof(hi_));
+            for (size_t i = 0; i < m; ++i)
+            {
+                auto const c = static_cast<unsigned char>(set[i]);
+                auto const lo = c & 0xF, hi = c >> 4;
+                if (hi < 8)
+                {
+                    lo_[lo] |= uint8_t(1u << hi);
+                }
+                else
+                {
+                    hi_[lo] |= uint8_t(1u << (hi - 8));
+                }
+            }
+        }
+        alignas(16) uint8_t lo_[16];
+        alignas(16) uint8_t hi_[16];
+    };
+
+    /*------------------------------------------------标量实现------------------------------------------------------------------------*/
+
+    size_t findScalar(const char *hay, size_t n, const char *needle, size_t m)
+    {
+        assert(m >= 2 && n >= m);
+        const char first = needle[0], last = needle[m - 1];
+        const char *p = hay;
+        const char *const end = hay + n - m + 1;
+        while (p < end)
+        {
+            // memchr本身就很快，先找首字节，再看尾字节，最后才比较中间
+            p = static_cast<const char *>(memchr(p, first, size_t(end - p)));
+            if (p == nullptr)
+            {
+                return npos;
+            }
+            if (p[m - 1] == last && memcmp(p + 1, needle + 1, m - 2) == 0)
+            {
+                return size_t(p - hay);
+            }
+            ++p;
+        }
+        return npos;
+    }
+
+    size_t rfindScalar(const char *hay, size_t n, const char *needle, size_t m)
+    {
+        assert(m >= 2 && n >= m);
+        const char first = needle[0], last = needle[m - 1];
+        for (size_t i = n - m + 1; i-- > 0;)
+        {
+            if (hay[i] == first && hay[i + m - 1] == last && memcmp(hay + i + 1, needle + 1, m - 2) == 0)
+            {
+                return i;
+            }
+        }
+        return npos;
+    }
+
+    size_t firstOfScalar(const char *hay, size_t n, const char *set, size_t m)
+    {
+        const ByteSet bs(set, m);
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (bs.has(hay[i]))
+            {
+                return i;
+            }
+        }
+        return npos;
+    }
+
+    size_t firstNotOfScalar(const char *hay, size_t n, const char *set, size_t m)
+    {
+        const ByteSet bs(set, m);
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (!bs.has(hay[i]))
+            {
+                return i;
+            }
+        }
+        return npos;
+    }
+
+#if FOOL_SEARCH_X86
+    /*------------------------------------------------SSE2实现------------------------------------------------------------------------*/
+
+    __attribute__((target("sse2"))) size_t findSSE2(const char *hay, size_t n, const char *needle, size_t m)
+    {
+        assert(m >= 2 && n >= m);
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last = _mm_set1_epi8(needle[m - 1]);
+        // 候选的起始位置是[0, cand)
+        const size_t cand = n - m + 1;
+        size_t i = 0;
+        for (; i + 16 <= cand; i += 16)
+        {
+            const __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + i));
+            const __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + i + m - 1));
+            unsigned mask = unsigned(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast))));
+            while (mask != 0)
+            {
+                auto const bit = unsigned(__builtin_ctz(mask));
+                if (memcmp(hay + i + bit + 1, needle + 1, m - 2) == 0)
+                {
+                    return i + bit;
+                }
+                mask &= mask - 1;
+            }
+        }
+        // 剩下不足一个块的候选位置
+        if (i == cand)
+        {
+            return npos;
+        }
+        auto const r = findScalar(hay + i, n - i, needle, m);
+        return r == npos ? npos : i + r;
+    }
+
+    __attribute__((target("sse2"))) size_t rfindSSE2(const char *hay, size_t n, const char *needle, size_t m)
+    {
+        assert(m >= 2 && n >= m);
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last = _mm_set1_epi8(needle[m - 1]);
+        size_t i = n - m + 1;
+        // 从后往前，每个块里从最高位开始检查
+        while (i >= 16)
+        {
+            i -= 16;
+            const __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + i));
+            const __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + i + m - 1));
+            unsigned mask = unsigned(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast))));
+            while (mask != 0)
+            {
+                auto const bit = 31 - unsigned(__builtin_clz(mask));
+                if (memcmp(hay + i + bit + 1, needle + 1, m - 2) == 0)
+                {
+                    return i + bit;
+                }
+                mask &= ~(1u << bit);
+            }
+        }
+        // 剩下的候选位置是[0, i)
+        return i == 0 ? npos : rfindScalar(hay, i + m - 1, needle, m);
+    }
+
+    // 16个字节同时查表，返回在集合里的字节对应的位
+    __attribute__((target("ssse3"))) inline unsigned classify16(__m128i x, __m128i tblLo, __m128i tblHi, __m128i bitTbl)
+    {
+        const __m128i nibbleMask = _mm_set1_epi8(0x0F);
+        const __m128i lo = _mm_and_si128(x, nibbleMask);
+        const __m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), nibbleMask);
+        const __m128i rowLo = _mm_shuffle_epi8(tblLo, lo);
+        const __m128i rowHi = _mm_shuffle_epi8(tblHi, lo);
+        const __m128i isHigh = _mm_cmpgt_epi8(hi, _mm_set1_epi8(7));
+        const __m128i row = _mm_or_si128(_mm_and_si128(isHigh, rowHi), _mm_andnot_si128(isHigh, rowLo));
+        const __m128i bit = _mm_shuffle_epi8(bitTbl, hi);
+        return unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, bit), bit)));
+    }
+
+    template <bool kNot>
+    __attribute__((target("ssse3"))) size_t setSSSE3(const char *hay, size_t n, const char *set, size_t m)
+    {
+        const NibbleTable t(set, m);
+        const __m128i tblLo = _mm_load_si128(reinterpret_cast<const __m128i *>(t.lo_));
+        const __m128i tblHi = _mm_load_si128(reinterpret_cast<const __m128i *>(t.hi_));
+        const __m128i bitTbl = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            auto mask = classify16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(hay + i)), tblLo, tblHi, bitTbl);
+            if (kNot)
+            {
+                mask = ~mask & 0xFFFF;
+            }
+            if (mask != 0)
+            {
+                return i + unsigned(__builtin_ctz(mask));
+            }
+        }
+        auto const r = kNot ? firstNotOfScalar(hay + i, n - i, set, m) : firstOfScalar(hay + i, n - i, set, m);
+        return r == npos ? npos : i + r;
+    }
+
+    /*------------------------------------------------AVX2实现------------------------------------------------------------------------*/
+
+    __attribute__((target("avx2"))) size_t findAVX2(const char *hay, size_t n, const char *needle, size_t m)
+    {
+        assert(m >= 2 && n >= m);
+        const __m256i first = _mm256_set1_epi8(needle[0]);
+        const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+        const size_t cand = n - m + 1;
+        size_t i = 0;
+        for (; i + 32 <= cand; i += 32)
+        {
+            const __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hay + i));
+            const __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hay + i + m - 1));
+            unsigned mask = unsigned(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, blockFirst), _mm256_cmpeq_epi8(last, blockLast))));
+            while (mask != 0)
+            {
+                auto const bit = unsigned(__builtin_ctz(mask));
+                if (memcmp(hay + i + bit + 1, needle + 1, m - 2) == 0)
+                {
+                    return i + bit;
+                }
+                mask &= mask - 1;
+            }
+        }
+        if (i == cand)
+        {
+            return npos;
+        }
+        _mm256_zeroupper();
+        auto const r = findSSE2(hay + i, n - i, needle, m);
+        return r == npos ? npos : i + r;
+    }
+
+    __attribute__((target("avx2"))) size_t rfindAVX2(const char *hay, size_t n, const char *needle, size_t m)
+    {
+        assert(m >= 2 && n >= m);
+        const __m256i first = _mm256_set1_epi8(needle[0]);
+        const __m256i last = _mm256_set1_epi8(needle[m - 1]);
+        size_t i = n - m + 1;
+        while (i >= 32)
+        {
+            i -= 32;
+            const __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hay + i));
+            const __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hay + i + m - 1));
+            unsigned mask = unsigned(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, blockFirst), _mm256_cmpeq_epi8(last, blockLast))));
+            while (mask != 0)
+            {
+                auto const bit = 31 - unsigned(__builtin_clz(mask));
+                if (memcmp(hay + i + bit + 1, needle + 1, m - 2) == 0)
+                {
+                    return i + bit;
+                }
+                mask &= ~(1u << bit);
+            }
+        }
+        if (i == 0)
+        {
+            return npos;
+        }
+        _mm256_zeroupper();
+        return rfindSSE2(hay, i + m - 1, needle, m);
+    }
+
+    template <bool kNot>
+    __attribute__((target("avx2"))) size_t setAVX2(const char *hay, size_t n, const char *set, size_t m)
+    {
+        const NibbleTable t(set, m);
+        // vpshufb是在两个128位的通道里各自查表，所以表要复制到两个通道
+        const __m256i tblLo = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(t.lo_)));
+        const __m256i tblHi = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(t.hi_)));
+        const __m256i bitTbl = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                                1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+        const __m256i nibbleMask = _mm256_set1_epi8(0x0F);
+        const __m256i seven = _mm256_set1_epi8(7);
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32)
+        {
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(hay + i));
+            const __m256i lo = _mm256_and_si256(x, nibbleMask);
+            const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), nibbleMask);
+            const __m256i rowLo = _mm256_shuffle_epi8(tblLo, lo);
+            const __m256i rowHi = _mm256_shuffle_epi8(tblHi, lo);
+            const __m256i row = _mm256_blendv_epi8(rowLo, rowHi, _mm256_cmpgt_epi8(hi, seven));
+            const __m256i bit = _mm256_shuffle_epi8(bitTbl, hi);
+            unsigned mask = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit)));
+            if (kNot)
+            {
+                mask = ~mask;
+            }
+            if (mask != 0)
+            {
+                return i + unsigned(__builtin_ctz(mask));
+            }
+        }
+        auto const r = kNot ? firstNotOfScalar(hay + i, n - i, set, m) : firstOfScalar(hay + i, n - i, set, m);
+        return r == npos ? npos : i + r;
+    }
+#endif
+
+    /*------------------------------------------------运行时分发------------------------------------------------------------------------*/
+
+    struct Kernels
+    {
+        hsearch::Level level;
+        FindFn find;
+        FindFn rfind;
+        SetFn firstOf;
+        SetFn firstNotOf;
+    };
+
+    const Kernels kScalarKernels = {hsearch::Level::Scalar, findScalar, rfindScalar, firstOfScalar, firstNotOfScalar};
+#if FOOL_SEARCH_X86
+    // 字符集查找需要pshufb（SSSE3），只有SSE2的老CPU在字符集上退回标量实现
+    const Kernels kSSE2Kernels = {hsearch::Level::SSE2, findSSE2, rfindSSE2, setSSSE3<false>, setSSSE3<true>};
+    const Kernels kSSE2OnlyKernels = {hsearch::Level::SSE2, findSSE2, rfindSSE2, firstOfScalar, firstNotOfScalar};
+    const Kernels kAVX2Kernels = {hsearch::Level::AVX2, findAVX2, rfindAVX2, setAVX2<false>, setAVX2<true>};
+#endif
+
+    const Kernels *kernelsFor(hsearch::Level l)
+    {
+#if FOOL_SEARCH_X86
+        switch (l)
+        {
+        case hsearch::Level::AVX2:
+            return &kAVX2Kernels;
+        case hsearch::Level::SSE2:
+            return __builtin_cpu_supports("ssse3") ? &kSSE2Kernels : &kSSE2OnlyKernels;
+        case hsearch::Level::Scalar:
+            break;
+        }
+#endif
+        (void)l;
+        return &kScalarKernels;
+    }
+
+    // 常量初始化，不存在静态初始化顺序的问题，第一次使用时才检测CPU
+    std::atomic<const Kernels *> gKernels(nullptr);
+
+    const Kernels *kernels()
+    {
+        auto k = gKernels.load(std::memory_order_acquire);
+        if (FOOL_UNLIKELY(k == nullptr))
+        {
+            k = kernelsFor(hsearch::bestLevel());
+            gKernels.store(k, std::memory_order_release);
+        }
+        return k;
+    }
+}
+
+hsearch::Level hsearch::bestLevel()
+{
+#if FOOL_SEARCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return Level::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return Level::SSE2;
+    }
+#endif
+    return Level::Scalar;
+}
+
+hsearch::Level hsearch::level()
+{
+    return kernels()->level;
+}
+
+void hsearch::setLevel(Level l)
+{
+    auto const best = bestLevel();
+    gKernels.store(kernelsFor(static_cast<int>(l) > static_cast<int>(best) ? best : l), std::memory_order_release);
+}
+
+const char *hsearch::levelName(Level l)
+{
+    switch (l)
+    {
+    case Level::Scalar:
+        return "scalar";
+    case Level::SSE2:
+        return "sse2";
+    case Level::AVX2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+/*------------------------------------------------对外接口------------------------------------------------------------------------*/
+
+size_t hsearch::find(const char *hay, size_t n, const char *needle, size_t m, size_t pos)
+{
+    if (FOOL_UNLIKELY(pos > n || m > n - pos))
+    {
+        return npos;
+    }
+    if (FOOL_UNLIKELY(m == 0))
+    {
+        return pos;
+    }
+    if (m == 1)
+    {
+        auto const p = static_cast<const char *>(memchr(hay + pos, needle[0], n - pos));
+        return p == nullptr ? npos : size_t(p - hay);
+    }
+    auto const r = kernels()->find(hay + pos, n - pos, needle, m);
+    return r == npos ? npos : pos + r;
+}
+
+size_t hsearch::rfind(const char *hay, size_t n, const char *needle, size_t m, size_t pos)
+{
+    if (FOOL_UNLIKELY(m > n))
+    {
+        return npos;
+    }
+    // 最后一个可能的起始位置
+    auto const lastStart = pos < n - m ? pos : n - m;
+    if (FOOL_UNLIKELY(m == 0))
+    {
+        return lastStart;
+    }
+    if (m == 1)
+    {
+        auto const p = static_cast<const char *>(memrchr(hay, needle[0], lastStart + 1));
+        return p == nullptr ? npos : size_t(p - hay);
+    }
+    return kernels()->rfind(hay, lastStart + m, needle, m);
+}
+
+size_t hsearch::find_first_of(const char *hay, size_t n, const char *set, size_t m, size_t pos)
+{
+    if (FOOL_UNLIKELY(pos >= n || m == 0))
+    {
+        return npos;
+    }
+    if (m == 1)
+    {
+        auto const p = static_cast<const char *>(memchr(hay + pos, set[0], n - pos));
+        return p == nullptr ? npos : size_t(p - hay);
+    }
+    auto const r = kernels()->firstOf(hay + pos, n - pos, set, m);
+    return r == npos ? npos : pos + r;
+}
+
+size_t hsearch::find_first_not_of(const char *hay, size_t n, const char *set, size_t m, size_t pos)
+{
+    if (FOOL_UNLIKELY(pos >= n))
+    {
+        return npos;
+    }
+    if (FOOL_UNLIKELY(m == 0))
+    {
+        return pos;
+    }
+    auto const r = kernels()->firstNotOf(hay + pos, n - pos, set, m);
+    return r == npos ? npos : pos + r;
+}
@@ -0,0 +1,43 @@
+#ifndef HXMMXH_SEARCH_H
+#define HXMMXH_SEARCH_H
+
+#include <cstddef>
+
+// 字符串查找的底层实现
+// 子串查找用首尾字节过滤：一次比较16/32个候选位置的首字节和尾字节，两个都相等才去memcmp中间部分
+// 字符集查找用半字节查表：pshufb把字节的低4位映射成高4位的位图，一条指令判断16/32个字节是否在集合里
+// 运行时按CPU支持的指令集选择AVX2、SSE2或者纯标量实现
+namespace fool
+{
+    namespace hsearch
+    {
+        constexpr size_t npos = size_t(-1);
+
+        // 按CPU选择的实现级别，hutf8、hascii也用它分派
+        // 约定：AVX2实现把凑不满一个块的尾部交给SSE2实现之前，先调用_mm256_zeroupper()
+        // SSE2实现是非VEX编码的，ymm的高半部分还是脏的时候执行这些指令要付出状态切换或者合并的代价
+        // 编译器只在一部分调用点自动插入vzeroupper，尾部被内联或者尾调用时就没有，所以统一显式写出来
+        enum class Level
+        {
+            Scalar,
+            SSE2,
+            AVX2,
+        };
+
+        // 当前CPU支持的最高级别
+        Level bestLevel();
+        // 当前正在使用的级别
+        Level level();
+        // 强制使用某一级别，超过CPU支持的级别时会降到bestLevel()，主要给测试和benchmark用
+        void setLevel(Level l);
+        const char *levelName(Level l);
+
+        // 和std::string的同名函数语义一致，返回下标，找不到返回npos
+        size_t find(const char *hay, size_t n, const char *needle, size_t m, size_t pos = 0);
+        size_t rfind(const char *hay, size_t n, const char *needle, size_t m, size_t pos = npos);
+        size_t find_first_of(const char *hay, size_t n, const char *set, size_t m, size_t pos = 0);
+        size_t find_first_not_of(const char *hay, size_t n, const char *set, size_t m, size_t pos = 0);
+    }
+}
+
+#endif
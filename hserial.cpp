@@ -0,0 +1,54 @@
+#include "hserial.h"
+#include "hexception.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <system_error>
+
+using namespace fool;
+
+const char hserial::kMagic[8] = {'H', 'S', 'T', 'R', 'S', 'E', 'Q', '1'};
+
+void hserial::throwCorrupt(const char *what)
+{
+    throw_exception<std::invalid_argument>(what);
+}
+
+size_t hserial::checkFile(const char *data, size_t size, size_t *index)
+{
+    if (size < kHeaderSize + kFooterSize || memcmp(data, kMagic, kHeaderSize) != 0 ||
+        memcmp(data + size - sizeof(kMagic), kMagic, sizeof(kMagic)) != 0)
+    {
+        throwCorrupt("hserial::load: not a string sequence file");
+    }
+    auto const footer = data + size - kFooterSize;
+    auto const count = loadU64(footer);
+    auto const off = loadU64(footer + sizeof(uint64_t));
+    // 索引正好夹在记录和文件尾之间，先除再比较，count再大也不会溢出
+    auto const indexBytes = size - kFooterSize;
+    if (off < kHeaderSize || off % kAlign != 0 || off > indexBytes || (indexBytes - off) / sizeof(uint64_t) != count ||
+        (indexBytes - off) % sizeof(uint64_t) != 0)
+    {
+        throwCorrupt("hserial::load: bad index");
+    }
+    *index = size_t(off);
+    return size_t(count);
+}
+
+int hserial::createFile(const char *path)
+{
+    auto const fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        throw_exception<std::system_error>(errno, std::generic_category(), "hserial::createFile");
+    }
+    return fd;
+}
+
+void hserial::closeFile(int fd)
+{
+    ::close(fd);
+}
@@ -0,0 +1,255 @@
+#ifndef HXMMXH_SERIAL_H
+#define HXMMXH_SERIAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <sys/uio.h>
+
+#include "hio.h"
+#include "hstring.h"
+#include "likely.h"
+
+// 字符串序列的二进制格式：写的时候用writev把长的字符串原样写出去，读的时候映射整个文件，
+// 短的字符串放进小字符串里，其余的都是映射上的切片，不拷贝内容，整个文件只有一块引用计数的内存
+//
+// 文件布局，整数都是本机字节序的uint64_t，每个记录从8字节对齐的位置开始：
+//   文件头  "HSTRSEQ1"
+//   记录    长度 | 内容 | \0 | 补齐到8字节的0
+//   索引    每个记录相对文件开头的偏移
+//   文件尾  记录个数 | 索引的偏移 | "HSTRSEQ1"
+// 索引和个数都放在最后，写的时候不用事先知道有多少个字符串，也不用回头改文件头，可以写到管道里
+// 内容后面有\0，加载出来的字符串可以直接是映射上的切片，不用复制
+namespace fool
+{
+    namespace hserial
+    {
+        constexpr size_t kAlign = 8;
+        constexpr size_t kHeaderSize = 8;
+        constexpr size_t kFooterSize = 24;
+        // 最短的记录：长度和\0
+        constexpr size_t kMinRecord = sizeof(uint64_t) + 1;
+        extern const char kMagic[8];
+
+        // 长度为n的字符串的记录占多少字节
+        inline size_t recordSize(size_t n)
+        {
+            return (kMinRecord + n + kAlign - 1) & ~(kAlign - 1);
+        }
+
+        inline uint64_t loadU64(const char *p)
+        {
+            uint64_t v;
+            memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        // 检查文件头和文件尾，返回记录个数，*index是索引的偏移；格式不对抛std::invalid_argument
+        size_t checkFile(const char *data, size_t size, size_t *index);
+        [[noreturn]] void throwCorrupt(const char *what);
+        // 打开要写的文件，已经存在时截断，出错抛std::system_error
+        int createFile(const char *path);
+        void closeFile(int fd);
+
+        // 流式地写一个字符串序列：短的记录拷贝进缓冲区，长的内容单独占一个iovec，攒够了一起writev
+        // 等待写出的长字符串在内部留一份拷贝（hstring只是增加引用计数），调用者不用保证它们活到写出为止
+        // 最后必须调用finish()，否则文件没有索引，加载不了
+        template <class String = hstring>
+        class Writer
+        {
+        public:
+            explicit Writer(int fd);
+            Writer(const Writer &) = delete;
+            Writer &operator=(const Writer &) = delete;
+
+            void add(const String &s);
+            template <class It>
+            void add(It first, It last)
+            {
+                for (; first != last; ++first)
+                {
+                    add(*first);
+                }
+            }
+            // 写出索引和文件尾，返回整个文件的字节数
+            size_t finish();
+            size_t count() const { return index_.size(); }
+
+        private:
+            // 长度到这个值的内容走writev，更短的拷贝进缓冲区更便宜；中字符串都在拷贝的这一边
+            constexpr static size_t kGatherMin = 512;
+            constexpr static size_t kBufferSize = 64 * 1024;
+            // Linux的IOV_MAX
+            constexpr static size_t kMaxIov = 1024;
+
+            // 在缓冲区里占n个字节，和前一个iovec相连时合并
+            char *stage(size_t n);
+            void gather(const char *p, size_t n);
+            void flush();
+
+            int fd_;
+            size_t offset_ = 0;
+            std::vector<uint64_t> index_;
+            std::unique_ptr<char[]> buffer_;
+            size_t used_ = 0;
+            std::unique_ptr<struct iovec[]> iov_;
+            size_t niov_ = 0;
+            std::vector<String> pinned_;
+        };
+
+        // 把[first, last)里的字符串写到path，返回文件的字节数
+        template <class It>
+        size_t save(const char *path, It first, It last)
+        {
+            typedef typename std::decay<decltype(*first)>::type String;
+            auto const fd = createFile(path);
+            try
+            {
+                Writer<String> w(fd);
+                w.add(first, last);
+                auto const size = w.finish();
+                closeFile(fd);
+                return size;
+            }
+            catch (...)
+            {
+                closeFile(fd);
+                throw;
+            }
+        }
+
+        // 映射path，按顺序返回里面的字符串。不超过小字符串长度的拷贝进对象本身，其余的共享映射，最后一个释放时munmap
+        // 映射出来的页是只读的，修改加载出来的字符串时和切片一样先复制
+        // 文件不超过kReadFilePages（64）页时mapFile直接读进来，不映射，切片共享的是读出来的那一份
+        template <class String = hstring>
+        std::vector<String> load(const char *path)
+        {
+            auto const file = String::mapFile(path);
+            auto const data = std::as_const(file).data();
+            size_t index;
+            auto const count = checkFile(data, file.size(), &index);
+            std::vector<String> out;
+            out.reserve(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                // 只检查长度和偏移，不读内容，没有用到的长字符串所在的页不会被读进来
+                auto const off = loadU64(data + index + i * sizeof(uint64_t));
+                if (FOOL_UNLIKELY(off % kAlign != 0 || off < kHeaderSize || off > index || index - off < kMinRecord))
+                {
+                    throwCorrupt("hserial::load: record offset out of range");
+                }
+                auto const n = loadU64(data + off);
+                if (FOOL_UNLIKELY(n > index - off - kMinRecord))
+                {
+                    throwCorrupt("hserial::load: record length out of range");
+                }
+                out.emplace_back(file, off + sizeof(uint64_t), n);
+            }
+            return out;
+        }
+
+        /*------------------------------------------------Writer------------------------------------------------------------------------*/
+
+        template <class String>
+        Writer<String>::Writer(int fd)
+            : fd_(fd), buffer_(new char[kBufferSize]), iov_(new struct iovec[kMaxIov])
+        {
+            memcpy(stage(kHeaderSize), kMagic, kHeaderSize);
+            offset_ = kHeaderSize;
+        }
+
+        template <class String>
+        void Writer<String>::add(const String &s)
+        {
+            auto const n = s.size();
+            auto const rec = recordSize(n);
+            uint64_t const len = n;
+            index_.push_back(offset_);
+            offset_ += rec;
+            if (n < kGatherMin)
+            {
+                auto const p = stage(rec);
+                memcpy(p, &len, sizeof(len));
+                memcpy(p + sizeof(len), std::as_const(s).data(), n);
+                memset(p + sizeof(len) + n, 0, rec - sizeof(len) - n);
+                return;
+            }
+            memcpy(stage(sizeof(len)), &len, sizeof(len));
+            // 长字符串的数据不在对象里，pinned_扩容移动元素时地址不变
+            pinned_.push_back(s);
+            gather(std::as_const(pinned_.back()).data(), n);
+            memset(stage(rec - sizeof(len) - n), 0, rec - sizeof(len) - n);
+        }
+
+        template <class String>
+        size_t Writer<String>::finish()
+        {
+            auto const indexOffset = offset_;
+            // 索引直接从index_写出去，写完之前不能再动它
+            if (!index_.empty())
+            {
+                gather(reinterpret_cast<const char *>(index_.data()), index_.size() * sizeof(uint64_t));
+            }
+            uint64_t const footer[2] = {index_.size(), indexOffset};
+            auto const p = stage(kFooterSize);
+            memcpy(p, footer, sizeof(footer));
+            memcpy(p + sizeof(footer), kMagic, sizeof(kMagic));
+            flush();
+            return indexOffset + index_.size() * sizeof(uint64_t) + kFooterSize;
+        }
+
+        template <class String>
+        char *Writer<String>::stage(size_t n)
+        {
+            assert(n <= kBufferSize);
+            // 留一个位置给紧跟着的长字符串
+            if (kBufferSize - used_ < n || niov_ + 2 > kMaxIov)
+            {
+                flush();
+            }
+            auto const p = buffer_.get() + used_;
+            used_ += n;
+            if (niov_ > 0 && static_cast<char *>(iov_[niov_ - 1].iov_base) + iov_[niov_ - 1].iov_len == p)
+            {
+                iov_[niov_ - 1].iov_len += n;
+            }
+            else
+            {
+                iov_[niov_].iov_base = p;
+                iov_[niov_].iov_len = n;
+                ++niov_;
+            }
+            return p;
+        }
+
+        template <class String>
+        void Writer<String>::gather(const char *p, size_t n)
+        {
+            if (niov_ == kMaxIov)
+            {
+                flush();
+            }
+            iov_[niov_].iov_base = const_cast<char *>(p);
+            iov_[niov_].iov_len = n;
+            ++niov_;
+        }
+
+        template <class String>
+        void Writer<String>::flush()
+        {
+            if (niov_ > 0)
+            {
+                hio::writevAll(fd_, iov_.get(), niov_);
+            }
+            niov_ = 0;
+            used_ = 0;
+            pinned_.clear();
+        }
+    }
+}
+
+#endif
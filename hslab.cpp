@@ -0,0 +1,180 @@
+#include "hslab.h"
+#include "likely.h"
+
+#include <assert.h>
+#include <atomic>
+#include <mutex>
+
+using namespace fool;
+
+namespace
+{
+    // 线程缓存和全局链表之间一次交换的块数
+    constexpr size_t kBatch = 32;
+    // 线程缓存中每个大小类最多保留的块数，超过了就还一批给全局链表
+    constexpr size_t kMaxCached = 2 * kBatch;
+    // 每次向系统申请的slab大小
+    constexpr size_t kChunkSize = 64 * 1024;
+
+    // 空闲块本身的空间用来存放链表指针
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    struct FreeList
+    {
+        FreeBlock *head = nullptr;
+        size_t count = 0;
+
+        void push(void *p)
+        {
+            auto const b = static_cast<FreeBlock *>(p);
+            b->next = head;
+            head = b;
+            ++count;
+        }
+        void *pop()
+        {
+            assert(head != nullptr);
+            auto const b = head;
+            head = b->next;
+            --count;
+            return b;
+        }
+        // 从自己头部最多取出n个块挂到to上
+        void moveTo(FreeList &to, size_t n)
+        {
+            for (; n > 0 && head != nullptr; --n)
+            {
+                to.push(pop());
+            }
+        }
+    };
+
+    // 全局空闲链表，每个大小类一把锁
+    struct Central
+    {
+        std::mutex mutex;
+        FreeList list;
+    };
+
+    Central gCentral[slab_allocator::kNumClasses];
+    std::atomic<size_t> gReservedBytes(0);
+
+    // 切一块新的slab，一批放进线程缓存，剩下的放进全局链表
+    void carve(FreeList &local, size_t cls)
+    {
+        auto const blockSize = slab_allocator::classSize(cls);
+        auto const chunk = static_cast<char *>(checkedMalloc(kChunkSize));
+        gReservedBytes.fetch_add(kChunkSize, std::memory_order_relaxed);
+        auto const n = kChunkSize / blockSize;
+        size_t i = 0;
+        for (; i < n && i < kBatch; ++i)
+        {
+            local.push(chunk + i * blockSize);
+        }
+        if (i < n)
+        {
+            std::lock_guard<std::mutex> guard(gCentral[cls].mutex);
+            for (; i < n; ++i)
+            {
+                gCentral[cls].list.push(chunk + i * blockSize);
+            }
+        }
+    }
+
+    // 线程退出时把缓存的块全部还给全局链表
+    struct ThreadCache
+    {
+        FreeList lists[slab_allocator::kNumClasses];
+        ~ThreadCache();
+    };
+
+    thread_local ThreadCache tCache;
+    // 线程缓存析构之后还可能有字符串被释放（比如其他thread_local对象），这时直接还给全局链表
+    thread_local bool tCacheDead = false;
+
+    ThreadCache::~ThreadCache()
+    {
+        for (size_t cls = 0; cls < slab_allocator::kNumClasses; ++cls)
+        {
+            if (lists[cls].count > 0)
+            {
+                std::lock_guard<std::mutex> guard(gCentral[cls].mutex);
+                lists[cls].moveTo(gCentral[cls].list, lists[cls].count);
+            }
+        }
+        tCacheDead = true;
+    }
+}
+
+void *slab_allocator::allocateSmall(size_t cls)
+{
+    assert(cls < kNumClasses);
+    if (FOOL_UNLIKELY(tCacheDead))
+    {
+        std::lock_guard<std::mutex> guard(gCentral[cls].mutex);
+        if (gCentral[cls].list.head != nullptr)
+        {
+            return gCentral[cls].list.pop();
+        }
+        return checkedMalloc(classSize(cls));
+    }
+    auto &local = tCache.lists[cls];
+    if (FOOL_UNLIKELY(local.head == nullptr))
+    {
+        {
+            std::lock_guard<std::mutex> guard(gCentral[cls].mutex);
+            gCentral[cls].list.moveTo(local, kBatch);
+        }
+        if (local.head == nullptr)
+        {
+            carve(local, cls);
+        }
+    }
+    return local.pop();
+}
+
+void slab_allocator::deallocateSmall(void *p, size_t cls)
+{
+    assert(cls < kNumClasses);
+    if (FOOL_UNLIKELY(tCacheDead))
+    {
+        std::lock_guard<std::mutex> guard(gCentral[cls].mutex);
+        gCentral[cls].list.push(p);
+        return;
+    }
+    auto &local = tCache.lists[cls];
+    local.push(p);
+    if (FOOL_UNLIKELY(local.count > kMaxCached))
+    {
+        std::lock_guard<std::mutex> guard(gCentral[cls].mutex);
+        local.moveTo(gCentral[cls].list, kBatch);
+    }
+}
+
+void *slab_allocator::reallocate(void *p, size_t currentSize, size_t currentCapacity, size_t newCapacity)
+{
+    assert(currentSize <= currentCapacity && currentCapacity < newCapacity);
+    if (currentCapacity > kMaxSlabSize)
+    {
+        // 新旧两块都是malloc分配的
+        return smartRealloc(p, currentSize, currentCapacity, newCapacity);
+    }
+    if (newCapacity <= kMaxSlabSize && classOf(newCapacity) == classOf(currentCapacity))
+    {
+        // 同一个大小类，块本身就够大
+        return p;
+    }
+    auto const result = allocate(newCapacity);
+    std::memcpy(result, p, currentSize);
+    FOOL_HSTATS_ADD(ReallocBytesCopied, currentSize);
+    deallocateSmall(p, classOf(currentCapacity));
+    return result;
+}
+
+size_t slab_allocator::reservedBytes()
+{
+    return gReservedBytes.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,60 @@
+#ifndef HXMMXH_SLAB_H
+#define HXMMXH_SLAB_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#include "hmalloc.h"
+
+namespace fool
+{
+    // 中字符串（24-254个字符）专用的slab分配器，也是hstring_core默认的分配策略
+    // 256字节以内按16字节一级分成16个大小类，同一个大小类的块从64KB的slab里切出来
+    // 每个线程缓存一部分空闲块，分配和释放只操作线程自己的链表，不加锁
+    // 线程缓存空了或者满了，才和全局空闲链表成批交换；超过256字节的请求直接交给malloc
+    class slab_allocator
+    {
+    public:
+        static constexpr bool kMallocCompatible = false;
+        // slab负责的最大块
+        static constexpr size_t kMaxSlabSize = 256;
+        static constexpr size_t kClassGranularity = 16;
+        static constexpr size_t kNumClasses = kMaxSlabSize / kClassGranularity;
+
+        // bytes所在的大小类和这个大小类的块大小
+        static constexpr size_t classOf(size_t bytes) { return (bytes + kClassGranularity - 1) / kClassGranularity - 1; }
+        static constexpr size_t classSize(size_t cls) { return (cls + 1) * kClassGranularity; }
+
+        // slab里就是整个块的大小，其他的按malloc的粒度取整
+        static size_t goodSize(size_t bytes)
+        {
+            return bytes <= kMaxSlabSize ? classSize(classOf(bytes)) : goodMallocSize(bytes);
+        }
+        static void *allocate(size_t bytes)
+        {
+            return bytes <= kMaxSlabSize ? allocateSmall(classOf(bytes)) : checkedMalloc(bytes);
+        }
+        static void deallocate(void *p, size_t bytes)
+        {
+            if (bytes <= kMaxSlabSize)
+            {
+                deallocateSmall(p, classOf(bytes));
+            }
+            else
+            {
+                sizedFree(p, bytes);
+            }
+        }
+        static void *reallocate(void *p, size_t currentSize, size_t currentCapacity, size_t newCapacity);
+
+        // 从系统申请的slab总字节数，slab申请之后不会还给系统
+        static size_t reservedBytes();
+
+    private:
+        static void *allocateSmall(size_t cls);
+        static void deallocateSmall(void *p, size_t cls);
+    };
+}
+
+#endif
@@ -0,0 +1,228 @@
+#include "hstats.h"
+
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+using namespace fool;
+using namespace fool::hstats;
+
+namespace
+{
+    constexpr size_t kEvents = size_t(Event::kCount);
+    constexpr size_t kCategories = size_t(Category::kCount);
+
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<detail::ThreadCounters *> live;
+        // 已经退出的线程的累计值
+        Snapshot retired{};
+    };
+
+    // 线程退出的时候可能还有thread_local的字符串在析构，注册表本身不能先于它们销毁，所以故意不释放
+    Registry &registry()
+    {
+        static Registry *r = new Registry;
+        return *r;
+    }
+
+    void accumulate(Snapshot &s, const detail::ThreadCounters &c)
+    {
+        for (size_t i = 0; i < kEvents; ++i)
+        {
+            s.events[i] += c.events[i].load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < kCategories; ++i)
+        {
+            for (size_t j = 0; j < kSizeBuckets; ++j)
+            {
+                s.sizes[i][j] += c.sizes[i][j].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void zero(detail::ThreadCounters &c)
+    {
+        for (auto &e : c.events)
+        {
+            e.store(0, std::memory_order_relaxed);
+        }
+        for (auto &row : c.sizes)
+        {
+            for (auto &b : row)
+            {
+                b.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // 线程退出时把计数并进retired
+    // 之后这个线程再计数（其他thread_local对象的析构）会重新登记一份，留在live里不再回收，只是很少的一点泄漏
+    struct Reaper
+    {
+        ~Reaper()
+        {
+            auto const c = detail::tCounters;
+            if (c == nullptr)
+            {
+                return;
+            }
+            auto &r = registry();
+            std::lock_guard<std::mutex> guard(r.mutex);
+            accumulate(r.retired, *c);
+            r.live.erase(std::find(r.live.begin(), r.live.end(), c));
+            detail::tCounters = nullptr;
+            delete c;
+        }
+    };
+
+    thread_local Reaper tReaper;
+}
+
+detail::ThreadCounters *detail::registerThread()
+{
+    // 访问一次，保证线程退出时会调用Reaper的析构函数
+    (void)&tReaper;
+    auto const c = new ThreadCounters;
+    zero(*c);
+    auto &r = registry();
+    {
+        std::lock_guard<std::mutex> guard(r.mutex);
+        r.live.push_back(c);
+    }
+    tCounters = c;
+    return c;
+}
+
+Snapshot hstats::snapshot()
+{
+    auto &r = registry();
+    std::lock_guard<std::mutex> guard(r.mutex);
+    Snapshot s = r.retired;
+    for (auto c : r.live)
+    {
+        accumulate(s, *c);
+    }
+    return s;
+}
+
+void hstats::reset()
+{
+    auto &r = registry();
+    std::lock_guard<std::mutex> guard(r.mutex);
+    r.retired = Snapshot{};
+    for (auto c : r.live)
+    {
+        zero(*c);
+    }
+}
+
+const char *hstats::eventName(Event e)
+{
+    static const char *const names[] = {
+        "allocate",
+        "free",
+        "reallocate",
+        "realloc_bytes_copied",
+        "unshare",
+        "unshare_bytes_copied",
+        "medium_copy",
+        "medium_bytes_copied",
+        "small_to_medium",
+        "small_to_large",
+        "medium_to_large",
+        "slice",
+        "shrink_to_fit",
+    };
+    static_assert(sizeof(names) / sizeof(names[0]) == kEvents, "event names out of date");
+    return names[size_t(e)];
+}
+
+const char *hstats::categoryName(Category c)
+{
+    static const char *const names[] = {"small", "medium", "large"};
+    static_assert(sizeof(names) / sizeof(names[0]) == kCategories, "category names out of date");
+    return names[size_t(c)];
+}
+
+namespace
+{
+    // 第i个桶的下界
+    uint64_t bucketFloor(size_t i)
+    {
+        return i == 0 ? 0 : uint64_t(1) << (i - 1);
+    }
+}
+
+std::string hstats::toText(const Snapshot &s)
+{
+    std::string out;
+    for (size_t i = 0; i < kEvents; ++i)
+    {
+        out += eventName(Event(i));
+        out += ' ';
+        out += std::to_string(s.events[i]);
+        out += '\n';
+    }
+    for (size_t c = 0; c < kCategories; ++c)
+    {
+        for (size_t b = 0; b < kSizeBuckets; ++b)
+        {
+            if (s.sizes[c][b] == 0)
+            {
+                continue;
+            }
+            out += "size.";
+            out += categoryName(Category(c));
+            out += ".ge" + std::to_string(bucketFloor(b)) + ' ' + std::to_string(s.sizes[c][b]) + '\n';
+        }
+    }
+    return out;
+}
+
+std::string hstats::toJson(const Snapshot &s)
+{
+    std::string out = "{\"enabled\":";
+    out += kEnabled ? "true" : "false";
+    out += ",\"events\":{";
+    for (size_t i = 0; i < kEvents; ++i)
+    {
+        if (i > 0)
+        {
+            out += ',';
+        }
+        out += '"';
+        out += eventName(Event(i));
+        out += "\":" + std::to_string(s.events[i]);
+    }
+    // 直方图按桶的下界给出，只输出非零的桶
+    out += "},\"sizes\":{";
+    for (size_t c = 0; c < kCategories; ++c)
+    {
+        if (c > 0)
+        {
+            out += ',';
+        }
+        out += '"';
+        out += categoryName(Category(c));
+        out += "\":{";
+        bool first = true;
+        for (size_t b = 0; b < kSizeBuckets; ++b)
+        {
+            if (s.sizes[c][b] == 0)
+            {
+                continue;
+            }
+            if (!first)
+            {
+                out += ',';
+            }
+            first = false;
+            out += '"' + std::to_string(bucketFloor(b)) + "\":" + std::to_string(s.sizes[c][b]);
+        }
+        out += '}';
+    }
+    out += "}}";
+    return out;
+}
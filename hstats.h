@@ -0,0 +1,123 @@
+#ifndef HXMMXH_STATS_H
+#define HXMMXH_STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// hstring_core热路径上的计数器，定义FOOL_HSTRING_STATS时才打开（cmake -DHSTRING_STATS=ON）
+// 关掉时FOOL_HSTATS_*宏展开成空语句，没有任何开销
+// 这个宏会改变hstring_core模板的代码，所以整个程序的所有翻译单元必须一致地定义或者不定义
+//
+// 每个线程写自己的计数器，不用原子的读改写，只有单个写者的relaxed读写；snapshot()时把所有线程的加起来
+// 退出的线程的计数并进一个全局的累计值里，不会丢
+namespace fool
+{
+    namespace hstats
+    {
+#ifdef FOOL_HSTRING_STATS
+        constexpr bool kEnabled = true;
+#else
+        constexpr bool kEnabled = false;
+#endif
+
+        enum class Event : unsigned
+        {
+            Allocate,           // 向分配策略申请内存（中字符串的缓冲区或者大字符串的RefCounted）
+            Free,               // 释放内存
+            Reallocate,         // 扩容时重新分配
+            ReallocBytesCopied, // 重新分配时拷贝的字节数
+            Unshare,            // 写时复制，脱离共享
+            UnshareBytesCopied, // 脱离共享时拷贝的字节数
+            MediumCopy,         // 中字符串拷贝构造时的深拷贝
+            MediumBytesCopied,  // 深拷贝的字节数
+            SmallToMedium,      // 类型的转换
+            SmallToLarge,
+            MediumToLarge,
+            Slice,       // 共享内存的切片
+            ShrinkToFit, // shrink_to_fit或者自动收缩时重新分配
+            kCount,
+        };
+
+        enum class Category : unsigned
+        {
+            Small,
+            Medium,
+            Large,
+            kCount,
+        };
+
+        // 长度的直方图，第0个桶是长度0，第i个桶是[2^(i-1), 2^i)，最后一个桶包括所有更长的
+        constexpr size_t kSizeBuckets = 32;
+
+        struct Snapshot
+        {
+            uint64_t events[size_t(Event::kCount)];
+            uint64_t sizes[size_t(Category::kCount)][kSizeBuckets];
+
+            uint64_t operator[](Event e) const { return events[size_t(e)]; }
+        };
+
+        // 当前所有线程（包括已经退出的）的累计值
+        Snapshot snapshot();
+        // 清零，其他线程同时在计数时可能会有少量计数丢失
+        void reset();
+        const char *eventName(Event e);
+        const char *categoryName(Category c);
+        std::string toText(const Snapshot &s);
+        std::string toJson(const Snapshot &s);
+
+        namespace detail
+        {
+            struct ThreadCounters
+            {
+                std::atomic<uint64_t> events[size_t(Event::kCount)];
+                std::atomic<uint64_t> sizes[size_t(Category::kCount)][kSizeBuckets];
+            };
+
+            inline thread_local ThreadCounters *tCounters = nullptr;
+            // 线程第一次计数时登记自己的计数器
+            ThreadCounters *registerThread();
+
+            inline ThreadCounters &local()
+            {
+                auto c = tCounters;
+                return c != nullptr ? *c : *registerThread();
+            }
+
+            // 只有本线程会写，读其他线程的计数也是relaxed的，不需要lock前缀的指令
+            inline void bump(std::atomic<uint64_t> &a, uint64_t n)
+            {
+                a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            }
+
+            inline void add(Event e, uint64_t n)
+            {
+                bump(local().events[size_t(e)], n);
+            }
+
+            inline size_t bucketOf(size_t size)
+            {
+                auto const b = size == 0 ? 0 : size_t(64 - __builtin_clzll(size));
+                return b < kSizeBuckets ? b : kSizeBuckets - 1;
+            }
+
+            inline void recordSize(Category c, size_t size)
+            {
+                bump(local().sizes[size_t(c)][bucketOf(size)], 1);
+            }
+        }
+    }
+}
+
+#ifdef FOOL_HSTRING_STATS
+#define FOOL_HSTATS_ADD(event, n) ::fool::hstats::detail::add(::fool::hstats::Event::event, (n))
+#define FOOL_HSTATS_SIZE(category, size) ::fool::hstats::detail::recordSize(::fool::hstats::Category::category, (size))
+#else
+#define FOOL_HSTATS_ADD(event, n) ((void)0)
+#define FOOL_HSTATS_SIZE(category, size) ((void)0)
+#endif
+#define FOOL_HSTATS_COUNT(event) FOOL_HSTATS_ADD(event, 1)
+
+#endif
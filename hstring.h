@@ -2,9 +2,27 @@
 #define HXMMXH_STRING_H
 
 #include <string>
+#include <string_view>
 #include <atomic>
 #include <iterator>
 #include <utility>
+#include <algorithm>
+#include <initializer_list>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+#include <cstring>
+#include <assert.h>
+
+#include "hallocator.h"
+#include "hexception.h"
+#include "hmmap.h"
+#include "hrefcount.h"
+#include "hsearch.h"
+#include "hstats.h"
+#include "hslab.h"
+#include "htraits.h"
+#include "likely.h"
 
 #ifdef FOOL_ENDIAN_BE
 constexpr auto kIsLittleEndian = false;
@@ -19,52 +37,134 @@ namespace fool
         // POD（Plain Old Data）指的是能够像C语言中的结构体那样进行处理的一种数据类型，比如能够使用memcpy()来复制内存，使用memset()进行初始化等。
         // 传入两个迭代器，从b开始拷贝n个元素到d中
         template <class InIt, class OutIt>
-        inline std::pair<InIt, OutIt> copy_n(InIt b, typename std::iterator_traits<InIt>::difference_type n, OutIt d);
+        inline std::pair<InIt, OutIt> copy_n(InIt b, typename std::iterator_traits<InIt>::difference_type n, OutIt d)
+        {
+            for (; n != 0; --n, ++b, ++d)
+            {
+                *d = *b;
+            }
+            return std::make_pair(b, d);
+        }
         // 把b和e之间的元素都设为c,
         template <class Pod, class T>
-        inline void podFill(Pod *b, Pod *e, T c);
+        inline void podFill(Pod *b, Pod *e, T c)
+        {
+            assert(b && e && b <= e);
+            constexpr auto kUseMemset = sizeof(T) == 1;
+            if (kUseMemset)
+            {
+                memset(b, c, size_t(e - b));
+            }
+            else
+            {
+                auto const ee = b + ((e - b) & ~7u);
+                for (; b != ee; b += 8)
+                {
+                    b[0] = c;
+                    b[1] = c;
+                    b[2] = c;
+                    b[3] = c;
+                    b[4] = c;
+                    b[5] = c;
+                    b[6] = c;
+                    b[7] = c;
+                }
+                // Leftovers
+                for (; b != e; ++b)
+                {
+                    *b = c;
+                }
+            }
+        }
         // 把b和e之间的元素拷贝到d开头的空间
         template <class Pod>
-        inline void podCopy(const Pod *b, const Pod *e, Pod *d);
+        inline void podCopy(const Pod *b, const Pod *e, Pod *d)
+        {
+            assert(b != nullptr);
+            assert(e != nullptr);
+            assert(d != nullptr);
+            assert(e >= b);
+            assert(d >= e || d + (e - b) <= b);
+            memcpy(d, b, (e - b) * sizeof(Pod));
+        }
         // 把b和e之间的元素移动到d开头的空间
         template <class Pod>
-        inline void podMove(const Pod *b, const Pod *e, Pod *d);
+        inline void podMove(const Pod *b, const Pod *e, Pod *d)
+        {
+            assert(e >= b);
+            memmove(d, b, (e - b) * sizeof(*b));
+        }
     }
     // 定义一个特殊的获取方法来构造fbstring对象。AcquireMallocatedString意味着用户将一个指针传递给一个malloc分配的字符串，fbstring对象将保管这个字符串。??
     enum class AcquireMallocatedString
     {
     };
-    class hstring_core
+    // 把文件只读映射成一个大字符串，见basic_hstring_core对应的构造函数
+    enum class MapReadOnlyFile
+    {
+    };
+    // 超过小字符串长度的都用引用计数的方式存储，中字符串的拷贝也只增加引用计数，给需要大量共享同一个值的场合用（比如hstring_interner）
+    enum class RefCountedStorage
+    {
+    };
+    // hstring的存储部分，Alloc是分配策略（见hallocator.h），默认是给中字符串用的slab分配器
+    // RefPolicy是大字符串引用计数的线程策略（见hrefcount.h），只在一个线程里使用的字符串可以换成plain_refcount
+    // Traits是中/大字符串的分界和扩容的倍数（见htraits.h）
+    template <class Alloc = slab_allocator, class RefPolicy = atomic_refcount, class Traits = default_hstring_traits>
+    class basic_hstring_core
     {
     public:
+        typedef char value_type;
+        typedef Alloc allocator_type;
+        typedef RefPolicy refcount_policy;
+        typedef Traits traits_type;
+        // 直接放在对象里、不用分配内存的最大长度
+        static constexpr size_t inlineCapacity() { return maxSmallSize; }
         // 构造函数
         // 默认构造函数
-        hstring_core() noexcept { reset(); }
+        basic_hstring_core() noexcept { reset(); }
         // 拷贝构造函数
-        hstring_core(const hstring_core &rhs);
+        basic_hstring_core(const basic_hstring_core &rhs);
         // 移动构造函数
-        hstring_core(hstring_core &&goner) noexcept;
+        basic_hstring_core(basic_hstring_core &&goner) noexcept;
         // 通过char*构造字符串
-        hstring_core(const char *const data, const size_t size);
+        basic_hstring_core(const char *const data, const size_t size);
+        // 截取rhs中从pos开始的n个字符，大字符串不拷贝数据，直接共享rhs的整块内存（切片）
+        // 切片总是以\0结尾：截取的范围后面不是\0时不能往别人还在用的内存里写，只能复制
+        basic_hstring_core(const basic_hstring_core &rhs, const size_t pos, const size_t n);
+        // 同上，goner是整块内存唯一的持有者时接管过来，原地写\0，后面的数据谁也看不到了
+        basic_hstring_core(basic_hstring_core &&goner, const size_t pos, const size_t n);
         // 接管一个已分配空间的字符串, size表示原string的大小，allocatedSize表示原来分配的空间的大小,allocatedSize >= size + 1 and data[size] == '\0.类型固定为中字符串
-        hstring_core(char *const data, const size_t size, const size_t allocatedSize, AcquireMallocatedString);
+        basic_hstring_core(char *const data, const size_t size, const size_t allocatedSize, AcquireMallocatedString);
+        basic_hstring_core(const char *const data, const size_t size, RefCountedStorage);
+        // 用path的内容构造字符串。超过kReadFilePages页的文件直接mmap进来，不拷贝数据，最后一个引用释放时munmap
+        // 映射出来的字符串是覆盖整个文件的切片，和切片一样是只读的，修改时复制出自己的一份
+        basic_hstring_core(const char *path, MapReadOnlyFile);
         // 析构函数
-        ~hstring_core() noexcept;
+        ~basic_hstring_core() noexcept;
 
-        // 禁止拷贝赋值
-        hstring_core &operator=(const hstring_core &rhs) = delete;
+        // 赋值
+        // 大字符串的来源继续共享；否则容量够用并且没有共享时直接复用现有的空间，不重新分配
+        basic_hstring_core &operator=(const basic_hstring_core &rhs);
+        basic_hstring_core &operator=(basic_hstring_core &&goner) noexcept;
+        // data可以指向自己的数据
+        void assign(const char *const data, const size_t size);
 
-        void swap(hstring_core &rhs);
+        void swap(basic_hstring_core &rhs);
+        // 切片直接返回共享内存里的地址，后面同样是\0
         const char *data() const;
         char *data();
         // 返回可以修改的字符串，主要是针对COW的大字符串
         char *mutableData();
+        // 切片在创建时就保证了后面是\0，c_str()和data()一样只读，多个线程同时调用是安全的
         const char *c_str() const;
-        char *c_str();
         // 收缩空间，减小size
         void shrink(const size_t delta);
         // 设置容量，提高capacity，如果传入的值小于现有的capacity，不会缩小容量
         void reserve(size_t minCapacity);
+        // 按现在的长度重新分配，长度允许时降级成中字符串或者小字符串
+        // 别人还在用的大字符串复制一份只会多占内存，只有放得进小字符串时才搬出来；独占的切片复制出自己那一段，整块内存随之释放
+        void shrinkToFit();
         // 往字符串中增加delta个字符，exGrowth表示需要扩容时是否要分配额外的空间。返回新增加的字符的首地址
         char *expandNoinit(const size_t delta, bool expGrowth = false);
         void push_back(char c);
@@ -90,8 +190,16 @@ namespace fool
         // 是否在共享内存
         bool isShared() const
         {
-            return category() == Category::isLarge && RefCounted::refs(ml_.data_) > 1;
+            return category() == Category::isLarge && (isSlice() || RefCounted::refs(ml_.data_) > 1);
+        }
+        // 是否是共享别的大字符串内存的切片
+        bool isSlice() const
+        {
+            return category() == Category::isLarge && (ml_.capacity_ & kSliceFlag) != 0;
         }
+        // 内容的哈希值，和std::hash<std::string_view>的结果相同
+        // 不是切片的大字符串把它缓存在RefCounted里，共享同一块内存的拷贝只算一次，修改时作废
+        size_t hash() const;
 
     private:
         class MediumLarge
@@ -121,6 +229,8 @@ namespace fool
             static void incrementRefs(char *p);
             // 递减引用计数，要注意在引用计数位0时，析构对象
             static void decrementRefs(char *p);
+            // 释放整块内存；缓存引用的策略（deferred_refcount）在自己手里把计数减到0时通过它释放
+            static void release(typename RefPolicy::counter_type &c);
             // 创建一个引用计数
             static RefCounted *create(size_t *size);
             static RefCounted *create(const char *data, size_t *size);
@@ -132,8 +242,16 @@ namespace fool
                 size_t *newCapacity);
 
         public:
-            std::atomic<size_t> refCount_;
+            typename RefPolicy::counter_type refCount_;
+            // 缓存的哈希值，0表示还没有算过（哈希值正好是0时不缓存）
+            // 共享的拷贝可能在多个线程里同时读写，和引用计数的策略无关，总是原子的
+            std::atomic<size_t> hash_;
+            // 分配的容量（不含\0），切片不知道整块内存有多大，释放时从这里取
+            // 带kMappedFlag时这块内存是映射进来的文件，其余的位是文件大小
+            size_t capacity_;
             char data_[1];
+
+            constexpr static size_t kMappedFlag = size_t(1) << (sizeof(size_t) * 8 - 1);
         };
         // 这个union的大小是MediumLarge的大小
         union
@@ -146,7 +264,10 @@ namespace fool
         // SSO的最大长度
         constexpr static size_t maxSmallSize = lastChar / sizeof(char);
         // medium string的最大长度
-        constexpr static size_t maxMediumSize = 254 / sizeof(char);
+        constexpr static size_t maxMediumSize = Traits::kMaxMediumSize / sizeof(char);
+        // 超过这么多页的文件才映射进来，更小的直接读
+        // 映射要多一页头部、一次MAP_FIXED、释放时munmap，每页还有一次缺页；mmap_bench上加载并读一遍在64页左右和读文件持平
+        constexpr static size_t kReadFilePages = 64;
         // 获取类型的掩码
         constexpr static uint8_t categoryExtractMask = kIsLittleEndian ? 0xC0 : 0x3;
         // 为了把category左移到最高位的那一个字节
@@ -155,14 +276,22 @@ namespace fool
         constexpr static size_t capacityExtractMask = kIsLittleEndian
                                                           ? ~(size_t(categoryExtractMask) << kCategoryShift)
                                                           : 0x0 /* unused */;
+        // 切片的标记，用的是capacity_最高字节里类型位之外的一位（max_size()保证容量用不到这些位）
+        // 切片的capacity_不再是容量，而是data_在整块内存里的偏移，容量就是size_
+        constexpr static size_t kSliceFlag = kIsLittleEndian
+                                                 ? size_t(0x20) << kCategoryShift
+                                                 : size_t(1) << (sizeof(size_t) * 8 - 1);
 
-        void copySmall(const hstring_core &);
-        void copyMedium(const hstring_core &);
-        void copyLarge(const hstring_core &);
+        void copySmall(const basic_hstring_core &);
+        void copyMedium(const basic_hstring_core &);
+        void copyLarge(const basic_hstring_core &);
 
-        void initSmall(const char *data, size_t size);
+        // 对齐时按字读取会越过字符串的结尾（不会跨页），需要关掉ASan的检查
+        __attribute__((no_sanitize_address)) void initSmall(const char *data, size_t size);
         void initMedium(const char *data, size_t size);
         void initLarge(const char *data, size_t size);
+        // 按大小选择上面三种初始化方式
+        void init(const char *data, size_t size);
 
         void reserveSmall(size_t minCapacity);
         void reserveMedium(size_t minCapacity);
@@ -176,6 +305,19 @@ namespace fool
         void unshare(size_t minCapacity = 0);
         // 对于大字符串，返回可修改的地址，即写时复制时用得上
         char *mutableDataLarge();
+        // 大字符串所在整块内存的data_，切片要减去偏移，引用计数都通过它来操作
+        char *sharedData() const;
+        // 独占的大字符串要原地修改内容之前调用，作废缓存的哈希值
+        void dropCachedHash()
+        {
+            if (category() == Category::isLarge && !isSlice())
+            {
+                RefCounted::fromData(ml_.data_)->hash_.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        // Traits::kCompactDivisor不为0时，长度不超过占用空间的1/kCompactDivisor就shrinkToFit()
+        void maybeCompact();
 
         // 获取小字符串的size
         size_t smallSize() const;
@@ -183,6 +325,1869 @@ namespace fool
         void setSmallSize(size_t s);
         void reset() { setSmallSize(0); }
         void destroyMediumLarge() noexcept;
+
+        static_assert(maxMediumSize >= maxSmallSize, "Traits::kMaxMediumSize must not be below the small string size");
+        static_assert(maxMediumSize <= (size_t(-1) >> 4), "Traits::kMaxMediumSize exceeds max_size()");
+        static_assert(Traits::kFirstGrowth > maxSmallSize, "Traits::kFirstGrowth must leave the small string");
+        static_assert(Traits::kGrowthDenominator > 0 && Traits::kGrowthNumerator > Traits::kGrowthDenominator,
+                      "Traits growth factor must be greater than 1");
+    };
+
+    typedef basic_hstring_core<> hstring_core;
+    // 不跨线程共享的字符串用的存储
+    typedef basic_hstring_core<slab_allocator, plain_refcount> local_hstring_core;
+    // 很多线程同时拷贝同一批大字符串时用的存储，见deferred_refcount
+    typedef basic_hstring_core<slab_allocator, deferred_refcount> deferred_hstring_core;
+    // 会长到几十MB以上的字符串用的存储，1MB以上的块用mmap分配、mremap扩容，见mmap_allocator
+    typedef basic_hstring_core<mmap_allocator<>> mmap_hstring_core;
+
+    /*------------------------------------------MediumLarge------------------------------------------------------------------------------*/
+
+    template <class Alloc, class RefPolicy, class Traits>
+    size_t basic_hstring_core<Alloc, RefPolicy, Traits>::MediumLarge::capacity() const
+    {
+        // 小端法，和掩码并
+        // 大端法，右移两位就行了
+        return kIsLittleEndian ? capacity_ & capacityExtractMask & ~kSliceFlag : (capacity_ & ~kSliceFlag) >> 2;
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::MediumLarge::setCapacity(size_t cap, Category cat)
+    {
+        // 小端法，把category左移到最高位的那个字节，也就是地址最高的字节
+        // 大端法，就把cap左移两位，把最低位的两个Bit空出来
+        capacity_ = kIsLittleEndian
+                        ? cap | (static_cast<size_t>(cat) << kCategoryShift)
+                        : (cap << 2) | static_cast<size_t>(cat);
+    }
+
+    /*------------------------------------------RefCounted------------------------------------------------------------------------------*/
+
+    template <class Alloc, class RefPolicy, class Traits>
+    constexpr size_t basic_hstring_core<Alloc, RefPolicy, Traits>::RefCounted::getDataOffset()
+    {
+        return offsetof(RefCounted, data_);
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    typename basic_hstring_core<Alloc, RefPolicy, Traits>::RefCounted *basic_hstring_core<Alloc, RefPolicy, Traits>::RefCounted::fromData(char *p)
+    {
+        return static_cast<RefCounted *>(static_cast<void *>(p - getDataOffset()));
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    size_t basic_hstring_core<Alloc, RefPolicy, Traits>::RefCounted::refs(char *p)
+    {
+        return RefPolicy::load(fromData(p)->refCount_);
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::RefCounted::incrementRefs(char *p)
+    {
+        if constexpr (RefPolicy::kCachesReferences)
+        {
+            RefPolicy::increment(fromData(p)->refCount_, &RefCounted::release);
+        }
+        else
+        {
+            RefPolicy::increment(fromData(p)->refCount_);
+        }
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::RefCounted::decrementRefs(char *p)
+    {
+        auto const dis = fromData(p);
+        // 返回的是旧值
+        size_t oldcnt = RefPolicy::decrement(dis->refCount_);
+        assert(oldcnt > 0);
+        if (oldcnt == 1)
+        {
+            release(dis->refCount_);
+        }
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::RefCounted::release(typename RefPolicy::counter_type &c)
+    {
+        // refCount_是第一个成员
+        auto const dis = reinterpret_cast<RefCounted *>(&c);
+        assert(&dis->refCount_ == &c);
+        FOOL_HSTATS_COUNT(Free);
+        if (FOOL_UNLIKELY(dis->capacity_ & kMappedFlag))
+        {
+            hmmap::unmapFile(dis->data_, dis->capacity_ & ~kMappedFlag);
+        }
+        else
+        {
+            Alloc::deallocate(dis, getDataOffset() + (dis->capacity_ + 1) * sizeof(char));
+        }
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    typename basic_hstring_core<Alloc, RefPolicy, Traits>::RefCounted *basic_hstring_core<Alloc, RefPolicy, Traits>::RefCounted::create(size_t *size)
+    {
+        // 分配器实际给出的空间可能比申请的多，多出来的部分也算进容量
+        const size_t allocSize = Alloc::goodSize(getDataOffset() + (*size + 1) * sizeof(char));
+        auto result = static_cast<RefCounted *>(Alloc::allocate(allocSize));
+        FOOL_HSTATS_COUNT(Allocate);
+        RefPolicy::init(result->refCount_, 1);
+        result->hash_.store(0, std::memory_order_relaxed);
+        *size = (allocSize - getDataOffset()) / sizeof(char) - 1;
+        result->capacity_ = *size;
+        return result;
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    typename basic_hstring_core<Alloc, RefPolicy, Traits>::RefCounted *basic_hstring_core<Alloc, RefPolicy, Traits>::RefCounted::create(const char *data, size_t *size)
+    {
+        const size_t effectiveSize = *size;
+        auto result = create(size);
+        if (FOOL_LIKELY(effectiveSize > 0))
+        {
+            hstring_detail::podCopy(data, data + effectiveSize, result->data_);
+        }
+        return result;
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    typename basic_hstring_core<Alloc, RefPolicy, Traits>::RefCounted *basic_hstring_core<Alloc, RefPolicy, Traits>::RefCounted::reallocate(char *const data, const size_t currentSize, const size_t currentCapacity, size_t *newCapacity)
+    {
+        assert(*newCapacity > 0 && *newCapacity > currentSize);
+        // 形参中的newCapacity只是字符串的大小，需要加上\0和RefCounted结构体的大小
+        const size_t allocNewCapacity = Alloc::goodSize(getDataOffset() + (*newCapacity + 1) * sizeof(char));
+        auto const dis = fromData(data);
+        assert(RefPolicy::load(dis->refCount_) == 1);
+        FOOL_HSTATS_COUNT(Reallocate);
+        // 把整个结构体重新分配内存
+        auto result = static_cast<RefCounted *>(Alloc::reallocate(
+            dis,
+            getDataOffset() + (currentSize + 1) * sizeof(char),
+            getDataOffset() + (currentCapacity + 1) * sizeof(char),
+            allocNewCapacity));
+        assert(RefPolicy::load(result->refCount_) == 1);
+        *newCapacity = (allocNewCapacity - getDataOffset()) / sizeof(char) - 1;
+        result->capacity_ = *newCapacity;
+        return result;
+    }
+
+    /*------------------------------------------------构造和析构函数------------------------------------------------------------------------*/
+
+    template <class Alloc, class RefPolicy, class Traits>
+    basic_hstring_core<Alloc, RefPolicy, Traits>::basic_hstring_core(const basic_hstring_core &rhs)
+    {
+        assert(&rhs != this);
+        // 根据不同的类型，调用不同的方法
+        switch (rhs.category())
+        {
+        case Category::isSmall:
+            copySmall(rhs);
+            break;
+        case Category::isMedium:
+            copyMedium(rhs);
+            break;
+        case Category::isLarge:
+            copyLarge(rhs);
+            break;
+        default:
+            break;
+        }
+        assert(size() == rhs.size());
+        assert(memcmp(data(), rhs.data(), size() * sizeof(char)) == 0);
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    basic_hstring_core<Alloc, RefPolicy, Traits>::basic_hstring_core(basic_hstring_core &&goner) noexcept
+    {
+        ml_ = goner.ml_;
+        goner.reset();
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    basic_hstring_core<Alloc, RefPolicy, Traits>::basic_hstring_core(const char *const data, const size_t size)
+    {
+        init(data, size);
+        assert(this->size() == size);
+        assert(size == 0 || memcmp(this->data(), data, size * sizeof(char)) == 0);
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    basic_hstring_core<Alloc, RefPolicy, Traits>::basic_hstring_core(char *const data, const size_t size, const size_t allocatedSize, AcquireMallocatedString)
+    {
+        if (size > 0)
+        {
+            assert(allocatedSize >= size + 1);
+            assert(data[size] == '\0');
+            if (Alloc::kMallocCompatible)
+            {
+                // 用中字符串的存储模式
+                ml_.data_ = data;
+                ml_.size_ = size;
+                // -1是为了去除\0
+                ml_.setCapacity(allocatedSize - 1, Category::isMedium);
+            }
+            else
+            {
+                // 分配策略不能释放malloc的内存，只能拷贝一份再把原来的释放掉
+                init(data, size);
+                free(data);
+            }
+        }
+        else
+        {
+            // size为0，释放data指向的空间，自身也初始化为空
+            free(data);
+            reset();
+        }
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    basic_hstring_core<Alloc, RefPolicy, Traits>::basic_hstring_core(const basic_hstring_core &rhs, const size_t pos, const size_t n)
+    {
+        assert(pos + n <= rhs.size());
+        if (rhs.category() != Category::isLarge || n <= maxSmallSize)
+        {
+            // 小字符串放进自己的空间里，不让它拖着整块大内存
+            init(rhs.data() + pos, n);
+        }
+        else if (pos == 0 && n == rhs.size() && !rhs.isSlice())
+        {
+            copyLarge(rhs);
+        }
+        else if (rhs.ml_.data_[pos + n] != '\0')
+        {
+            // 切片当不了C字符串，rhs的内存又不能写，只能复制
+            init(rhs.data() + pos, n);
+        }
+        else
+        {
+            auto const base = rhs.sharedData();
+            RefCounted::incrementRefs(base);
+            FOOL_HSTATS_COUNT(Slice);
+            ml_.data_ = rhs.ml_.data_ + pos;
+            ml_.size_ = n;
+            ml_.setCapacity(size_t(ml_.data_ - base), Category::isLarge);
+            ml_.capacity_ |= kSliceFlag;
+            assert(isSlice() && sharedData() == base);
+        }
+        assert(size() == n);
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    basic_hstring_core<Alloc, RefPolicy, Traits>::basic_hstring_core(basic_hstring_core &&goner, const size_t pos, const size_t n)
+    {
+        assert(pos + n <= goner.size());
+        reset();
+        if (pos == 0 && n == goner.size())
+        {
+            swap(goner);
+            return;
+        }
+        if (goner.category() != Category::isLarge || n <= maxSmallSize || RefCounted::refs(goner.sharedData()) != 1 ||
+            (RefCounted::fromData(goner.sharedData())->capacity_ & RefCounted::kMappedFlag) != 0)
+        {
+            // 还有别人在用，或者是只读的映射
+            basic_hstring_core(goner, pos, n).swap(*this);
+            return;
+        }
+        auto const base = goner.sharedData();
+        FOOL_HSTATS_COUNT(Slice);
+        ml_.data_ = goner.ml_.data_ + pos;
+        ml_.size_ = n;
+        ml_.setCapacity(size_t(ml_.data_ - base), Category::isLarge);
+        ml_.capacity_ |= kSliceFlag;
+        ml_.data_[n] = '\0';
+        // 引用计数转给了自己
+        goner.reset();
+        assert(isSlice() && sharedData() == base && size() == n);
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    basic_hstring_core<Alloc, RefPolicy, Traits>::basic_hstring_core(const char *const data, const size_t size, RefCountedStorage)
+    {
+        // 大字符串的各种操作不依赖长度，比maxMediumSize短也没有问题
+        if (size <= maxSmallSize)
+        {
+            initSmall(data, size);
+        }
+        else
+        {
+            initLarge(data, size);
+        }
+        assert(this->size() == size);
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    basic_hstring_core<Alloc, RefPolicy, Traits>::basic_hstring_core(const char *path, MapReadOnlyFile)
+    {
+        static_assert(RefCounted::getDataOffset() <= 4096, "RefCounted must fit in the page before the mapping");
+        reset();
+        hmmap::File file(path);
+        auto const size = file.size();
+        if (size <= kReadFilePages * hmmap::pageSize())
+        {
+            // 小文件映射反而更慢，读出来就行；读失败时临时对象负责释放
+            basic_hstring_core tmp;
+            file.read(tmp.expandNoinit(size), size);
+            tmp.swap(*this);
+            return;
+        }
+        auto const data = hmmap::mapFile(file);
+        auto const rc = RefCounted::fromData(data);
+        RefPolicy::init(rc->refCount_, 1);
+        rc->hash_.store(0, std::memory_order_relaxed);
+        rc->capacity_ = RefCounted::kMappedFlag | size;
+        // 偏移为0的切片：容量等于长度，任何修改都会先复制，不会写到只读的页上
+        ml_.data_ = data;
+        ml_.size_ = size;
+        ml_.setCapacity(0, Category::isLarge);
+        ml_.capacity_ |= kSliceFlag;
+        assert(isSlice() && sharedData() == data && c_str() == data);
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    basic_hstring_core<Alloc, RefPolicy, Traits>::~basic_hstring_core() noexcept
+    {
+        // 如果是小字符串，空间都在栈上，没有在堆里，不需要什么操作
+        if (category() == Category::isSmall)
+        {
+            return;
+        }
+        destroyMediumLarge();
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::destroyMediumLarge() noexcept
+    {
+        auto const c = category();
+        assert(c != Category::isSmall);
+        if (c == Category::isMedium)
+        {
+            FOOL_HSTATS_COUNT(Free);
+            Alloc::deallocate(ml_.data_, (ml_.capacity() + 1) * sizeof(char));
+        }
+        else
+        {
+            RefCounted::decrementRefs(sharedData());
+        }
+    }
+
+    /*------------------------------------------------初始化数据函数------------------------------------------------------------------------*/
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::initSmall(const char *const data, const size_t size)
+    {
+        // basic_hstring_core的布局为Char* data_, size_t size_, size_t capacity_
+        // basic_hstring_core的大小也就是MediumLarge的大小，一个char*和两个size_t
+        static_assert(sizeof(*this) == sizeof(char *) + 2 * sizeof(size_t), "fbstring has unexpected size");
+        static_assert(sizeof(char *) == sizeof(size_t), "fbstring size assumption violation");
+        // sizeof(size_t) must be a power of 2
+        static_assert((sizeof(size_t) & (sizeof(size_t) - 1)) == 0, "fbstring size assumption violation");
+
+        // 如果传入的字符串地址是内存对齐的，则配合 reinterpret_cast 进行 word-wise copy，提高效率。
+        if ((reinterpret_cast<size_t>(data) & (sizeof(size_t) - 1)) == 0)
+        {
+            const size_t byteSize = size * sizeof(char);
+            constexpr size_t wordWidth = sizeof(size_t);
+            // 求出size占多少字节，因为最大23，最多只占3字节
+            switch ((byteSize + wordWidth - 1) / wordWidth)
+            {
+            case 3:
+                // 最后一个字节是capacity
+                ml_.capacity_ = reinterpret_cast<const size_t *>(data)[2];
+                [[fallthrough]]; //指示从前一标号直落是有意的，而在发生直落时给出警告的编译器不应诊断
+            case 2:
+                // 第二个字节是size
+                ml_.size_ = reinterpret_cast<const size_t *>(data)[1];
+                [[fallthrough]];
+            case 1:
+                // 第一个字节是data
+                ml_.data_ = *reinterpret_cast<char **>(const_cast<char *>(data));
+                [[fallthrough]];
+            case 0:
+                break;
+            }
+        }
+        else
+        {
+            if (size != 0)
+            {
+                hstring_detail::podCopy(data, data + size, small_);
+            }
+        }
+
+        setSmallSize(size);
+        FOOL_HSTATS_SIZE(Small, size);
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::initMedium(const char *const data, const size_t size)
+    {
+        auto const allocSize = Alloc::goodSize((1 + size) * sizeof(char));
+        ml_.data_ = static_cast<char *>(Alloc::allocate(allocSize));
+        FOOL_HSTATS_COUNT(Allocate);
+        FOOL_HSTATS_SIZE(Medium, size);
+        if (FOOL_LIKELY(size > 0))
+        {
+            hstring_detail::podCopy(data, data + size, ml_.data_);
+        }
+        ml_.size_ = size;
+        ml_.setCapacity(allocSize / sizeof(char) - 1, Category::isMedium);
+        ml_.data_[size] = '\0';
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::init(const char *const data, const size_t size)
+    {
+        // 根据字符串的大小调用不同方法
+        if (size <= maxSmallSize)
+        {
+            initSmall(data, size);
+        }
+        else if (size <= maxMediumSize)
+        {
+            initMedium(data, size);
+        }
+        else
+        {
+            initLarge(data, size);
+        }
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::initLarge(const char *const data, const size_t size)
+    {
+        size_t effectiveCapacity = size;
+        auto const newRC = RefCounted::create(data, &effectiveCapacity);
+        FOOL_HSTATS_SIZE(Large, size);
+        ml_.data_ = newRC->data_;
+        ml_.size_ = size;
+        ml_.setCapacity(effectiveCapacity, Category::isLarge);
+        ml_.data_[size] = '\0';
+    }
+
+    /*------------------------------------------------赋值函数------------------------------------------------------------------------*/
+
+    template <class Alloc, class RefPolicy, class Traits>
+    basic_hstring_core<Alloc, RefPolicy, Traits> &basic_hstring_core<Alloc, RefPolicy, Traits>::operator=(const basic_hstring_core &rhs)
+    {
+        if (FOOL_UNLIKELY(&rhs == this))
+        {
+            return *this;
+        }
+        if (rhs.category() == Category::isLarge)
+        {
+            // 共享比拷贝便宜，原来的空间交给临时对象释放
+            basic_hstring_core(rhs).swap(*this);
+        }
+        else
+        {
+            assign(rhs.data(), rhs.size());
+        }
+        assert(size() == rhs.size());
+        return *this;
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    basic_hstring_core<Alloc, RefPolicy, Traits> &basic_hstring_core<Alloc, RefPolicy, Traits>::operator=(basic_hstring_core &&goner) noexcept
+    {
+        if (FOOL_LIKELY(&goner != this))
+        {
+            if (category() != Category::isSmall)
+            {
+                destroyMediumLarge();
+            }
+            ml_ = goner.ml_;
+            goner.reset();
+        }
+        return *this;
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::assign(const char *const data, const size_t size)
+    {
+        switch (category())
+        {
+        case Category::isSmall:
+            if (size <= maxSmallSize)
+            {
+                hstring_detail::podMove(data, data + size, small_);
+                setSmallSize(size);
+                return;
+            }
+            break;
+        case Category::isLarge:
+            // 共享的空间不能写，切片的容量就是长度，也当作共享处理
+            if (isShared())
+            {
+                break;
+            }
+            // 独占的大字符串和中字符串一样处理
+            [[fallthrough]];
+        case Category::isMedium:
+            // 打开了自动收缩时，短的值不占着大的空间
+            if (size <= ml_.capacity() && (Traits::kCompactDivisor == 0 || size * Traits::kCompactDivisor > ml_.capacity()))
+            {
+                // 中字符串哪怕放得进小字符串也留着原来的空间，循环赋值时不会反复分配和释放
+                dropCachedHash();
+                hstring_detail::podMove(data, data + size, ml_.data_);
+                ml_.size_ = size;
+                ml_.data_[size] = '\0';
+                return;
+            }
+            break;
+        default:
+            __builtin_unreachable();
+        }
+        // 先构造好新的再释放原来的，data指向自己的数据时也没有问题
+        basic_hstring_core(data, size).swap(*this);
+        assert(this->size() == size);
+    }
+
+    /*------------------------------------------------拷贝数据函数------------------------------------------------------------------------*/
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::copySmall(const basic_hstring_core &rhs)
+    {
+        // basic_hstring_core的布局为Char* data_, size_t size_, size_t capacity_
+        static_assert(offsetof(MediumLarge, data_) == 0, "fbstring layout failure");
+        static_assert(offsetof(MediumLarge, size_) == sizeof(ml_.data_), "fbstring layout failure");
+        static_assert(offsetof(MediumLarge, capacity_) == 2 * sizeof(ml_.data_), "fbstring layout failure");
+        // 简单粗暴，直接拷贝过来
+        ml_ = rhs.ml_;
+        assert(category() == Category::isSmall && this->size() == rhs.size());
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::copyMedium(const basic_hstring_core &rhs)
+    {
+        // 执行一次深拷贝
+        auto const allocSize = Alloc::goodSize((1 + rhs.ml_.size_) * sizeof(char));
+        // 分配空间
+        ml_.data_ = static_cast<char *>(Alloc::allocate(allocSize));
+        FOOL_HSTATS_COUNT(Allocate);
+        FOOL_HSTATS_COUNT(MediumCopy);
+        FOOL_HSTATS_ADD(MediumBytesCopied, rhs.ml_.size_);
+        // 把结尾的/0也拷贝进去
+        hstring_detail::podCopy(rhs.ml_.data_, rhs.ml_.data_ + rhs.ml_.size_ + 1, ml_.data_);
+        ml_.size_ = rhs.ml_.size_;
+        ml_.setCapacity(allocSize / sizeof(char) - 1, Category::isMedium);
+        assert(category() == Category::isMedium);
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::copyLarge(const basic_hstring_core &rhs)
+    {
+        // ROW,增加一次引用计数就行了，data指向同一个地址，切片拷贝出来还是切片
+        ml_ = rhs.ml_;
+        RefCounted::incrementRefs(sharedData());
+        assert(category() == Category::isLarge && size() == rhs.size());
+    }
+
+    /*------------------------------------------------获取数据函数------------------------------------------------------------------------*/
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::swap(basic_hstring_core &rhs)
+    {
+        auto const t = ml_;
+        ml_ = rhs.ml_;
+        rhs.ml_ = t;
+    }
+    template <class Alloc, class RefPolicy, class Traits>
+    const char *basic_hstring_core<Alloc, RefPolicy, Traits>::data() const
+    {
+        // 提示编译器生成 CMOV 指令
+        // 条件传送。类似于 MOV 指令，但是依赖于 RFLAGS 寄存器内的状态。如果条件没有满足，该指令不会有任何效果。
+        // CMOV 的优点是可以避免分支预测，避免分支预测错误对 CPU 流水线的影响
+        const char *ptr = ml_.data_;
+        ptr = (category() == Category::isSmall) ? small_ : ptr;
+        return ptr;
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    char *basic_hstring_core<Alloc, RefPolicy, Traits>::data()
+    {
+        char *ptr = ml_.data_;
+        ptr = (category() == Category::isSmall) ? small_ : ptr;
+        return ptr;
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    char *basic_hstring_core<Alloc, RefPolicy, Traits>::mutableData()
+    {
+        switch (category())
+        {
+        case Category::isSmall:
+            return small_;
+        case Category::isMedium:
+            return ml_.data_;
+        case Category::isLarge:
+            return mutableDataLarge();
+        }
+        __builtin_unreachable();
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    const char *basic_hstring_core<Alloc, RefPolicy, Traits>::c_str() const
+    {
+        assert(data()[size()] == '\0');
+        return data();
+    }
+
+    /*--------------------------------------------------操纵字符串----------------------------------------------------------------------*/
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::shrink(const size_t delta)
+    {
+        if (category() == Category::isSmall)
+        {
+            shrinkSmall(delta);
+        }
+        // 放大字符串没有共享时，和中字符串一样的收缩方式
+        else if (category() == Category::isMedium || (!isSlice() && RefCounted::refs(ml_.data_) == 1))
+        {
+            dropCachedHash();
+            shrinkMedium(delta);
+        }
+        else
+        {
+            shrinkLarge(delta);
+        }
+        maybeCompact();
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::reserve(size_t minCapacity)
+    {
+        switch (category())
+        {
+        case Category::isSmall:
+            reserveSmall(minCapacity);
+            break;
+        case Category::isMedium:
+            reserveMedium(minCapacity);
+            break;
+        case Category::isLarge:
+            reserveLarge(minCapacity);
+            break;
+        default:
+            __builtin_unreachable();
+        }
+        assert(capacity() >= minCapacity);
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    char *basic_hstring_core<Alloc, RefPolicy, Traits>::expandNoinit(const size_t delta, bool expGrowth)
+    {
+        // 获取足够的空间，然后修改size就行了
+        // 返回新增元素的首地址
+        assert(capacity() >= size());
+        size_t sz, newSz;
+        if (category() == Category::isSmall)
+        {
+            sz = smallSize();
+            newSz = sz + delta;
+            if (FOOL_LIKELY(newSz <= maxSmallSize))
+            {
+                setSmallSize(newSz);
+                return small_ + sz;
+            }
+            reserveSmall(expGrowth ? std::max(newSz, Traits::kFirstGrowth) : newSz);
+        }
+        else
+        {
+            sz = ml_.size_;
+            newSz = sz + delta;
+            if (FOOL_UNLIKELY(isSlice()))
+            {
+                // 切片不能往共享的内存里写，先复制出自己的一份
+                unshare(expGrowth ? std::max(newSz, 1 + sz * Traits::kGrowthNumerator / Traits::kGrowthDenominator) : newSz);
+            }
+            else if (FOOL_UNLIKELY(newSz > capacity()))
+            {
+                // 默认扩容1.5倍
+                reserve(expGrowth ? std::max(newSz, 1 + capacity() * Traits::kGrowthNumerator / Traits::kGrowthDenominator) : newSz);
+            }
+        }
+        assert(capacity() >= newSz);
+        // 如果类型是小字符串，在前面就已经返回了
+        assert(category() == Category::isMedium || category() == Category::isLarge);
+        dropCachedHash();
+        ml_.size_ = newSz;
+        ml_.data_[newSz] = '\0';
+        assert(size() == newSz);
+        // 最后返回新分配的空间的首地址加上sz
+        return ml_.data_ + sz;
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::push_back(char c)
+    {
+        *expandNoinit(1, true) = c;
+    }
+    /*------------------------------------------------------------------------------------------------------------------------*/
+    template <class Alloc, class RefPolicy, class Traits>
+    size_t basic_hstring_core<Alloc, RefPolicy, Traits>::smallSize() const
+    {
+        assert(category() == Category::isSmall);
+        // 小端法不需要移位，大端法时需要右移两位才能得到真实的size
+        constexpr auto shift = kIsLittleEndian ? 0 : 2;
+        auto smallShifted = static_cast<size_t>(small_[maxSmallSize]) >> shift;
+        assert(static_cast<size_t>(maxSmallSize) >= smallShifted);
+        // 实际存储的时maxSmallSize-size，最后还要换算一下
+        return static_cast<size_t>(maxSmallSize) - smallShifted;
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::setSmallSize(size_t s)
+    {
+        assert(s <= maxSmallSize);
+        // 让Release下的编译器也知道下标不会越界，否则small_[s]会报-Wstringop-overflow
+        if (s > maxSmallSize)
+        {
+            __builtin_unreachable();
+        }
+        constexpr auto shift = kIsLittleEndian ? 0 : 2;
+        small_[maxSmallSize] = char((maxSmallSize - s) << shift);
+        // 为了匹配原生的string,还是加上\0
+        small_[s] = '\0';
+        assert(category() == Category::isSmall && size() == s);
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    size_t basic_hstring_core<Alloc, RefPolicy, Traits>::size() const
+    {
+        size_t ret = ml_.size_;
+        ret = (category() == Category::isSmall) ? smallSize() : ret;
+        return ret;
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    size_t basic_hstring_core<Alloc, RefPolicy, Traits>::capacity() const
+    {
+        switch (category())
+        {
+        case Category::isSmall:
+            return maxSmallSize;
+        case Category::isLarge:
+            if (isSlice() || RefCounted::refs(ml_.data_) > 1)
+            {
+                return ml_.size_;
+            }
+            break;
+        case Category::isMedium:
+        default:
+            break;
+        }
+        return ml_.capacity();
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::unshare(size_t minCapacity)
+    {
+        assert(category() == Category::isLarge);
+        FOOL_HSTATS_COUNT(Unshare);
+        FOOL_HSTATS_ADD(UnshareBytesCopied, ml_.size_);
+        // 切片只需要自己那一段的空间
+        size_t effectiveCapacity = std::max(minCapacity, isSlice() ? ml_.size_ : ml_.capacity());
+        // 新建一个引用计数
+        auto const newRC = RefCounted::create(&effectiveCapacity);
+        assert(effectiveCapacity >= ml_.size_);
+        // 把数据复制过去，\0单独写
+        hstring_detail::podCopy(ml_.data_, ml_.data_ + ml_.size_, newRC->data_);
+        newRC->data_[ml_.size_] = '\0';
+        // 原来的引用计数减一
+        RefCounted::decrementRefs(sharedData());
+        // 把现在对象的data指向分配的空间
+        ml_.data_ = newRC->data_;
+        // 设置容量，size没有改变，不需要重新设置
+        ml_.setCapacity(effectiveCapacity, Category::isLarge);
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    char *basic_hstring_core<Alloc, RefPolicy, Traits>::mutableDataLarge()
+    {
+        assert(category() == Category::isLarge);
+        if (isSlice() || RefCounted::refs(ml_.data_) > 1)
+        {
+            unshare();
+        }
+        else
+        {
+            dropCachedHash();
+        }
+        return ml_.data_;
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    char *basic_hstring_core<Alloc, RefPolicy, Traits>::sharedData() const
+    {
+        assert(category() == Category::isLarge);
+        return (ml_.capacity_ & kSliceFlag) != 0 ? ml_.data_ - ml_.capacity() : ml_.data_;
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    size_t basic_hstring_core<Alloc, RefPolicy, Traits>::hash() const
+    {
+        if (category() != Category::isLarge || isSlice())
+        {
+            // 小字符串直接在对象里的small_上算
+            return std::hash<std::string_view>()(std::string_view(data(), size()));
+        }
+        auto &cached = RefCounted::fromData(ml_.data_)->hash_;
+        auto h = cached.load(std::memory_order_relaxed);
+        if (h == 0)
+        {
+            h = std::hash<std::string_view>()(std::string_view(ml_.data_, ml_.size_));
+            cached.store(h, std::memory_order_relaxed);
+        }
+        return h;
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::shrinkToFit()
+    {
+        // 现在占着的空间（字符数），切片算整块内存
+        size_t held;
+        bool shared = false;
+        switch (category())
+        {
+        case Category::isSmall:
+            return;
+        case Category::isMedium:
+            held = ml_.capacity();
+            break;
+        case Category::isLarge:
+        {
+            auto const base = sharedData();
+            shared = RefCounted::refs(base) > 1;
+            held = RefCounted::fromData(base)->capacity_ & ~RefCounted::kMappedFlag;
+            break;
+        }
+        default:
+            __builtin_unreachable();
+        }
+        auto const sz = ml_.size_;
+        if (sz > maxSmallSize)
+        {
+            if (shared)
+            {
+                return;
+            }
+            // 重新分配得到的容量，和init()的选择一致；不会更小就不动（比如覆盖整个映射文件的切片）
+            constexpr size_t offset = RefCounted::getDataOffset();
+            auto const fit = sz <= maxMediumSize ? Alloc::goodSize((sz + 1) * sizeof(char)) / sizeof(char) - 1
+                                                 : (Alloc::goodSize(offset + (sz + 1) * sizeof(char)) - offset) / sizeof(char) - 1;
+            if (fit >= held)
+            {
+                return;
+            }
+        }
+        // 缓存的哈希值跟着内容走
+        size_t h = 0;
+        if (category() == Category::isLarge && !isSlice())
+        {
+            h = RefCounted::fromData(ml_.data_)->hash_.load(std::memory_order_relaxed);
+        }
+        FOOL_HSTATS_COUNT(ShrinkToFit);
+        basic_hstring_core(ml_.data_, sz).swap(*this);
+        if (h != 0 && category() == Category::isLarge)
+        {
+            RefCounted::fromData(ml_.data_)->hash_.store(h, std::memory_order_relaxed);
+        }
+        assert(size() == sz);
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::maybeCompact()
+    {
+        if constexpr (Traits::kCompactDivisor != 0)
+        {
+            if (category() == Category::isSmall)
+            {
+                return;
+            }
+            auto const held = isSlice() ? RefCounted::fromData(sharedData())->capacity_ & ~RefCounted::kMappedFlag : ml_.capacity();
+            if (ml_.size_ * Traits::kCompactDivisor <= held)
+            {
+                shrinkToFit();
+            }
+        }
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::shrinkSmall(const size_t delta)
+    {
+        assert(delta <= smallSize());
+        setSmallSize(smallSize() - delta);
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::shrinkMedium(const size_t delta)
+    {
+        assert(ml_.size_ >= delta);
+        ml_.size_ -= delta;
+        ml_.data_[ml_.size_] = '\0';
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::shrinkLarge(const size_t delta)
+    {
+        assert(ml_.size_ >= delta);
+        // 共享的大字符串和切片：新的结尾后面已经是\0，或者只有自己持有整块内存时，变成同一块内存上的切片，否则复制
+        if (delta)
+        {
+            // 这个临时对象会在函数结束后析构
+            // 会自动把原来共享对象的计数减一
+            basic_hstring_core(std::move(*this), 0, ml_.size_ - delta).swap(*this);
+        }
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::reserveSmall(size_t minCapacity)
+    {
+        assert(category() == Category::isSmall);
+        //如果就是小字符串，不需要操作
+        if (minCapacity <= maxSmallSize)
+        {
+        }
+        // 要把实现方式改成中字符串
+        else if (minCapacity <= maxMediumSize)
+        {
+            auto const allocSizeBytes = Alloc::goodSize((1 + minCapacity) * sizeof(char));
+            auto const pData = static_cast<char *>(Alloc::allocate(allocSizeBytes));
+            FOOL_HSTATS_COUNT(Allocate);
+            FOOL_HSTATS_COUNT(SmallToMedium);
+            auto const size = smallSize();
+            hstring_detail::podCopy(small_, small_ + size + 1, pData);
+            ml_.data_ = pData;
+            ml_.size_ = size;
+            ml_.setCapacity(allocSizeBytes / sizeof(char) - 1, Category::isMedium);
+        }
+        // 要把实现方式改成大字符串
+        else
+        {
+            auto const newRC = RefCounted::create(&minCapacity);
+            FOOL_HSTATS_COUNT(SmallToLarge);
+            auto const size = smallSize();
+            hstring_detail::podCopy(small_, small_ + size + 1, newRC->data_);
+            ml_.data_ = newRC->data_;
+            ml_.size_ = size;
+            ml_.setCapacity(minCapacity, Category::isLarge);
+            assert(capacity() >= minCapacity);
+        }
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::reserveMedium(const size_t minCapacity)
+    {
+        assert(category() == Category::isMedium);
+        // String is not shared
+        // 如果参数值小于当前容量，则什么都不做
+        if (minCapacity <= ml_.capacity())
+        {
+            return;
+        }
+        // 还是中字符串模式
+        if (minCapacity <= maxMediumSize)
+        {
+            size_t capacityBytes = Alloc::goodSize((1 + minCapacity) * sizeof(char));
+            FOOL_HSTATS_COUNT(Reallocate);
+            ml_.data_ = static_cast<char *>(Alloc::reallocate(
+                ml_.data_,
+                (ml_.size_ + 1) * sizeof(char),
+                (ml_.capacity() + 1) * sizeof(char),
+                capacityBytes));
+            ml_.setCapacity(capacityBytes / sizeof(char) - 1, Category::isMedium);
+        }
+        else
+        {
+            // 否则需要把底层实现转化成大字符串
+            FOOL_HSTATS_COUNT(MediumToLarge);
+            size_t effectiveCapacity = minCapacity;
+            auto const newRC = RefCounted::create(&effectiveCapacity);
+            hstring_detail::podCopy(ml_.data_, ml_.data_ + ml_.size_ + 1, newRC->data_);
+            FOOL_HSTATS_COUNT(Free);
+            Alloc::deallocate(ml_.data_, (ml_.capacity() + 1) * sizeof(char));
+            ml_.data_ = newRC->data_;
+            ml_.setCapacity(effectiveCapacity, Category::isLarge);
+            assert(capacity() >= minCapacity);
+        }
+    }
+
+    template <class Alloc, class RefPolicy, class Traits>
+    void basic_hstring_core<Alloc, RefPolicy, Traits>::reserveLarge(size_t minCapacity)
+    {
+        assert(category() == Category::isLarge);
+        if (isSlice())
+        {
+            // 切片的容量就是长度，要求的不超过长度就继续共享
+            if (minCapacity > ml_.size_)
+            {
+                unshare(minCapacity);
+            }
+        }
+        else if (RefCounted::refs(ml_.data_) > 1)
+        {
+            unshare(minCapacity);
+        }
+        else
+        {
+            if (minCapacity > ml_.capacity())
+            {
+                auto const newRC = RefCounted::reallocate(ml_.data_, ml_.size_, ml_.capacity(), &minCapacity);
+                ml_.data_ = newRC->data_;
+                ml_.setCapacity(minCapacity, Category::isLarge);
+            }
+            assert(capacity() >= minCapacity);
+        }
+    }
+
+    extern template class basic_hstring_core<slab_allocator, atomic_refcount>;
+    extern template class basic_hstring_core<slab_allocator, plain_refcount>;
+    extern template class basic_hstring_core<slab_allocator, deferred_refcount>;
+
+    // 提供给用户的字符串接口，存储全部交给Storage（默认是hstring_core）
+    // 所有的修改操作都通过expandNoinit/mutableData完成，能复用已有的容量，共享的大字符串最多只脱离一次共享
+    template <class Char, class Storage = hstring_core>
+    class basic_hstring
+    {
+        static_assert(std::is_same<Char, typename Storage::value_type>::value, "basic_hstring: Char must match Storage::value_type");
+        static_assert(sizeof(Char) == 1, "basic_hstring: hsearch kernels work on bytes");
+
+    public:
+        typedef std::char_traits<Char> traits_type;
+        typedef Char value_type;
+        typedef size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef Char &reference;
+        typedef const Char &const_reference;
+        typedef Char *pointer;
+        typedef const Char *const_pointer;
+        typedef Char *iterator;
+        typedef const Char *const_iterator;
+        typedef std::reverse_iterator<iterator> reverse_iterator;
+        typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+        typedef std::basic_string_view<Char> view_type;
+
+        static constexpr size_type npos = size_type(-1);
+        // 不超过这个长度的字符串放在对象里，拷贝时不分配也不碰引用计数
+        static constexpr size_type inline_capacity = Storage::inlineCapacity();
+
+        // 构造函数
+        basic_hstring() noexcept {}
+        basic_hstring(const basic_hstring &str) : store_(str.store_) {}
+        basic_hstring(basic_hstring &&goner) noexcept : store_(std::move(goner.store_)) {}
+        basic_hstring(const basic_hstring &str, size_type pos, size_type n = npos);
+        basic_hstring(basic_hstring &&str, size_type pos, size_type n = npos);
+        basic_hstring(const Char *s) : store_(s, traits_type::length(s)) {}
+        basic_hstring(const Char *s, size_type n) : store_(s, n) {}
+        basic_hstring(const Char *s, size_type n, RefCountedStorage tag) : store_(s, n, tag) {}
+        basic_hstring(size_type n, Char c);
+        template <class InIt, class = typename std::iterator_traits<InIt>::iterator_category>
+        basic_hstring(InIt first, InIt last) { append(first, last); }
+        basic_hstring(std::initializer_list<Char> il) : store_(il.begin(), il.size()) {}
+        explicit basic_hstring(view_type sv) : store_(sv.data(), sv.size()) {}
+        // 和string_view一样是explicit的，否则传入std::string时，basic_hstring和view_type两种重载会有二义性
+        explicit basic_hstring(const std::basic_string<Char> &str) : store_(str.data(), str.size()) {}
+        // 文件内容，大文件是只读映射，不拷贝（见basic_hstring_core）
+        basic_hstring(const Char *path, MapReadOnlyFile tag) : store_(path, tag) {}
+        static basic_hstring mapFile(const Char *path) { return basic_hstring(path, MapReadOnlyFile()); }
+        ~basic_hstring() noexcept {}
+
+        // 赋值
+        basic_hstring &operator=(const basic_hstring &lhs);
+        basic_hstring &operator=(basic_hstring &&goner) noexcept;
+        basic_hstring &operator=(const Char *s) { return assign(s); }
+        basic_hstring &operator=(Char c) { return assign(&c, 1); }
+        basic_hstring &operator=(std::initializer_list<Char> il) { return assign(il.begin(), il.size()); }
+        basic_hstring &operator=(view_type sv) { return assign(sv.data(), sv.size()); }
+        basic_hstring &operator=(const std::basic_string<Char> &str) { return assign(str.data(), str.size()); }
+
+        operator view_type() const noexcept { return view_type(data(), size()); }
+        std::basic_string<Char> toStdString() const { return std::basic_string<Char>(data(), size()); }
+
+        // 迭代器，非const版本会让共享的大字符串脱离共享
+        iterator begin() { return store_.mutableData(); }
+        const_iterator begin() const { return store_.data(); }
+        const_iterator cbegin() const { return begin(); }
+        iterator end() { return store_.mutableData() + store_.size(); }
+        const_iterator end() const { return store_.data() + store_.size(); }
+        const_iterator cend() const { return end(); }
+        reverse_iterator rbegin() { return reverse_iterator(end()); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        const_reverse_iterator crbegin() const { return rbegin(); }
+        reverse_iterator rend() { return reverse_iterator(begin()); }
+        const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+        const_reverse_iterator crend() const { return rend(); }
+
+        // 访问元素
+        const_reference operator[](size_type pos) const { return *(begin() + pos); }
+        reference operator[](size_type pos) { return *(begin() + pos); }
+        const_reference at(size_type n) const;
+        reference at(size_type n);
+        const_reference front() const { return *begin(); }
+        const_reference back() const { return *(end() - 1); }
+        reference front() { return *begin(); }
+        reference back() { return *(end() - 1); }
+        const Char *c_str() const { return store_.c_str(); }
+        // 和std::string一样，data()后面总有\0（切片在创建时就保证了）
+        const Char *data() const { return store_.data(); }
+        Char *data() { return store_.mutableData(); }
+
+        // 大小和容量
+        size_type size() const { return store_.size(); }
+        size_type length() const { return size(); }
+        // capacity_的最高字节要保存类型信息
+        size_type max_size() const { return size_type(-1) >> 4; }
+        size_type capacity() const { return store_.capacity(); }
+        // 是否和别的字符串共享内存，共享时任何修改都要先拷贝
+        bool isShared() const { return store_.isShared(); }
+        // 和std::hash<view_type>的结果相同，大字符串的哈希值缓存在共享的内存里
+        size_t hash() const { return store_.hash(); }
+        // 是否是和别的大字符串共享内存的切片（substr/缩短共享的大字符串得到）
+        bool isSlice() const { return store_.isSlice(); }
+        bool empty() const { return size() == 0; }
+        void reserve(size_type minCapacity = 0) { store_.reserve(minCapacity); }
+        // 和std::string不同，这里一定会收缩（共享的大字符串除外），见basic_hstring_core::shrinkToFit
+        void shrink_to_fit() { store_.shrinkToFit(); }
+        void resize(size_type n, Char c = Char());
+        void clear() { resize(0); }
+
+        // 追加
+        basic_hstring &operator+=(const basic_hstring &str) { return append(str); }
+        basic_hstring &operator+=(const Char *s) { return append(s); }
+        basic_hstring &operator+=(Char c)
+        {
+            push_back(c);
+            return *this;
+        }
+        basic_hstring &operator+=(std::initializer_list<Char> il) { return append(il); }
+        basic_hstring &operator+=(view_type sv) { return append(sv); }
+
+        basic_hstring &append(const basic_hstring &str) { return append(str.data(), str.size()); }
+        basic_hstring &append(const basic_hstring &str, size_type pos, size_type n = npos);
+        basic_hstring &append(const Char *s, size_type n);
+        basic_hstring &append(const Char *s) { return append(s, traits_type::length(s)); }
+        basic_hstring &append(size_type n, Char c);
+        // 在末尾加上n个没有初始化的字符，返回它们的首地址，由调用者填写
+        // exact为true时只申请正好够用的空间，事先知道最终长度的拼接用它选定一次存储方式
+        Char *appendNoinit(size_type n, bool exact = false) { return store_.expandNoinit(n, !exact); }
+        template <class InIt, class = typename std::iterator_traits<InIt>::iterator_category>
+        basic_hstring &append(InIt first, InIt last);
+        basic_hstring &append(std::initializer_list<Char> il) { return append(il.begin(), il.size()); }
+        basic_hstring &append(view_type sv) { return append(sv.data(), sv.size()); }
+        void push_back(Char c) { store_.push_back(c); }
+        void pop_back()
+        {
+            assert(!empty());
+            store_.shrink(1);
+        }
+
+        // 赋值
+        basic_hstring &assign(const basic_hstring &str) { return *this = str; }
+        basic_hstring &assign(basic_hstring &&str) { return *this = std::move(str); }
+        basic_hstring &assign(const basic_hstring &str, size_type pos, size_type n = npos);
+        basic_hstring &assign(const Char *s, size_type n);
+        basic_hstring &assign(const Char *s) { return assign(s, traits_type::length(s)); }
+        basic_hstring &assign(size_type n, Char c);
+        template <class InIt, class = typename std::iterator_traits<InIt>::iterator_category>
+        basic_hstring &assign(InIt first, InIt last);
+        basic_hstring &assign(std::initializer_list<Char> il) { return assign(il.begin(), il.size()); }
+        basic_hstring &assign(view_type sv) { return assign(sv.data(), sv.size()); }
+
+        // 插入
+        basic_hstring &insert(size_type pos, const basic_hstring &str) { return insert(pos, str.data(), str.size()); }
+        basic_hstring &insert(size_type pos1, const basic_hstring &str, size_type pos2, size_type n = npos);
+        basic_hstring &insert(size_type pos, const Char *s, size_type n);
+        basic_hstring &insert(size_type pos, const Char *s) { return insert(pos, s, traits_type::length(s)); }
+        basic_hstring &insert(size_type pos, size_type n, Char c);
+        basic_hstring &insert(size_type pos, view_type sv) { return insert(pos, sv.data(), sv.size()); }
+        iterator insert(const_iterator p, Char c) { return insert(p, 1, c); }
+        iterator insert(const_iterator p, size_type n, Char c);
+        template <class InIt, class = typename std::iterator_traits<InIt>::iterator_category>
+        iterator insert(const_iterator p, InIt first, InIt last);
+        iterator insert(const_iterator p, std::initializer_list<Char> il) { return insert(p, il.begin(), il.end()); }
+
+        // 删除
+        basic_hstring &erase(size_type pos = 0, size_type n = npos);
+        iterator erase(const_iterator position);
+        iterator erase(const_iterator first, const_iterator last);
+
+        // 替换
+        basic_hstring &replace(size_type pos, size_type n1, const basic_hstring &str) { return replace(pos, n1, str.data(), str.size()); }
+        basic_hstring &replace(size_type pos1, size_type n1, const basic_hstring &str, size_type pos2, size_type n2 = npos);
+        basic_hstring &replace(size_type pos, size_type n1, const Char *s, size_type n2);
+        basic_hstring &replace(size_type pos, size_type n1, const Char *s) { return replace(pos, n1, s, traits_type::length(s)); }
+        basic_hstring &replace(size_type pos, size_type n1, size_type n2, Char c);
+        basic_hstring &replace(size_type pos, size_type n1, view_type sv) { return replace(pos, n1, sv.data(), sv.size()); }
+        basic_hstring &replace(const_iterator i1, const_iterator i2, const basic_hstring &str) { return replace(i1, i2, str.data(), str.size()); }
+        basic_hstring &replace(const_iterator i1, const_iterator i2, const Char *s, size_type n) { return replace(size_type(i1 - cbegin()), size_type(i2 - i1), s, n); }
+        basic_hstring &replace(const_iterator i1, const_iterator i2, const Char *s) { return replace(i1, i2, s, traits_type::length(s)); }
+        basic_hstring &replace(const_iterator i1, const_iterator i2, size_type n, Char c) { return replace(size_type(i1 - cbegin()), size_type(i2 - i1), n, c); }
+        basic_hstring &replace(const_iterator i1, const_iterator i2, view_type sv) { return replace(i1, i2, sv.data(), sv.size()); }
+
+        size_type copy(Char *s, size_type n, size_type pos = 0) const;
+        void swap(basic_hstring &rhs) { store_.swap(rhs.store_); }
+
+        basic_hstring substr(size_type pos = 0, size_type n = npos) const &;
+        basic_hstring substr(size_type pos = 0, size_type n = npos) &&;
+
+        // 查找，底层是hsearch里按CPU分发的SIMD实现
+        size_type find(const basic_hstring &str, size_type pos = 0) const { return find(str.data(), pos, str.size()); }
+        size_type find(const Char *s, size_type pos, size_type n) const { return hsearch::find(data(), size(), s, n, pos); }
+        size_type find(const Char *s, size_type pos = 0) const { return find(s, pos, traits_type::length(s)); }
+        size_type find(Char c, size_type pos = 0) const { return find(&c, pos, 1); }
+        size_type find(view_type sv, size_type pos = 0) const { return find(sv.data(), pos, sv.size()); }
+
+        size_type rfind(const basic_hstring &str, size_type pos = npos) const { return rfind(str.data(), pos, str.size()); }
+        size_type rfind(const Char *s, size_type pos, size_type n) const { return hsearch::rfind(data(), size(), s, n, pos); }
+        size_type rfind(const Char *s, size_type pos = npos) const { return rfind(s, pos, traits_type::length(s)); }
+        size_type rfind(Char c, size_type pos = npos) const { return rfind(&c, pos, 1); }
+        size_type rfind(view_type sv, size_type pos = npos) const { return rfind(sv.data(), pos, sv.size()); }
+
+        size_type find_first_of(const basic_hstring &str, size_type pos = 0) const { return find_first_of(str.data(), pos, str.size()); }
+        size_type find_first_of(const Char *s, size_type pos, size_type n) const { return hsearch::find_first_of(data(), size(), s, n, pos); }
+        size_type find_first_of(const Char *s, size_type pos = 0) const { return find_first_of(s, pos, traits_type::length(s)); }
+        size_type find_first_of(Char c, size_type pos = 0) const { return find(c, pos); }
+        size_type find_first_of(view_type sv, size_type pos = 0) const { return find_first_of(sv.data(), pos, sv.size()); }
+
+        size_type find_first_not_of(const basic_hstring &str, size_type pos = 0) const { return find_first_not_of(str.data(), pos, str.size()); }
+        size_type find_first_not_of(const Char *s, size_type pos, size_type n) const { return hsearch::find_first_not_of(data(), size(), s, n, pos); }
+        size_type find_first_not_of(const Char *s, size_type pos = 0) const { return find_first_not_of(s, pos, traits_type::length(s)); }
+        size_type find_first_not_of(Char c, size_type pos = 0) const { return find_first_not_of(&c, pos, 1); }
+        size_type find_first_not_of(view_type sv, size_type pos = 0) const { return find_first_not_of(sv.data(), pos, sv.size()); }
+
+        bool contains(view_type sv) const { return find(sv) != npos; }
+        bool contains(const Char *s) const { return find(s) != npos; }
+        bool contains(Char c) const { return find(c) != npos; }
+
+        // 比较
+        int compare(const basic_hstring &str) const { return compare(0, size(), str.data(), str.size()); }
+        int compare(size_type pos1, size_type n1, const basic_hstring &str) const { return compare(pos1, n1, str.data(), str.size()); }
+        int compare(size_type pos1, size_type n1, const basic_hstring &str, size_type pos2, size_type n2 = npos) const;
+        int compare(const Char *s) const { return compare(0, size(), s, traits_type::length(s)); }
+        int compare(size_type pos1, size_type n1, const Char *s) const { return compare(pos1, n1, s, traits_type::length(s)); }
+        int compare(size_type pos1, size_type n1, const Char *s, size_type n2) const;
+        int compare(view_type sv) const { return compare(0, size(), sv.data(), sv.size()); }
+
+    private:
+        // pos超过size时抛出out_of_range
+        void enforcePos(size_type pos, const char *what) const
+        {
+            if (FOOL_UNLIKELY(pos > size()))
+            {
+                throw_exception<std::out_of_range>(what);
+            }
+        }
+        // s是否指向自己的数据，修改自己之前必须先判断，否则扩容后s会失效
+        bool isAliased(const Char *s) const
+        {
+            std::less<const Char *> lt;
+            auto const b = data();
+            return !lt(s, b) && lt(s, b + size());
+        }
+
+        Storage store_;
+    };
+
+    typedef basic_hstring<char> hstring;
+    typedef basic_hstring<char, local_hstring_core> local_hstring;
+    typedef basic_hstring<char, deferred_hstring_core> deferred_hstring;
+    typedef basic_hstring<char, mmap_hstring_core> mmap_hstring;
+
+/*------------------------------------------------basic_hstring构造和赋值------------------------------------------------------------------------*/
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage>::basic_hstring(const basic_hstring &str, size_type pos, size_type n)
+    {
+        str.enforcePos(pos, "basic_hstring::basic_hstring");
+        // 大字符串的子串后面是\0时是切片，和str共享内存
+        Storage(str.store_, pos, std::min(n, str.size() - pos)).swap(store_);
+    }
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage>::basic_hstring(basic_hstring &&str, size_type pos, size_type n)
+    {
+        str.enforcePos(pos, "basic_hstring::basic_hstring");
+        // 只有str持有整块内存时，切片不用复制就能以\0结尾
+        Storage(std::move(str.store_), pos, std::min(n, str.size() - pos)).swap(store_);
+    }
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage>::basic_hstring(size_type n, Char c)
+    {
+        auto const pData = store_.expandNoinit(n);
+        hstring_detail::podFill(pData, pData + n, c);
+    }
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage> &basic_hstring<Char, Storage>::operator=(const basic_hstring &lhs)
+    {
+        if (FOOL_UNLIKELY(&lhs == this))
+        {
+            return *this;
+        }
+        // 存储自己决定复用空间还是共享
+        store_ = lhs.store_;
+        return *this;
+    }
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage> &basic_hstring<Char, Storage>::operator=(basic_hstring &&goner) noexcept
+    {
+        store_ = std::move(goner.store_);
+        return *this;
+    }
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage> &basic_hstring<Char, Storage>::assign(const basic_hstring &str, size_type pos, size_type n)
+    {
+        auto const sz = str.size();
+        str.enforcePos(pos, "basic_hstring::assign");
+        return assign(str.data() + pos, std::min(n, sz - pos));
+    }
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage> &basic_hstring<Char, Storage>::assign(const Char *s, size_type n)
+    {
+        store_.assign(s, n);
+        assert(size() == n);
+        return *this;
+    }
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage> &basic_hstring<Char, Storage>::assign(size_type n, Char c)
+    {
+        clear();
+        return append(n, c);
+    }
+
+    template <class Char, class Storage>
+    template <class InIt, class>
+    basic_hstring<Char, Storage> &basic_hstring<Char, Storage>::assign(InIt first, InIt last)
+    {
+        if constexpr (std::is_convertible<InIt, const Char *>::value)
+        {
+            return assign(static_cast<const Char *>(first), size_type(last - first));
+        }
+        else
+        {
+            clear();
+            return append(first, last);
+        }
+    }
+
+/*------------------------------------------------basic_hstring访问和大小------------------------------------------------------------------------*/
+
+    template <class Char, class Storage>
+    typename basic_hstring<Char, Storage>::const_reference basic_hstring<Char, Storage>::at(size_type n) const
+    {
+        if (FOOL_UNLIKELY(n >= size()))
+        {
+            throw_exception<std::out_of_range>("basic_hstring::at");
+        }
+        return (*this)[n];
+    }
+
+    template <class Char, class Storage>
+    typename basic_hstring<Char, Storage>::reference basic_hstring<Char, Storage>::at(size_type n)
+    {
+        if (FOOL_UNLIKELY(n >= size()))
+        {
+            throw_exception<std::out_of_range>("basic_hstring::at");
+        }
+        return (*this)[n];
+    }
+
+    template <class Char, class Storage>
+    void basic_hstring<Char, Storage>::resize(size_type n, Char c)
+    {
+        auto const sz = size();
+        if (n <= sz)
+        {
+            store_.shrink(sz - n);
+        }
+        else
+        {
+            // resize是精确的大小，不需要额外的增长空间
+            auto const delta = n - sz;
+            auto const pData = store_.expandNoinit(delta);
+            hstring_detail::podFill(pData, pData + delta, c);
+        }
+        assert(size() == n);
+    }
+
+/*------------------------------------------------basic_hstring追加和插入------------------------------------------------------------------------*/
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage> &basic_hstring<Char, Storage>::append(const basic_hstring &str, size_type pos, size_type n)
+    {
+        auto const sz = str.size();
+        str.enforcePos(pos, "basic_hstring::append");
+        return append(str.data() + pos, std::min(n, sz - pos));
+    }
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage> &basic_hstring<Char, Storage>::append(const Char *s, size_type n)
+    {
+        if (FOOL_UNLIKELY(n == 0))
+        {
+            return *this;
+        }
+        auto const oldSize = size();
+        // 只读地取地址，共享的大字符串留给expandNoinit一次性脱离共享并扩容
+        auto const oldData = std::as_const(*this).data();
+        auto const pData = store_.expandNoinit(n, true);
+        // s指向自己的数据时，扩容可能让原来的地址失效，要按偏移量重新定位
+        std::less_equal<const Char *> le;
+        if (FOOL_UNLIKELY(le(oldData, s) && !le(oldData + oldSize, s)))
+        {
+            assert(le(s + n, oldData + oldSize));
+            s = data() + (s - oldData);
+            hstring_detail::podMove(s, s + n, pData);
+        }
+        else
+        {
+            hstring_detail::podCopy(s, s + n, pData);
+        }
+        assert(size() == oldSize + n);
+        return *this;
+    }
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage> &basic_hstring<Char, Storage>::append(size_type n, Char c)
+    {
+        auto const pData = store_.expandNoinit(n, true);
+        hstring_detail::podFill(pData, pData + n, c);
+        return *this;
+    }
+
+    template <class Char, class Storage>
+    template <class InIt, class>
+    basic_hstring<Char, Storage> &basic_hstring<Char, Storage>::append(InIt first, InIt last)
+    {
+        typedef typename std::iterator_traits<InIt>::iterator_category category;
+        if constexpr (std::is_convertible<InIt, const Char *>::value)
+        {
+            return append(static_cast<const Char *>(first), size_type(last - first));
+        }
+        else if constexpr (std::is_base_of<std::forward_iterator_tag, category>::value)
+        {
+            // 前向迭代器可以先算出长度，一次扩容
+            auto const n = size_type(std::distance(first, last));
+            hstring_detail::copy_n(first, n, store_.expandNoinit(n, true));
+        }
+        else
+        {
+            for (; first != last; ++first)
+            {
+                push_back(*first);
+            }
+        }
+        return *this;
+    }
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage> &basic_hstring<Char, Storage>::insert(size_type pos1, const basic_hstring &str, size_type pos2, size_type n)
+    {
+        auto const sz = str.size();
+        str.enforcePos(pos2, "basic_hstring::insert");
+        return insert(pos1, str.data() + pos2, std::min(n, sz - pos2));
+    }
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage> &basic_hstring<Char, Storage>::insert(size_type pos, const Char *s, size_type n)
+    {
+        enforcePos(pos, "basic_hstring::insert");
+        if (FOOL_UNLIKELY(n == 0))
+        {
+            return *this;
+        }
+        if (FOOL_UNLIKELY(isAliased(s)))
+        {
+            // 要插入的是自己的一部分，先拷贝出来
+            const basic_hstring tmp(s, n);
+            return insert(pos, tmp.data(), n);
+        }
+        auto const oldSize = size();
+        // expandNoinit之后数据一定是独占的，直接在原地移动
+        auto const pData = store_.expandNoinit(n, true) - oldSize;
+        hstring_detail::podMove(pData + pos, pData + oldSize, pData + pos + n);
+        hstring_detail::podCopy(s, s + n, pData + pos);
+        return *this;
+    }
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage> &basic_hstring<Char, Storage>::insert(size_type pos, size_type n, Char c)
+    {
+        enforcePos(pos, "basic_hstring::insert");
+        if (FOOL_UNLIKELY(n == 0))
+        {
+            return *this;
+        }
+        auto const oldSize = size();
+        auto const pData = store_.expandNoinit(n, true) - oldSize;
+        hstring_detail::podMove(pData + pos, pData + oldSize, pData + pos + n);
+        hstring_detail::podFill(pData + pos, pData + pos + n, c);
+        return *this;
+    }
+
+    template <class Char, class Storage>
+    typename basic_hstring<Char, Storage>::iterator basic_hstring<Char, Storage>::insert(const_iterator p, size_type n, Char c)
+    {
+        auto const pos = size_type(p - cbegin());
+        insert(pos, n, c);
+        return begin() + pos;
+    }
+
+    template <class Char, class Storage>
+    template <class InIt, class>
+    typename basic_hstring<Char, Storage>::iterator basic_hstring<Char, Storage>::insert(const_iterator p, InIt first, InIt last)
+    {
+        auto const pos = size_type(p - cbegin());
+        if constexpr (std::is_convertible<InIt, const Char *>::value)
+        {
+            insert(pos, static_cast<const Char *>(first), size_type(last - first));
+        }
+        else
+        {
+            const basic_hstring tmp(first, last);
+            insert(pos, tmp.data(), tmp.size());
+        }
+        return begin() + pos;
+    }
+
+/*------------------------------------------------basic_hstring删除和替换------------------------------------------------------------------------*/
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage> &basic_hstring<Char, Storage>::erase(size_type pos, size_type n)
+    {
+        enforcePos(pos, "basic_hstring::erase");
+        auto const sz = size();
+        n = std::min(n, sz - pos);
+        if (FOOL_UNLIKELY(n == 0))
+        {
+            return *this;
+        }
+        // 只删除尾部时不需要移动数据
+        if (pos + n != sz)
+        {
+            auto const pData = store_.mutableData();
+            hstring_detail::podMove(pData + pos + n, pData + sz, pData + pos);
+        }
+        store_.shrink(n);
+        return *this;
+    }
+
+    template <class Char, class Storage>
+    typename basic_hstring<Char, Storage>::iterator basic_hstring<Char, Storage>::erase(const_iterator position)
+    {
+        auto const pos = size_type(position - cbegin());
+        erase(pos, 1);
+        return begin() + pos;
+    }
+
+    template <class Char, class Storage>
+    typename basic_hstring<Char, Storage>::iterator basic_hstring<Char, Storage>::erase(const_iterator first, const_iterator last)
+    {
+        auto const pos = size_type(first - cbegin());
+        erase(pos, size_type(last - first));
+        return begin() + pos;
+    }
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage> &basic_hstring<Char, Storage>::replace(size_type pos1, size_type n1, const basic_hstring &str, size_type pos2, size_type n2)
+    {
+        auto const sz = str.size();
+        str.enforcePos(pos2, "basic_hstring::replace");
+        return replace(pos1, n1, str.data() + pos2, std::min(n2, sz - pos2));
+    }
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage> &basic_hstring<Char, Storage>::replace(size_type pos, size_type n1, const Char *s, size_type n2)
+    {
+        enforcePos(pos, "basic_hstring::replace");
+        auto const oldSize = size();
+        n1 = std::min(n1, oldSize - pos);
+        if (FOOL_UNLIKELY(n1 == 0 && n2 == 0))
+        {
+            return *this;
+        }
+        if (FOOL_UNLIKELY(isAliased(s)))
+        {
+            const basic_hstring tmp(s, n2);
+            return replace(pos, n1, tmp.data(), n2);
+        }
+        if (n2 > n1)
+        {
+            // 变长了，先扩容，再把后面的数据往后挪
+            auto const pData = store_.expandNoinit(n2 - n1, true) - oldSize;
+            hstring_detail::podMove(pData + pos + n1, pData + oldSize, pData + pos + n2);
+            hstring_detail::podCopy(s, s + n2, pData + pos);
+        }
+        else
+        {
+            // 变短或者不变，原地覆盖，再把后面的数据往前挪
+            auto const pData = store_.mutableData();
+            if (n2 > 0)
+            {
+                hstring_detail::podCopy(s, s + n2, pData + pos);
+            }
+            hstring_detail::podMove(pData + pos + n1, pData + oldSize, pData + pos + n2);
+            store_.shrink(n1 - n2);
+        }
+        assert(size() == oldSize - n1 + n2);
+        return *this;
+    }
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage> &basic_hstring<Char, Storage>::replace(size_type pos, size_type n1, size_type n2, Char c)
+    {
+        enforcePos(pos, "basic_hstring::replace");
+        auto const oldSize = size();
+        n1 = std::min(n1, oldSize - pos);
+        if (FOOL_UNLIKELY(n1 == 0 && n2 == 0))
+        {
+            return *this;
+        }
+        if (n2 > n1)
+        {
+            auto const pData = store_.expandNoinit(n2 - n1, true) - oldSize;
+            hstring_detail::podMove(pData + pos + n1, pData + oldSize, pData + pos + n2);
+            hstring_detail::podFill(pData + pos, pData + pos + n2, c);
+        }
+        else
+        {
+            auto const pData = store_.mutableData();
+            hstring_detail::podFill(pData + pos, pData + pos + n2, c);
+            hstring_detail::podMove(pData + pos + n1, pData + oldSize, pData + pos + n2);
+            store_.shrink(n1 - n2);
+        }
+        return *this;
+    }
+
+/*------------------------------------------------basic_hstring其他操作------------------------------------------------------------------------*/
+
+    template <class Char, class Storage>
+    typename basic_hstring<Char, Storage>::size_type basic_hstring<Char, Storage>::copy(Char *s, size_type n, size_type pos) const
+    {
+        enforcePos(pos, "basic_hstring::copy");
+        n = std::min(n, size() - pos);
+        if (n > 0)
+        {
+            hstring_detail::podCopy(data() + pos, data() + pos + n, s);
+        }
+        return n;
+    }
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage> basic_hstring<Char, Storage>::substr(size_type pos, size_type n) const &
+    {
+        return basic_hstring(*this, pos, n);
+    }
+
+    template <class Char, class Storage>
+    basic_hstring<Char, Storage> basic_hstring<Char, Storage>::substr(size_type pos, size_type n) &&
+    {
+        enforcePos(pos, "basic_hstring::substr");
+        if (store_.category() == Storage::Category::isLarge)
+        {
+            // 大字符串切片比搬动数据便宜
+            return basic_hstring(std::move(*this), pos, n);
+        }
+        // 右值直接在自己身上截取，省掉一次分配
+        erase(0, pos);
+        if (n < size())
+        {
+            resize(n);
+        }
+        return std::move(*this);
+    }
+
+    template <class Char, class Storage>
+    int basic_hstring<Char, Storage>::compare(size_type pos1, size_type n1, const basic_hstring &str, size_type pos2, size_type n2) const
+    {
+        str.enforcePos(pos2, "basic_hstring::compare");
+        return compare(pos1, n1, str.data() + pos2, std::min(n2, str.size() - pos2));
+    }
+
+    template <class Char, class Storage>
+    int basic_hstring<Char, Storage>::compare(size_type pos1, size_type n1, const Char *s, size_type n2) const
+    {
+        enforcePos(pos1, "basic_hstring::compare");
+        n1 = std::min(n1, size() - pos1);
+        auto const r = traits_type::compare(data() + pos1, s, std::min(n1, n2));
+        return r != 0 ? r : n1 > n2 ? 1 : (n1 < n2 ? -1 : 0);
+    }
+
+/*------------------------------------------------basic_hstring非成员函数------------------------------------------------------------------------*/
+
+    template <class Char, class Storage>
+    inline basic_hstring<Char, Storage> operator+(const basic_hstring<Char, Storage> &lhs, const basic_hstring<Char, Storage> &rhs)
+    {
+        // 先一次分配好空间，避免追加时再扩容
+        basic_hstring<Char, Storage> result;
+        result.reserve(lhs.size() + rhs.size());
+        result.append(lhs).append(rhs);
+        return result;
+    }
+
+    template <class Char, class Storage>
+    inline basic_hstring<Char, Storage> operator+(basic_hstring<Char, Storage> &&lhs, const basic_hstring<Char, Storage> &rhs)
+    {
+        return std::move(lhs.append(rhs));
+    }
+
+    template <class Char, class Storage>
+    inline basic_hstring<Char, Storage> operator+(const basic_hstring<Char, Storage> &lhs, const Char *rhs)
+    {
+        auto const n = std::char_traits<Char>::length(rhs);
+        basic_hstring<Char, Storage> result;
+        result.reserve(lhs.size() + n);
+        result.append(lhs).append(rhs, n);
+        return result;
+    }
+
+    template <class Char, class Storage>
+    inline basic_hstring<Char, Storage> operator+(basic_hstring<Char, Storage> &&lhs, const Char *rhs)
+    {
+        return std::move(lhs.append(rhs));
+    }
+
+    template <class Char, class Storage>
+    inline basic_hstring<Char, Storage> operator+(const Char *lhs, const basic_hstring<Char, Storage> &rhs)
+    {
+        auto const n = std::char_traits<Char>::length(lhs);
+        basic_hstring<Char, Storage> result;
+        result.reserve(n + rhs.size());
+        result.append(lhs, n).append(rhs);
+        return result;
+    }
+
+    template <class Char, class Storage>
+    inline basic_hstring<Char, Storage> operator+(const basic_hstring<Char, Storage> &lhs, Char rhs)
+    {
+        basic_hstring<Char, Storage> result;
+        result.reserve(lhs.size() + 1);
+        result.append(lhs).push_back(rhs);
+        return result;
+    }
+
+    template <class Char, class Storage>
+    inline basic_hstring<Char, Storage> operator+(basic_hstring<Char, Storage> &&lhs, Char rhs)
+    {
+        lhs.push_back(rhs);
+        return std::move(lhs);
+    }
+
+    template <class Char, class Storage>
+    inline basic_hstring<Char, Storage> operator+(Char lhs, const basic_hstring<Char, Storage> &rhs)
+    {
+        basic_hstring<Char, Storage> result;
+        result.reserve(1 + rhs.size());
+        result.push_back(lhs);
+        result.append(rhs);
+        return result;
+    }
+
+    template <class Char, class Storage>
+    inline bool operator==(const basic_hstring<Char, Storage> &lhs, const basic_hstring<Char, Storage> &rhs)
+    {
+        // 先比较长度，长度不同就不需要比较内容了
+        return lhs.size() == rhs.size() && lhs.compare(rhs) == 0;
+    }
+
+    template <class Char, class Storage>
+    inline bool operator==(const basic_hstring<Char, Storage> &lhs, const Char *rhs) { return lhs.compare(rhs) == 0; }
+
+    template <class Char, class Storage>
+    inline bool operator==(const Char *lhs, const basic_hstring<Char, Storage> &rhs) { return rhs == lhs; }
+
+    template <class Char, class Storage>
+    inline bool operator!=(const basic_hstring<Char, Storage> &lhs, const basic_hstring<Char, Storage> &rhs) { return !(lhs == rhs); }
+
+    template <class Char, class Storage>
+    inline bool operator!=(const basic_hstring<Char, Storage> &lhs, const Char *rhs) { return !(lhs == rhs); }
+
+    template <class Char, class Storage>
+    inline bool operator!=(const Char *lhs, const basic_hstring<Char, Storage> &rhs) { return !(lhs == rhs); }
+
+    template <class Char, class Storage>
+    inline bool operator<(const basic_hstring<Char, Storage> &lhs, const basic_hstring<Char, Storage> &rhs) { return lhs.compare(rhs) < 0; }
+
+    template <class Char, class Storage>
+    inline bool operator<(const basic_hstring<Char, Storage> &lhs, const Char *rhs) { return lhs.compare(rhs) < 0; }
+
+    template <class Char, class Storage>
+    inline bool operator<(const Char *lhs, const basic_hstring<Char, Storage> &rhs) { return rhs.compare(lhs) > 0; }
+
+    template <class Char, class Storage>
+    inline bool operator>(const basic_hstring<Char, Storage> &lhs, const basic_hstring<Char, Storage> &rhs) { return rhs < lhs; }
+
+    template <class Char, class Storage>
+    inline bool operator>(const basic_hstring<Char, Storage> &lhs, const Char *rhs) { return rhs < lhs; }
+
+    template <class Char, class Storage>
+    inline bool operator>(const Char *lhs, const basic_hstring<Char, Storage> &rhs) { return rhs < lhs; }
+
+    template <class Char, class Storage>
+    inline bool operator<=(const basic_hstring<Char, Storage> &lhs, const basic_hstring<Char, Storage> &rhs) { return !(rhs < lhs); }
+
+    template <class Char, class Storage>
+    inline bool operator<=(const basic_hstring<Char, Storage> &lhs, const Char *rhs) { return !(rhs < lhs); }
+
+    template <class Char, class Storage>
+    inline bool operator<=(const Char *lhs, const basic_hstring<Char, Storage> &rhs) { return !(rhs < lhs); }
+
+    template <class Char, class Storage>
+    inline bool operator>=(const basic_hstring<Char, Storage> &lhs, const basic_hstring<Char, Storage> &rhs) { return !(lhs < rhs); }
+
+    template <class Char, class Storage>
+    inline bool operator>=(const basic_hstring<Char, Storage> &lhs, const Char *rhs) { return !(lhs < rhs); }
+
+    template <class Char, class Storage>
+    inline bool operator>=(const Char *lhs, const basic_hstring<Char, Storage> &rhs) { return !(lhs < rhs); }
+
+    template <class Char, class Storage>
+    inline void swap(basic_hstring<Char, Storage> &lhs, basic_hstring<Char, Storage> &rhs) { lhs.swap(rhs); }
+
+    // 对[first, last)里的每个字符串shrink_to_fit，长期保存的缓存经历过一阵大的值之后用它把内存还回去
+    // 返回换了存储位置（重新分配或者搬进对象本身）的字符串个数
+    template <class It>
+    size_t compact(It first, It last)
+    {
+        size_t moved = 0;
+        for (; first != last; ++first)
+        {
+            auto &s = *first;
+            auto const before = std::as_const(s).data();
+            s.shrink_to_fit();
+            moved += std::as_const(s).data() != before;
+        }
+        return moved;
+    }
+
+    template <class Container>
+    size_t compact(Container &c)
+    {
+        return compact(std::begin(c), std::end(c));
+    }
+
+    template <class Char, class Storage>
+    inline std::basic_ostream<Char> &operator<<(std::basic_ostream<Char> &os, const basic_hstring<Char, Storage> &str)
+    {
+        return os << typename basic_hstring<Char, Storage>::view_type(str);
+    }
+}
+
+namespace std
+{
+    template <class Char, class Storage>
+    struct hash<fool::basic_hstring<Char, Storage>>
+    {
+        size_t operator()(const fool::basic_hstring<Char, Storage> &str) const noexcept
+        {
+            return str.hash();
+        }
     };
 }
 #endif
@@ -0,0 +1,48 @@
+#ifndef HXMMXH_TRAITS_H
+#define HXMMXH_TRAITS_H
+
+#include <cstddef>
+
+// hstring_core的长度分界和扩容方式
+// 也是一个只有静态常量的类，basic_hstring_core里用static_assert检查：
+//   static constexpr size_t kMaxMediumSize;      不超过这个长度的用中字符串（独占内存，拷贝时深拷贝），再长就是引用计数的大字符串
+//   static constexpr size_t kFirstGrowth;        小字符串按指数增长扩容时第一次申请的容量，必须大于小字符串的最大长度
+//   static constexpr size_t kGrowthNumerator;    之后每次扩容到原来的 kGrowthNumerator / kGrowthDenominator 倍
+//   static constexpr size_t kGrowthDenominator;
+//   static constexpr size_t kCompactDivisor;     为0时容量只增不减；否则缩短或者赋值以后长度不超过占用空间的1/kCompactDivisor时自动shrink_to_fit
+// 小字符串的最大长度由布局决定（23个字符），不能配置
+namespace fool
+{
+    // 默认的分界，和原来的行为一致
+    struct default_hstring_traits
+    {
+        static constexpr size_t kMaxMediumSize = 254;
+        static constexpr size_t kFirstGrowth = 46;
+        static constexpr size_t kGrowthNumerator = 3;
+        static constexpr size_t kGrowthDenominator = 2;
+        static constexpr size_t kCompactDivisor = 0;
+    };
+
+    // 没有写时复制：所有放不进小字符串的都是中字符串，拷贝就是深拷贝，修改时不需要检查引用计数
+    // 切片、映射文件和RefCountedStorage仍然会产生大字符串，它们的行为不变
+    struct nocow_hstring_traits : default_hstring_traits
+    {
+        static constexpr size_t kMaxMediumSize = size_t(-1) >> 4;
+    };
+
+    // 加宽中字符串的范围，几百字节的值拷贝一次的代价和一次原子操作差不多，不值得共享
+    // 中字符串的上限超过了slab分配器的大小类，多出来的部分直接走malloc
+    struct wide_medium_hstring_traits : default_hstring_traits
+    {
+        static constexpr size_t kMaxMediumSize = 1023;
+    };
+
+    // 长期保存的字符串（缓存里的值）偶尔变得很长又缩回去，不让它一直占着峰值时的空间
+    // 收缩到容量的1/4以下才重新分配，反复pop_back时总的拷贝量仍然是线性的
+    struct compacting_hstring_traits : default_hstring_traits
+    {
+        static constexpr size_t kCompactDivisor = 4;
+    };
+}
+
+#endif
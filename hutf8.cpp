@@ -0,0 +1,741 @@
+#include "hutf8.h"
+#include "likely.h"
+
+#include <assert.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+// 用到了64位的提取指令，只在x86-64上开启向量实现
+#if defined(__x86_64__)
+#define FOOL_UTF8_X86 1
+#include <immintrin.h>
+#else
+#define FOOL_UTF8_X86 0
+#endif
+
+using namespace fool;
+using hutf8::npos;
+
+namespace
+{
+    typedef bool (*ValidateFn)(const char *s, size_t n);
+    typedef size_t (*CountFn)(const char *s, size_t n);
+    typedef size_t (*ToUtf16Fn)(const char *s, size_t n, char16_t *out);
+    typedef size_t (*Count16Fn)(const char16_t *s, size_t n);
+    typedef size_t (*ToUtf8Fn)(const char16_t *s, size_t n, char *out);
+
+    /*------------------------------------------------逐个码点的编解码------------------------------------------------------------------------*/
+
+    inline bool isCont(unsigned char c)
+    {
+        return (c & 0xC0) == 0x80;
+    }
+
+    // 解码s开头的一个码点，n是剩下的字节数，返回用掉的字节数，不合法时返回0
+    // 第二个字节的范围按Unicode标准的表3-7检查，排除过长编码、代理区和超过U+10FFFF的码点
+    inline size_t decode8(const unsigned char *s, size_t n, char32_t &cp)
+    {
+        auto const c = s[0];
+        if (c < 0x80)
+        {
+            cp = c;
+            return 1;
+        }
+        if (c < 0xC2)
+        {
+            return 0;
+        }
+        if (c < 0xE0)
+        {
+            if (n < 2 || !isCont(s[1]))
+            {
+                return 0;
+            }
+            cp = char32_t(c & 0x1F) << 6 | (s[1] & 0x3F);
+            return 2;
+        }
+        if (c < 0xF0)
+        {
+            if (n < 3 || !isCont(s[1]) || !isCont(s[2]) || (c == 0xE0 && s[1] < 0xA0) || (c == 0xED && s[1] >= 0xA0))
+            {
+                return 0;
+            }
+            cp = char32_t(c & 0x0F) << 12 | char32_t(s[1] & 0x3F) << 6 | (s[2] & 0x3F);
+            return 3;
+        }
+        if (c < 0xF5)
+        {
+            if (n < 4 || !isCont(s[1]) || !isCont(s[2]) || !isCont(s[3]) || (c == 0xF0 && s[1] < 0x90) || (c == 0xF4 && s[1] >= 0x90))
+            {
+                return 0;
+            }
+            cp = char32_t(c & 0x07) << 18 | char32_t(s[1] & 0x3F) << 12 | char32_t(s[2] & 0x3F) << 6 | (s[3] & 0x3F);
+            return 4;
+        }
+        return 0;
+    }
+
+    inline char16_t *encode16(char32_t cp, char16_t *out)
+    {
+        if (cp < 0x10000)
+        {
+            *out++ = char16_t(cp);
+        }
+        else
+        {
+            cp -= 0x10000;
+            *out++ = char16_t(0xD800 + (cp >> 10));
+            *out++ = char16_t(0xDC00 + (cp & 0x3FF));
+        }
+        return out;
+    }
+
+    // 解码s开头的一个码点，返回用掉的单元数，落单的代理返回0
+    inline size_t decode16(const char16_t *s, size_t n, char32_t &cp)
+    {
+        auto const u = s[0];
+        if ((u & 0xF800) != 0xD800)
+        {
+            cp = u;
+            return 1;
+        }
+        if (u >= 0xDC00 || n < 2 || (s[1] & 0xFC00) != 0xDC00)
+        {
+            return 0;
+        }
+        cp = 0x10000 + (char32_t(u - 0xD800) << 10) + (s[1] - 0xDC00);
+        return 2;
+    }
+
+    inline char *encode8(char32_t cp, char *out)
+    {
+        if (cp < 0x80)
+        {
+            *out++ = char(cp);
+        }
+        else if (cp < 0x800)
+        {
+            *out++ = char(0xC0 | (cp >> 6));
+            *out++ = char(0x80 | (cp & 0x3F));
+        }
+        else if (cp < 0x10000)
+        {
+            *out++ = char(0xE0 | (cp >> 12));
+            *out++ = char(0x80 | ((cp >> 6) & 0x3F));
+            *out++ = char(0x80 | (cp & 0x3F));
+        }
+        else
+        {
+            *out++ = char(0xF0 | (cp >> 18));
+            *out++ = char(0x80 | ((cp >> 12) & 0x3F));
+            *out++ = char(0x80 | ((cp >> 6) & 0x3F));
+            *out++ = char(0x80 | (cp & 0x3F));
+        }
+        return out;
+    }
+
+    // 从s[i]开始解码到至少end为止，返回新的i，遇到不合法的输入返回npos
+    // 向量实现遇到含多字节序列的块时用它处理这一块，最后一个序列可以越过end
+    inline size_t toUtf16Until(const char *s, size_t n, size_t i, size_t end, char16_t *&out)
+    {
+        auto const u = reinterpret_cast<const unsigned char *>(s);
+        while (i < end)
+        {
+            char32_t cp;
+            auto const k = decode8(u + i, n - i, cp);
+            if (FOOL_UNLIKELY(k == 0))
+            {
+                return npos;
+            }
+            out = encode16(cp, out);
+            i += k;
+        }
+        return i;
+    }
+
+    inline size_t toUtf8Until(const char16_t *s, size_t n, size_t i, size_t end, char *&out)
+    {
+        while (i < end)
+        {
+            char32_t cp;
+            auto const k = decode16(s + i, n - i, cp);
+            if (FOOL_UNLIKELY(k == 0))
+            {
+                return npos;
+            }
+            out = encode8(cp, out);
+            i += k;
+        }
+        return i;
+    }
+
+    /*------------------------------------------------标量实现------------------------------------------------------------------------*/
+
+    // 一次看8个字节，全是ASCII就跳过
+    inline bool isAscii8(const char *s)
+    {
+        uint64_t w;
+        memcpy(&w, s, 8);
+        return (w & 0x8080808080808080ull) == 0;
+    }
+
+    bool validateScalar(const char *s, size_t n)
+    {
+        auto const u = reinterpret_cast<const unsigned char *>(s);
+        size_t i = 0;
+        while (i < n)
+        {
+            if (i + 8 <= n && isAscii8(s + i))
+            {
+                i += 8;
+                continue;
+            }
+            char32_t cp;
+            auto const k = decode8(u + i, n - i, cp);
+            if (k == 0)
+            {
+                return false;
+            }
+            i += k;
+        }
+        return true;
+    }
+
+    size_t lengthScalar(const char *s, size_t n)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            count += !isCont(static_cast<unsigned char>(s[i]));
+        }
+        return count;
+    }
+
+    // 四字节序列在UTF-16里是两个单元，首字节是11110xxx
+    size_t utf16LengthScalar(const char *s, size_t n)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            auto const c = static_cast<unsigned char>(s[i]);
+            count += !isCont(c) + (c >= 0xF0);
+        }
+        return count;
+    }
+
+    size_t toUtf16Scalar(const char *s, size_t n, char16_t *out)
+    {
+        auto const begin = out;
+        return toUtf16Until(s, n, 0, n, out) == npos ? npos : size_t(out - begin);
+    }
+
+    // 代理不检查是否成对，每个算2个字节，一对正好是4个字节
+    size_t utf8LengthScalar(const char16_t *s, size_t n)
+    {
+        size_t count = n;
+        for (size_t i = 0; i < n; ++i)
+        {
+            auto const u = s[i];
+            count += (u >= 0x80) + (u >= 0x800 && (u & 0xF800) != 0xD800);
+        }
+        return count;
+    }
+
+    size_t toUtf8Scalar(const char16_t *s, size_t n, char *out)
+    {
+        auto const begin = out;
+        return toUtf8Until(s, n, 0, n, out) == npos ? npos : size_t(out - begin);
+    }
+
+#if FOOL_UTF8_X86
+    /*------------------------------------------------查表校验用到的表------------------------------------------------------------------------*/
+
+    // 每一位代表一种错误，前一个字节的高半字节、低半字节和当前字节的高半字节各查出一组可能的错误，三组都有的才是真的错误
+    constexpr uint8_t kTooShort = 1 << 0;   // 11______ 0_______ 或 11______ 11______，首字节后面缺少后续字节
+    constexpr uint8_t kTooLong = 1 << 1;    // 0_______ 10______，ASCII后面跟着后续字节
+    constexpr uint8_t kOverlong3 = 1 << 2;  // 11100000 100_____
+    constexpr uint8_t kTooLarge = 1 << 3;   // 11110100 1001____，11110100 101_____，11110101以上
+    constexpr uint8_t kSurrogate = 1 << 4;  // 11101101 101_____
+    constexpr uint8_t kOverlong2 = 1 << 5;  // 1100000_ 10______
+    constexpr uint8_t kTooLarge1000 = 1 << 6; // 11110100以上 1000____
+    constexpr uint8_t kOverlong4 = 1 << 6;  // 11110000 1000____
+    constexpr uint8_t kTwoConts = 1 << 7;   // 10______ 10______，除非是三字节、四字节序列的第3、4个字节
+    constexpr uint8_t kCarry = kTooShort | kTooLong | kTwoConts;
+
+    alignas(16) const uint8_t kByte1High[16] = {
+        // 0_______ ASCII
+        kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,
+        // 10______ 后续字节
+        kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+        // 1100____
+        kTooShort | kOverlong2,
+        // 1101____
+        kTooShort,
+        // 1110____
+        kTooShort | kOverlong3 | kSurrogate,
+        // 1111____
+        kTooShort | kTooLarge | kTooLarge1000 | kOverlong4};
+
+    alignas(16) const uint8_t kByte1Low[16] = {
+        // ____0000
+        kCarry | kOverlong3 | kOverlong2 | kOverlong4,
+        // ____0001
+        kCarry | kOverlong2,
+        // ____001_
+        kCarry, kCarry,
+        // ____0100
+        kCarry | kTooLarge,
+        // ____0101 - ____1100
+        kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000,
+        kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000,
+        kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000,
+        // ____1101
+        kCarry | kTooLarge | kTooLarge1000 | kSurrogate,
+        // ____111_
+        kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000};
+
+    alignas(16) const uint8_t kByte2High[16] = {
+        // 0_______ ASCII
+        kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort,
+        // 1000____
+        kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4,
+        // 1001____
+        kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+        // 101_____
+        kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+        kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+        // 11______
+        kTooShort, kTooShort, kTooShort, kTooShort};
+
+    // 块的最后3个字节如果是多字节序列的开头，序列一定延续到了下一块
+    alignas(16) const uint8_t kMaxComplete[16] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF};
+
+    /*------------------------------------------------SSE实现------------------------------------------------------------------------*/
+
+    // 校验状态：累积的错误、上一块、上一块末尾是否有没结束的序列
+    struct CheckerSSE
+    {
+        __m128i error;
+        __m128i prev;
+        __m128i prevIncomplete;
+    };
+
+    // prev是上一块，input是这一块，返回这一块里每个字节和它前面字节之间的错误
+    __attribute__((target("ssse3"))) inline __m128i checkBlockSSE(__m128i input, __m128i prev)
+    {
+        const __m128i nibbleMask = _mm_set1_epi8(0x0F);
+        const __m128i prev1 = _mm_alignr_epi8(input, prev, 15);
+        const __m128i byte1High = _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(kByte1High)),
+                                                   _mm_and_si128(_mm_srli_epi16(prev1, 4), nibbleMask));
+        const __m128i byte1Low = _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(kByte1Low)),
+                                                  _mm_and_si128(prev1, nibbleMask));
+        const __m128i byte2High = _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i *>(kByte2High)),
+                                                   _mm_and_si128(_mm_srli_epi16(input, 4), nibbleMask));
+        const __m128i special = _mm_and_si128(_mm_and_si128(byte1High, byte1Low), byte2High);
+        // 前面第2个字节是1110____或者前面第3个字节是11110___时，这个字节必须是后续字节
+        // 这种情况下两个后续字节相邻是对的，查表时报的kTwoConts（最高位）正好被异或掉
+        const __m128i prev2 = _mm_alignr_epi8(input, prev, 14);
+        const __m128i prev3 = _mm_alignr_epi8(input, prev, 13);
+        const __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8(char(0xE0 - 0x80)));
+        const __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(char(0xF0 - 0x80)));
+        const __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(char(0x80)));
+        return _mm_xor_si128(must23, special);
+    }
+
+    __attribute__((target("ssse3"))) inline void checkNextSSE(CheckerSSE &c, __m128i input)
+    {
+        if (_mm_movemask_epi8(input) == 0)
+        {
+            // 纯ASCII的块，只要上一块没有没结束的序列就没有错误
+            c.error = _mm_or_si128(c.error, c.prevIncomplete);
+            c.prevIncomplete = _mm_setzero_si128();
+        }
+        else
+        {
+            c.error = _mm_or_si128(c.error, checkBlockSSE(input, c.prev));
+            c.prevIncomplete = _mm_subs_epu8(input, _mm_load_si128(reinterpret_cast<const __m128i *>(kMaxComplete)));
+        }
+        c.prev = input;
+    }
+
+    __attribute__((target("ssse3"))) bool validateSSE(const char *s, size_t n)
+    {
+        CheckerSSE c = {_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            checkNextSSE(c, _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i)));
+        }
+        if (i < n)
+        {
+            // 剩下的部分补0凑成一块，0是ASCII，被截断的序列会报kTooShort
+            alignas(16) char tail[16] = {};
+            memcpy(tail, s + i, n - i);
+            checkNextSSE(c, _mm_load_si128(reinterpret_cast<const __m128i *>(tail)));
+        }
+        c.error = _mm_or_si128(c.error, c.prevIncomplete);
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(c.error, _mm_setzero_si128())) == 0xFFFF;
+    }
+
+    // 不是后续字节的字节数，kFour时四字节序列的首字节多算一次
+    // 每个块往8位的计数器上加，最多加255次之前用sad横向求和
+    template <bool kFour>
+    __attribute__((target("sse2"))) size_t countSSE2(const char *s, size_t n)
+    {
+        const __m128i notCont = _mm_set1_epi8(char(0xBF)); // 有符号比较，大于-65的不是后续字节
+        const __m128i four = _mm_set1_epi8(char(0xF0));
+        constexpr size_t kMaxBlocks = kFour ? 127 : 255;
+        size_t count = 0;
+        size_t i = 0;
+        while (i + 16 <= n)
+        {
+            __m128i acc = _mm_setzero_si128();
+            for (size_t k = 0; k < kMaxBlocks && i + 16 <= n; ++k, i += 16)
+            {
+                const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+                acc = _mm_sub_epi8(acc, _mm_cmpgt_epi8(x, notCont));
+                if (kFour)
+                {
+                    acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(_mm_max_epu8(x, four), x));
+                }
+            }
+            const __m128i sum = _mm_sad_epu8(acc, _mm_setzero_si128());
+            count += size_t(_mm_cvtsi128_si64(sum)) + size_t(_mm_cvtsi128_si64(_mm_unpackhi_epi64(sum, sum)));
+        }
+        return count + (kFour ? utf16LengthScalar(s + i, n - i) : lengthScalar(s + i, n - i));
+    }
+
+    __attribute__((target("sse2"))) size_t toUtf16SSE2(const char *s, size_t n, char16_t *out)
+    {
+        auto const begin = out;
+        size_t i = 0;
+        while (i + 16 <= n)
+        {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            if (_mm_movemask_epi8(x) == 0)
+            {
+                // 纯ASCII，补0展开成16位
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_unpacklo_epi8(x, _mm_setzero_si128()));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 8), _mm_unpackhi_epi8(x, _mm_setzero_si128()));
+                out += 16;
+                i += 16;
+            }
+            else if ((i = toUtf16Until(s, n, i, i + 16, out)) == npos)
+            {
+                return npos;
+            }
+        }
+        return toUtf16Until(s, n, i, n, out) == npos ? npos : size_t(out - begin);
+    }
+
+    // 8个单元里不小于0x80的个数加上不小于0x800且不是代理的个数，movemask每个单元占2位
+    __attribute__((target("sse2"))) size_t utf8LengthSSE2(const char16_t *s, size_t n)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i m80 = _mm_set1_epi16(short(0xFF80));
+        const __m128i m800 = _mm_set1_epi16(short(0xF800));
+        const __m128i surrogate = _mm_set1_epi16(short(0xD800));
+        size_t extra = 0;
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8)
+        {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            const __m128i hi = _mm_and_si128(x, m800);
+            auto const small = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(x, m80), zero)));
+            auto const two = unsigned(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi16(hi, zero), _mm_cmpeq_epi16(hi, surrogate))));
+            extra += unsigned(__builtin_popcount(~small & 0xFFFF) + __builtin_popcount(~two & 0xFFFF)) / 2;
+        }
+        return i + extra + utf8LengthScalar(s + i, n - i);
+    }
+
+    __attribute__((target("sse2"))) size_t toUtf8SSE2(const char16_t *s, size_t n, char *out)
+    {
+        auto const begin = out;
+        const __m128i m80 = _mm_set1_epi16(short(0xFF80));
+        size_t i = 0;
+        while (i + 8 <= n)
+        {
+            const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(x, m80), _mm_setzero_si128())) == 0xFFFF)
+            {
+                // 纯ASCII，压缩成8位
+                _mm_storel_epi64(reinterpret_cast<__m128i *>(out), _mm_packus_epi16(x, x));
+                out += 8;
+                i += 8;
+            }
+            else if ((i = toUtf8Until(s, n, i, i + 8, out)) == npos)
+            {
+                return npos;
+            }
+        }
+        return toUtf8Until(s, n, i, n, out) == npos ? npos : size_t(out - begin);
+    }
+
+    /*------------------------------------------------AVX2实现------------------------------------------------------------------------*/
+
+    struct CheckerAVX2
+    {
+        __m256i error;
+        __m256i prev;
+        __m256i prevIncomplete;
+    };
+
+    // vpalignr只在128位的通道内移动，先把上一块的高半部分和这一块的低半部分拼起来
+    template <int N>
+    __attribute__((target("avx2"))) inline __m256i prevAVX2(__m256i input, __m256i prev)
+    {
+        return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - N);
+    }
+
+    __attribute__((target("avx2"))) inline __m256i loadTable(const uint8_t *t)
+    {
+        return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(t)));
+    }
+
+    __attribute__((target("avx2"))) inline __m256i checkBlockAVX2(__m256i input, __m256i prev)
+    {
+        const __m256i nibbleMask = _mm256_set1_epi8(0x0F);
+        const __m256i prev1 = prevAVX2<1>(input, prev);
+        const __m256i byte1High = _mm256_shuffle_epi8(loadTable(kByte1High), _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibbleMask));
+        const __m256i byte1Low = _mm256_shuffle_epi8(loadTable(kByte1Low), _mm256_and_si256(prev1, nibbleMask));
+        const __m256i byte2High = _mm256_shuffle_epi8(loadTable(kByte2High), _mm256_and_si256(_mm256_srli_epi16(input, 4), nibbleMask));
+        const __m256i special = _mm256_and_si256(_mm256_and_si256(byte1High, byte1Low), byte2High);
+        const __m256i third = _mm256_subs_epu8(prevAVX2<2>(input, prev), _mm256_set1_epi8(char(0xE0 - 0x80)));
+        const __m256i fourth = _mm256_subs_epu8(prevAVX2<3>(input, prev), _mm256_set1_epi8(char(0xF0 - 0x80)));
+        const __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(char(0x80)));
+        return _mm256_xor_si256(must23, special);
+    }
+
+    __attribute__((target("avx2"))) inline void checkNextAVX2(CheckerAVX2 &c, __m256i input)
+    {
+        if (_mm256_movemask_epi8(input) == 0)
+        {
+            c.error = _mm256_or_si256(c.error, c.prevIncomplete);
+            c.prevIncomplete = _mm256_setzero_si256();
+        }
+        else
+        {
+            c.error = _mm256_or_si256(c.error, checkBlockAVX2(input, c.prev));
+            // 只有高半部分的最后3个字节需要检查
+            const __m256i maxComplete = _mm256_inserti128_si256(_mm256_set1_epi8(char(0xFF)),
+                                                                _mm_load_si128(reinterpret_cast<const __m128i *>(kMaxComplete)), 1);
+            c.prevIncomplete = _mm256_subs_epu8(input, maxComplete);
+        }
+        c.prev = input;
+    }
+
+    __attribute__((target("avx2"))) bool validateAVX2(const char *s, size_t n)
+    {
+        CheckerAVX2 c = {_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32)
+        {
+            checkNextAVX2(c, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i)));
+        }
+        if (i < n)
+        {
+            alignas(32) char tail[32] = {};
+            memcpy(tail, s + i, n - i);
+            checkNextAVX2(c, _mm256_load_si256(reinterpret_cast<const __m256i *>(tail)));
+        }
+        c.error = _mm256_or_si256(c.error, c.prevIncomplete);
+        return _mm256_testz_si256(c.error, c.error) != 0;
+    }
+
+    template <bool kFour>
+    __attribute__((target("avx2"))) size_t countAVX2(const char *s, size_t n)
+    {
+        const __m256i notCont = _mm256_set1_epi8(char(0xBF));
+        const __m256i four = _mm256_set1_epi8(char(0xF0));
+        constexpr size_t kMaxBlocks = kFour ? 127 : 255;
+        size_t count = 0;
+        size_t i = 0;
+        while (i + 32 <= n)
+        {
+            __m256i acc = _mm256_setzero_si256();
+            for (size_t k = 0; k < kMaxBlocks && i + 32 <= n; ++k, i += 32)
+            {
+                const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+                acc = _mm256_sub_epi8(acc, _mm256_cmpgt_epi8(x, notCont));
+                if (kFour)
+                {
+                    acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(_mm256_max_epu8(x, four), x));
+                }
+            }
+            const __m256i sum = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+            count += size_t(_mm256_extract_epi64(sum, 0) + _mm256_extract_epi64(sum, 1) + _mm256_extract_epi64(sum, 2) + _mm256_extract_epi64(sum, 3));
+        }
+        _mm256_zeroupper();
+        return count + countSSE2<kFour>(s + i, n - i);
+    }
+
+    __attribute__((target("avx2"))) size_t toUtf16AVX2(const char *s, size_t n, char16_t *out)
+    {
+        auto const begin = out;
+        size_t i = 0;
+        while (i + 32 <= n)
+        {
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+            if (_mm256_movemask_epi8(x) == 0)
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(x)));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(x, 1)));
+                out += 32;
+                i += 32;
+            }
+            else if ((i = toUtf16Until(s, n, i, i + 32, out)) == npos)
+            {
+                return npos;
+            }
+        }
+        _mm256_zeroupper();
+        auto const r = toUtf16SSE2(s + i, n - i, out);
+        return r == npos ? npos : size_t(out - begin) + r;
+    }
+
+    __attribute__((target("avx2"))) size_t utf8LengthAVX2(const char16_t *s, size_t n)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i m80 = _mm256_set1_epi16(short(0xFF80));
+        const __m256i m800 = _mm256_set1_epi16(short(0xF800));
+        const __m256i surrogate = _mm256_set1_epi16(short(0xD800));
+        size_t extra = 0;
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16)
+        {
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+            const __m256i hi = _mm256_and_si256(x, m800);
+            auto const small = unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(x, m80), zero)));
+            auto const two = unsigned(_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi16(hi, zero), _mm256_cmpeq_epi16(hi, surrogate))));
+            extra += unsigned(__builtin_popcount(~small) + __builtin_popcount(~two)) / 2;
+        }
+        _mm256_zeroupper();
+        return i + extra + utf8LengthSSE2(s + i, n - i);
+    }
+
+    __attribute__((target("avx2"))) size_t toUtf8AVX2(const char16_t *s, size_t n, char *out)
+    {
+        auto const begin = out;
+        const __m256i m80 = _mm256_set1_epi16(short(0xFF80));
+        size_t i = 0;
+        while (i + 16 <= n)
+        {
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+            if (_mm256_testz_si256(x, m80))
+            {
+                // vpackuswb也是按通道交错的，直接拿两个128位的半边压缩
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_packus_epi16(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1)));
+                out += 16;
+                i += 16;
+            }
+            else if ((i = toUtf8Until(s, n, i, i + 16, out)) == npos)
+            {
+                return npos;
+            }
+        }
+        _mm256_zeroupper();
+        auto const r = toUtf8SSE2(s + i, n - i, out);
+        return r == npos ? npos : size_t(out - begin) + r;
+    }
+#endif
+
+    /*------------------------------------------------运行时分发------------------------------------------------------------------------*/
+
+    struct Kernels
+    {
+        hsearch::Level level;
+        ValidateFn validate;
+        CountFn length;
+        CountFn utf16Length;
+        ToUtf16Fn toUtf16;
+        Count16Fn utf8Length;
+        ToUtf8Fn toUtf8;
+    };
+
+    const Kernels kScalarKernels = {hsearch::Level::Scalar, validateScalar, lengthScalar, utf16LengthScalar,
+                                    toUtf16Scalar, utf8LengthScalar, toUtf8Scalar};
+#if FOOL_UTF8_X86
+    // 校验需要pshufb和palignr（SSSE3），只有SSE2的老CPU在校验上退回标量实现
+    const Kernels kSSEKernels = {hsearch::Level::SSE2, validateSSE, countSSE2<false>, countSSE2<true>,
+                                 toUtf16SSE2, utf8LengthSSE2, toUtf8SSE2};
+    const Kernels kSSE2OnlyKernels = {hsearch::Level::SSE2, validateScalar, countSSE2<false>, countSSE2<true>,
+                                      toUtf16SSE2, utf8LengthSSE2, toUtf8SSE2};
+    const Kernels kAVX2Kernels = {hsearch::Level::AVX2, validateAVX2, countAVX2<false>, countAVX2<true>,
+                                  toUtf16AVX2, utf8LengthAVX2, toUtf8AVX2};
+#endif
+
+    const Kernels *kernelsFor(hsearch::Level l)
+    {
+#if FOOL_UTF8_X86
+        switch (l)
+        {
+        case hsearch::Level::AVX2:
+            return &kAVX2Kernels;
+        case hsearch::Level::SSE2:
+            return __builtin_cpu_supports("ssse3") ? &kSSEKernels : &kSSE2OnlyKernels;
+        case hsearch::Level::Scalar:
+            break;
+        }
+#endif
+        (void)l;
+        return &kScalarKernels;
+    }
+
+    std::atomic<const Kernels *> gKernels(nullptr);
+
+    const Kernels *kernels()
+    {
+        auto k = gKernels.load(std::memory_order_acquire);
+        if (FOOL_UNLIKELY(k == nullptr))
+        {
+            k = kernelsFor(hsearch::bestLevel());
+            gKernels.store(k, std::memory_order_release);
+        }
+        return k;
+    }
+}
+
+hsearch::Level hutf8::level()
+{
+    return kernels()->level;
+}
+
+void hutf8::setLevel(hsearch::Level l)
+{
+    auto const best = hsearch::bestLevel();
+    gKernels.store(kernelsFor(static_cast<int>(l) > static_cast<int>(best) ? best : l), std::memory_order_release);
+}
+
+/*------------------------------------------------对外接口------------------------------------------------------------------------*/
+
+bool hutf8::validate(const char *s, size_t n)
+{
+    return kernels()->validate(s, n);
+}
+
+size_t hutf8::length(const char *s, size_t n)
+{
+    return kernels()->length(s, n);
+}
+
+size_t hutf8::utf16Length(const char *s, size_t n)
+{
+    return kernels()->utf16Length(s, n);
+}
+
+size_t hutf8::toUtf16(const char *s, size_t n, char16_t *out)
+{
+    return kernels()->toUtf16(s, n, out);
+}
+
+size_t hutf8::utf8Length(const char16_t *s, size_t n)
+{
+    return kernels()->utf8Length(s, n);
+}
+
+size_t hutf8::toUtf8(const char16_t *s, size_t n, char *out)
+{
+    return kernels()->toUtf8(s, n, out);
+}
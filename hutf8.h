@@ -0,0 +1,107 @@
+#ifndef HXMMXH_UTF8_H
+#define HXMMXH_UTF8_H
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "hexception.h"
+#include "hsearch.h"
+#include "hstring.h"
+
+// UTF-8的校验、计数和与UTF-16之间的转换
+// 校验用查表法：相邻两个字节的高低半字节各查一次表，三个结果按位与就是这两个字节之间的错误，
+// 再用前面第2、3个字节检查三字节、四字节序列的后续字节，一次判断16/32个字节，没有分支
+// 计数只看哪些字节不是后续字节（10xxxxxx）；转换时纯ASCII的块直接展开/压缩，遇到多字节序列再逐个解码
+// 和hsearch一样运行时按CPU选择AVX2、SSE（校验需要SSSE3）或者纯标量实现
+namespace fool
+{
+    namespace hutf8
+    {
+        constexpr size_t npos = size_t(-1);
+
+        // 级别和hsearch共用同一套定义，但是各自独立设置
+        hsearch::Level level();
+        void setLevel(hsearch::Level l);
+
+        // 是否是合法的UTF-8：拒绝过长编码、代理区（U+D800-U+DFFF）、超过U+10FFFF的码点和被截断的序列
+        bool validate(const char *s, size_t n);
+        // 码点的个数，s必须是合法的UTF-8，否则结果是不是后续字节的字节数
+        size_t length(const char *s, size_t n);
+        // 转成UTF-16需要的单元数，s必须是合法的UTF-8
+        size_t utf16Length(const char *s, size_t n);
+        // 转成UTF-16写到out，out至少要有utf16Length(s, n)个单元，返回写出的单元数，s不合法时返回npos
+        size_t toUtf16(const char *s, size_t n, char16_t *out);
+        // 转成UTF-8需要的字节数，代理对算4个字节
+        size_t utf8Length(const char16_t *s, size_t n);
+        // 转成UTF-8写到out，out至少要有utf8Length(s, n)个字节，返回写出的字节数，有落单的代理时返回npos
+        size_t toUtf8(const char16_t *s, size_t n, char *out);
+    }
+
+    inline bool utf8_validate(std::string_view s)
+    {
+        return hutf8::validate(s.data(), s.size());
+    }
+
+    // 码点的个数，s必须是合法的UTF-8
+    inline size_t utf8_length(std::string_view s)
+    {
+        return hutf8::length(s.data(), s.size());
+    }
+
+    // 把UTF-8的s转成UTF-16追加到out，先算好长度只扩容一次
+    // U16String需要有size、resize和data，比如std::u16string；s不合法时out不变，抛出std::invalid_argument
+    template <class U16String>
+    U16String &append_utf16(U16String &out, std::string_view s)
+    {
+        auto const size = out.size();
+        out.resize(size + hutf8::utf16Length(s.data(), s.size()));
+        auto const n = hutf8::toUtf16(s.data(), s.size(), out.data() + size);
+        if (n == hutf8::npos)
+        {
+            out.resize(size);
+            throw_exception<std::invalid_argument>("append_utf16: invalid UTF-8");
+        }
+        out.resize(size + n);
+        return out;
+    }
+
+    // 把UTF-16的s转成UTF-8追加到out，直接写进out的空间里
+    // 有落单的代理时out不变，抛出std::invalid_argument
+    template <class String>
+    String &append_utf8(String &out, std::u16string_view s)
+    {
+        auto const size = out.size();
+        auto const need = hutf8::utf8Length(s.data(), s.size());
+        if (need == 0)
+        {
+            return out;
+        }
+        auto const n = hutf8::toUtf8(s.data(), s.size(), out.appendNoinit(need));
+        if (n == hutf8::npos)
+        {
+            out.resize(size);
+            throw_exception<std::invalid_argument>("append_utf8: unpaired surrogate");
+        }
+        assert(n == need);
+        return out;
+    }
+
+    inline std::u16string utf8_to_utf16(std::string_view s)
+    {
+        std::u16string out;
+        append_utf16(out, s);
+        return out;
+    }
+
+    template <class String = hstring>
+    String utf16_to_utf8(std::u16string_view s)
+    {
+        String out;
+        append_utf8(out, s);
+        return out;
+    }
+}
+
+#endif
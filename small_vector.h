@@ -0,0 +1,533 @@
+#ifndef HXMMXH_SMALL_VECTOR_H
+#define HXMMXH_SMALL_VECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <assert.h>
+
+#include "hexception.h"
+#include "hmalloc.h"
+#include "likely.h"
+
+namespace fool
+{
+    // 最多N个元素放在对象内部，超过了才放到堆上，和hstring_core的小字符串是同一个思路
+    // 布局：size_t size_ + union{ 内部的N个元素, 堆上的data_和capacity_ }
+    // 元素在内部还是堆上用size_的最高位表示，就像hstring_core把类型放在capacity_最高字节的空闲位里，不需要额外的字段
+    // 可以平凡拷贝的元素按字节搬动，堆上扩容直接用smartRealloc；其他的元素逐个移动构造
+    template <class T, size_t N>
+    class small_vector
+    {
+        static_assert(N > 0, "small_vector: N must be positive");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "small_vector: over-aligned T is not supported by malloc");
+
+    public:
+        typedef T value_type;
+        typedef size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef T &reference;
+        typedef const T &const_reference;
+        typedef T *pointer;
+        typedef const T *const_pointer;
+        typedef T *iterator;
+        typedef const T *const_iterator;
+        typedef std::reverse_iterator<iterator> reverse_iterator;
+        typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+        // 构造函数
+        small_vector() noexcept : size_(0) {}
+        explicit small_vector(size_type n) : small_vector() { resize(n); }
+        small_vector(size_type n, const T &value) : small_vector() { assign(n, value); }
+        template <class InIt, class = typename std::iterator_traits<InIt>::iterator_category>
+        small_vector(InIt first, InIt last) : small_vector() { assign(first, last); }
+        small_vector(std::initializer_list<T> il) : small_vector() { assign(il.begin(), il.end()); }
+        // 委托给默认构造函数，对象在这之后就算构造完成了，拷贝元素时抛出异常也会调用析构函数释放堆上的空间
+        small_vector(const small_vector &rhs) : small_vector() { assign(rhs.begin(), rhs.end()); }
+        small_vector(small_vector &&rhs) noexcept(std::is_nothrow_move_constructible<T>::value);
+        ~small_vector();
+
+        // 赋值
+        small_vector &operator=(const small_vector &rhs);
+        small_vector &operator=(small_vector &&rhs) noexcept(std::is_nothrow_move_constructible<T>::value);
+        small_vector &operator=(std::initializer_list<T> il)
+        {
+            assign(il.begin(), il.end());
+            return *this;
+        }
+        void assign(size_type n, const T &value);
+        template <class InIt, class = typename std::iterator_traits<InIt>::iterator_category>
+        void assign(InIt first, InIt last);
+        void assign(std::initializer_list<T> il) { assign(il.begin(), il.end()); }
+
+        // 大小和容量
+        size_type size() const { return size_ & kSizeMask; }
+        bool empty() const { return size() == 0; }
+        size_type capacity() const { return isInline() ? N : heap_.capacity_; }
+        static constexpr size_type inlineCapacity() { return N; }
+        size_type max_size() const { return kSizeMask / sizeof(T); }
+        // 元素是否放在对象内部
+        bool isInline() const { return (size_ & kHeapFlag) == 0; }
+        void reserve(size_type n)
+        {
+            if (n > capacity())
+            {
+                grow(n);
+            }
+        }
+        void resize(size_type n);
+        void resize(size_type n, const T &value);
+        void clear() noexcept
+        {
+            destroyRange(begin(), end());
+            setSize(0);
+        }
+
+        // 元素访问
+        T *data() { return isInline() ? inlineData() : heap_.data_; }
+        const T *data() const { return isInline() ? inlineData() : heap_.data_; }
+        iterator begin() { return data(); }
+        iterator end() { return data() + size(); }
+        const_iterator begin() const { return data(); }
+        const_iterator end() const { return data() + size(); }
+        const_iterator cbegin() const { return begin(); }
+        const_iterator cend() const { return end(); }
+        reverse_iterator rbegin() { return reverse_iterator(end()); }
+        reverse_iterator rend() { return reverse_iterator(begin()); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+        T &operator[](size_type i)
+        {
+            assert(i < size());
+            return data()[i];
+        }
+        const T &operator[](size_type i) const
+        {
+            assert(i < size());
+            return data()[i];
+        }
+        T &at(size_type i);
+        const T &at(size_type i) const;
+        T &front() { return (*this)[0]; }
+        const T &front() const { return (*this)[0]; }
+        T &back() { return (*this)[size() - 1]; }
+        const T &back() const { return (*this)[size() - 1]; }
+
+        // 修改
+        void push_back(const T &value) { emplace_back(value); }
+        void push_back(T &&value) { emplace_back(std::move(value)); }
+        template <class... Args>
+        T &emplace_back(Args &&... args);
+        void pop_back()
+        {
+            assert(!empty());
+            data()[size() - 1].~T();
+            setSize(size() - 1);
+        }
+        iterator insert(const_iterator pos, const T &value) { return emplace(pos, value); }
+        iterator insert(const_iterator pos, T &&value) { return emplace(pos, std::move(value)); }
+        template <class... Args>
+        iterator emplace(const_iterator pos, Args &&... args);
+        iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+        iterator erase(const_iterator first, const_iterator last);
+        void swap(small_vector &rhs);
+
+    private:
+        constexpr static size_t kHeapFlag = size_t(1) << (sizeof(size_t) * 8 - 1);
+        constexpr static size_t kSizeMask = ~kHeapFlag;
+        // 可以按字节搬动的元素
+        constexpr static bool kRelocatable = std::is_trivially_copyable<T>::value;
+
+        struct Heap
+        {
+            T *data_;
+            size_t capacity_;
+        };
+
+        T *inlineData() { return reinterpret_cast<T *>(inline_); }
+        const T *inlineData() const { return reinterpret_cast<const T *>(inline_); }
+        void setSize(size_t n)
+        {
+            assert(n <= kSizeMask);
+            size_ = (size_ & kHeapFlag) | n;
+        }
+        // 扩容到至少n个元素，按malloc实际给的大小记容量
+        void grow(size_type n);
+        // 下一次扩容的大小，和hstring一样是1.5倍
+        size_type growthFor(size_type n) const { return std::max(n, capacity() + capacity() / 2); }
+        void freeHeap() noexcept
+        {
+            if (!isInline())
+            {
+                sizedFree(heap_.data_, heap_.capacity_ * sizeof(T));
+                size_ &= kSizeMask;
+            }
+        }
+        // 接管rhs的元素，调用前自己必须是空的并且在内部
+        void steal(small_vector &rhs);
+
+        static void destroyRange(T *b, T *e) noexcept
+        {
+            if (!std::is_trivially_destructible<T>::value)
+            {
+                for (; b != e; ++b)
+                {
+                    b->~T();
+                }
+            }
+        }
+        // 把n个元素搬到to（未初始化的内存），from里的元素析构掉
+        static void relocate(T *from, size_t n, T *to);
+
+        size_t size_;
+        union
+        {
+            Heap heap_;
+            alignas(T) unsigned char inline_[N * sizeof(T)];
+        };
+    };
+
+    /*------------------------------------------------构造和赋值------------------------------------------------------------------------*/
+
+    template <class T, size_t N>
+    small_vector<T, N>::small_vector(small_vector &&rhs) noexcept(std::is_nothrow_move_constructible<T>::value) : small_vector()
+    {
+        steal(rhs);
+    }
+
+    template <class T, size_t N>
+    small_vector<T, N>::~small_vector()
+    {
+        clear();
+        freeHeap();
+    }
+
+    template <class T, size_t N>
+    small_vector<T, N> &small_vector<T, N>::operator=(const small_vector &rhs)
+    {
+        if (FOOL_LIKELY(&rhs != this))
+        {
+            assign(rhs.begin(), rhs.end());
+        }
+        return *this;
+    }
+
+    template <class T, size_t N>
+    small_vector<T, N> &small_vector<T, N>::operator=(small_vector &&rhs) noexcept(std::is_nothrow_move_constructible<T>::value)
+    {
+        if (FOOL_LIKELY(&rhs != this))
+        {
+            clear();
+            if (!rhs.isInline())
+            {
+                freeHeap();
+                steal(rhs);
+            }
+            else
+            {
+                // rhs在内部，自己的空间一定放得下，堆上的空间留着继续用
+                auto const n = rhs.size();
+                relocate(rhs.data(), n, data());
+                setSize(n);
+                rhs.setSize(0);
+            }
+        }
+        return *this;
+    }
+
+    template <class T, size_t N>
+    void small_vector<T, N>::steal(small_vector &rhs)
+    {
+        assert(isInline() && empty());
+        if (rhs.isInline())
+        {
+            auto const n = rhs.size();
+            relocate(rhs.inlineData(), n, inlineData());
+            setSize(n);
+            rhs.setSize(0);
+        }
+        else
+        {
+            heap_ = rhs.heap_;
+            size_ = rhs.size_;
+            rhs.size_ = 0;
+        }
+    }
+
+    template <class T, size_t N>
+    void small_vector<T, N>::assign(size_type n, const T &value)
+    {
+        if (n > capacity())
+        {
+            // value可能是自己的元素，先拷贝一份
+            T tmp(value);
+            clear();
+            grow(n);
+            std::uninitialized_fill_n(data(), n, tmp);
+        }
+        else
+        {
+            auto const sz = size();
+            std::fill_n(data(), std::min(sz, n), value);
+            if (n > sz)
+            {
+                std::uninitialized_fill_n(data() + sz, n - sz, value);
+            }
+            else
+            {
+                destroyRange(data() + n, data() + sz);
+            }
+        }
+        setSize(n);
+    }
+
+    template <class T, size_t N>
+    template <class InIt, class>
+    void small_vector<T, N>::assign(InIt first, InIt last)
+    {
+        typedef typename std::iterator_traits<InIt>::iterator_category category;
+        if constexpr (std::is_base_of<std::forward_iterator_tag, category>::value)
+        {
+            auto const n = size_type(std::distance(first, last));
+            clear();
+            reserve(n);
+            std::uninitialized_copy(first, last, data());
+            setSize(n);
+        }
+        else
+        {
+            clear();
+            for (; first != last; ++first)
+            {
+                emplace_back(*first);
+            }
+        }
+    }
+
+    /*------------------------------------------------大小和容量------------------------------------------------------------------------*/
+
+    template <class T, size_t N>
+    void small_vector<T, N>::grow(size_type n)
+    {
+        assert(n > capacity());
+        if (FOOL_UNLIKELY(n > max_size()))
+        {
+            throw_exception<std::length_error>("small_vector: size exceeds max_size()");
+        }
+        auto const bytes = goodMallocSize(n * sizeof(T));
+        auto const newCapacity = bytes / sizeof(T);
+        assert(newCapacity >= n);
+        auto const sz = size();
+        if (kRelocatable && !isInline())
+        {
+            // 堆上的可平凡拷贝的元素，交给smartRealloc决定原地扩展还是重新分配
+            heap_.data_ = static_cast<T *>(smartRealloc(heap_.data_, sz * sizeof(T), heap_.capacity_ * sizeof(T), bytes));
+            heap_.capacity_ = newCapacity;
+            return;
+        }
+        auto const newData = static_cast<T *>(checkedMalloc(bytes));
+        try
+        {
+            relocate(data(), sz, newData);
+        }
+        catch (...)
+        {
+            sizedFree(newData, bytes);
+            throw;
+        }
+        // 先把元素搬走，再覆盖内部的空间
+        freeHeap();
+        heap_.data_ = newData;
+        heap_.capacity_ = newCapacity;
+        size_ = sz | kHeapFlag;
+    }
+
+    template <class T, size_t N>
+    void small_vector<T, N>::relocate(T *from, size_t n, T *to)
+    {
+        if (kRelocatable)
+        {
+            if (n > 0)
+            {
+                std::memcpy(static_cast<void *>(to), from, n * sizeof(T));
+            }
+        }
+        else
+        {
+            // 移动可能抛异常时用拷贝，失败了原来的元素还在
+            if constexpr (std::is_nothrow_move_constructible<T>::value || !std::is_copy_constructible<T>::value)
+            {
+                std::uninitialized_move(from, from + n, to);
+            }
+            else
+            {
+                std::uninitialized_copy(from, from + n, to);
+            }
+            destroyRange(from, from + n);
+        }
+    }
+
+    template <class T, size_t N>
+    void small_vector<T, N>::resize(size_type n)
+    {
+        auto const sz = size();
+        if (n <= sz)
+        {
+            destroyRange(data() + n, data() + sz);
+        }
+        else
+        {
+            reserve(n);
+            std::uninitialized_value_construct(data() + sz, data() + n);
+        }
+        setSize(n);
+    }
+
+    template <class T, size_t N>
+    void small_vector<T, N>::resize(size_type n, const T &value)
+    {
+        auto const sz = size();
+        if (n <= sz)
+        {
+            destroyRange(data() + n, data() + sz);
+        }
+        else
+        {
+            if (n > capacity())
+            {
+                T tmp(value);
+                grow(n);
+                std::uninitialized_fill(data() + sz, data() + n, tmp);
+            }
+            else
+            {
+                std::uninitialized_fill(data() + sz, data() + n, value);
+            }
+        }
+        setSize(n);
+    }
+
+    /*------------------------------------------------元素访问和修改------------------------------------------------------------------------*/
+
+    template <class T, size_t N>
+    T &small_vector<T, N>::at(size_type i)
+    {
+        if (FOOL_UNLIKELY(i >= size()))
+        {
+            throw_exception<std::out_of_range>("small_vector::at");
+        }
+        return data()[i];
+    }
+
+    template <class T, size_t N>
+    const T &small_vector<T, N>::at(size_type i) const
+    {
+        if (FOOL_UNLIKELY(i >= size()))
+        {
+            throw_exception<std::out_of_range>("small_vector::at");
+        }
+        return data()[i];
+    }
+
+    template <class T, size_t N>
+    template <class... Args>
+    T &small_vector<T, N>::emplace_back(Args &&... args)
+    {
+        auto const sz = size();
+        if (FOOL_LIKELY(sz < capacity()))
+        {
+            auto const p = ::new (static_cast<void *>(data() + sz)) T(std::forward<Args>(args)...);
+            setSize(sz + 1);
+            return *p;
+        }
+        // 参数可能引用自己的元素，扩容前先构造出来
+        T tmp(std::forward<Args>(args)...);
+        grow(growthFor(sz + 1));
+        auto const p = ::new (static_cast<void *>(data() + sz)) T(std::move(tmp));
+        setSize(sz + 1);
+        return *p;
+    }
+
+    template <class T, size_t N>
+    template <class... Args>
+    typename small_vector<T, N>::iterator small_vector<T, N>::emplace(const_iterator pos, Args &&... args)
+    {
+        auto const i = size_type(pos - begin());
+        assert(i <= size());
+        if (i == size())
+        {
+            emplace_back(std::forward<Args>(args)...);
+            return begin() + i;
+        }
+        T tmp(std::forward<Args>(args)...);
+        // 最后一个元素往后挪一位，中间的整体后移，再把新元素放进空出来的位置
+        emplace_back(std::move(back()));
+        auto const b = begin();
+        std::move_backward(b + i, b + size() - 2, b + size() - 1);
+        b[i] = std::move(tmp);
+        return b + i;
+    }
+
+    template <class T, size_t N>
+    typename small_vector<T, N>::iterator small_vector<T, N>::erase(const_iterator first, const_iterator last)
+    {
+        auto const b = begin();
+        auto const f = b + (first - b);
+        auto const l = b + (last - b);
+        assert(b <= f && f <= l && l <= end());
+        if (f != l)
+        {
+            auto const newEnd = std::move(l, end(), f);
+            destroyRange(newEnd, end());
+            setSize(size_type(newEnd - b));
+        }
+        return f;
+    }
+
+    template <class T, size_t N>
+    void small_vector<T, N>::swap(small_vector &rhs)
+    {
+        if (!isInline() && !rhs.isInline())
+        {
+            std::swap(heap_, rhs.heap_);
+            std::swap(size_, rhs.size_);
+            return;
+        }
+        small_vector tmp(std::move(rhs));
+        rhs = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+    template <class T, size_t N>
+    inline void swap(small_vector<T, N> &lhs, small_vector<T, N> &rhs)
+    {
+        lhs.swap(rhs);
+    }
+
+    template <class T, size_t N>
+    inline bool operator==(const small_vector<T, N> &lhs, const small_vector<T, N> &rhs)
+    {
+        return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+    }
+
+    template <class T, size_t N>
+    inline bool operator!=(const small_vector<T, N> &lhs, const small_vector<T, N> &rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    template <class T, size_t N>
+    inline bool operator<(const small_vector<T, N> &lhs, const small_vector<T, N> &rhs)
+    {
+        return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
+}
+
+#endif
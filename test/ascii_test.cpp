@@ -0,0 +1,119 @@
+#include "../hascii.h"
+#include "check.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace std;
+using namespace fool;
+
+static void checkLevel(hsearch::Level lv)
+{
+    hascii::setLevel(lv);
+    mt19937 rng(7);
+
+    // 和逐字节的std::tolower/toupper比较，带上高位字节，长度覆盖块内和块尾
+    for (int round = 0; round < 3000; ++round)
+    {
+        string s(rng() % 100, 'a');
+        for (auto &c : s)
+        {
+            c = rng() % 8 == 0 ? char(rng()) : char('a' + rng() % 26);
+            if (rng() % 16 == 0)
+            {
+                c = char(toupper(static_cast<unsigned char>(c)));
+            }
+        }
+        string lower = s, upper = s, replaced = s;
+        for (auto &c : lower)
+        {
+            c = (c >= 'A' && c <= 'Z') ? char(c + 32) : c;
+        }
+        for (auto &c : upper)
+        {
+            c = (c >= 'a' && c <= 'z') ? char(c - 32) : c;
+        }
+        replace(replaced.begin(), replaced.end(), 'e', '\xE9');
+
+        hstring h(s.data(), s.size());
+        CHECK(string_view(to_lower(h)) == lower);
+        h.assign(s.data(), s.size());
+        CHECK(string_view(to_upper(h)) == upper);
+        h.assign(s.data(), s.size());
+        CHECK(string_view(replace_char(h, 'e', '\xE9')) == replaced);
+        // 高位字节当作普通字节替换
+        CHECK(string_view(replace_char(h, '\xE9', 'e')) == s || s.find('\xE9') != string::npos);
+    }
+
+    // 共享的大字符串：没有要改的字节时不脱离共享
+    const hstring big(1000, 'x');
+    hstring copy = big;
+    CHECK(copy.isShared());
+    to_lower(copy);
+    replace_char(copy, 'y', 'z');
+    CHECK(copy.isShared() && as_const(copy).data() == big.data());
+    // 有要改的字节时才复制，原来的不受影响
+    to_upper(copy);
+    CHECK(!copy.isShared() && as_const(copy).data() != big.data());
+    CHECK(copy == hstring(1000, 'X') && big == hstring(1000, 'x'));
+    // 独占的字符串原地修改
+    auto const p = as_const(copy).data();
+    to_lower(copy);
+    CHECK(as_const(copy).data() == p && copy == big);
+
+    // 大写只在最后一个字节
+    string tail(300, 'q');
+    tail.back() = 'Q';
+    hstring t(tail.data(), tail.size());
+    CHECK(to_lower(t) == hstring(300, 'q'));
+}
+
+int main()
+{
+    const hsearch::Level levels[] = {hsearch::Level::Scalar, hsearch::Level::SSE2, hsearch::Level::AVX2};
+    for (auto lv : levels)
+    {
+        checkLevel(lv);
+    }
+
+    // trim：小字符串、中字符串、大字符串
+    hstring s("  \tContent-Type \r\n");
+    CHECK(trim(s) == "Content-Type");
+    hstring empty(" \t\r\n ");
+    CHECK(trim(empty).empty());
+    hstring none("already");
+    CHECK(trim(none) == "already");
+    hstring medium = hstring(" ") + hstring(100, 'm') + hstring("\n");
+    CHECK(trim(medium) == hstring(100, 'm'));
+
+    // 共享的大字符串去掉两头，新的结尾后面不是\0，复制出自己的一份
+    hstring const body = hstring("  ") + hstring(1000, 'b') + hstring(" \n");
+    hstring shared = body;
+    trim(shared);
+    CHECK(!shared.isSlice() && as_const(shared).data() != body.data() + 2);
+    CHECK(string_view(shared) == string_view(hstring(1000, 'b')));
+    // 通过const引用取c_str()照样以\0结尾，包括只去掉尾部的
+    auto const cstr = [](const hstring &str) { return str.c_str(); };
+    CHECK(strlen(cstr(shared)) == 1000);
+    hstring sharedTail = body.substr(2);
+    CHECK(sharedTail.isSlice());
+    trim(sharedTail);
+    CHECK(strlen(cstr(sharedTail)) == 1000 && string_view(sharedTail) == string_view(shared));
+    // 独占的大字符串去掉两头不复制，切片后面原地写了\0
+    hstring own = hstring("  ") + hstring(1000, 'b') + hstring(" \n");
+    auto const ownData = as_const(own).data();
+    trim(own);
+    CHECK(own.isSlice() && as_const(own).data() == ownData + 2 && cstr(own) == ownData + 2 && strlen(cstr(own)) == 1000);
+    // 只去掉尾部
+    hstring tailOnly = hstring(1000, 'b') + hstring("   ");
+    auto const tp = as_const(tailOnly).data();
+    trim(tailOnly);
+    CHECK(tailOnly.size() == 1000 && as_const(tailOnly).data() == tp);
+
+    cout << "ascii_test passed (best level " << hsearch::levelName(hsearch::bestLevel()) << ")" << endl;
+    return 0;
+}
@@ -0,0 +1,97 @@
+#include "../hatomic.h"
+#include "check.h"
+
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace fool;
+
+// 第v个版本是长度1000+v、全部是同一个字符的字符串，读者检查拿到的快照是完整的某一个版本
+static hstring version(size_t v)
+{
+    v %= 5000;
+    return hstring(1000 + v, char('a' + v % 26));
+}
+
+static bool wellFormed(const hstring &s)
+{
+    auto const v = s.size() - 1000;
+    if (s.size() < 1000 || s[0] != char('a' + v % 26))
+    {
+        return false;
+    }
+    for (char c : string_view(s))
+    {
+        if (c != s[0])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main()
+{
+    // 单线程的语义
+    {
+        atomic_hstring a;
+        CHECK(a.load().empty());
+        a.store(hstring("small"));
+        CHECK(a.load() == "small");
+        auto const big = version(7);
+        a.store(big);
+        auto const snap = a.load();
+        CHECK(as_const(snap).data() == as_const(big).data() && snap.isShared());
+        auto const old = a.exchange(version(8));
+        CHECK(as_const(old).data() == as_const(big).data());
+        // 旧的快照不受影响
+        CHECK(string_view(snap) == string_view(big));
+        CHECK(a.visit([](const hstring &s) { return s.size(); }) == 1008);
+        // 切片发布之前先以\0结尾
+        a.store(big.substr(10, 500));
+        CHECK(a.visit([](const hstring &s) { return s.c_str()[500] == '\0'; }));
+    }
+
+    // 一个写者不停地发布，多个读者同时读
+    atomic_hstring a(version(0));
+    atomic<bool> stop(false);
+    atomic<size_t> reads(0);
+    vector<thread> readers;
+    for (int t = 0; t < 8; ++t)
+    {
+        readers.emplace_back([&, t] {
+            size_t n = 0;
+            while (!stop.load(memory_order_relaxed))
+            {
+                if (t % 2 == 0)
+                {
+                    auto const s = a.load();
+                    CHECK(wellFormed(s));
+                }
+                else
+                {
+                    CHECK(a.visit([](const hstring &s) { return wellFormed(s); }));
+                }
+                ++n;
+            }
+            reads += n;
+        });
+    }
+    for (size_t v = 1; v <= 20000; ++v)
+    {
+        a.store(version(v));
+    }
+    stop = true;
+    for (auto &t : readers)
+    {
+        t.join();
+    }
+    CHECK(wellFormed(a.load()) && a.load().size() == 1000 + 20000 % 5000);
+
+    cout << "atomic test passed, " << reads.load() << " reads" << endl;
+    return 0;
+}
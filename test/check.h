@@ -0,0 +1,23 @@
+#ifndef HXMMXH_TEST_CHECK_H
+#define HXMMXH_TEST_CHECK_H
+
+#include <cstdio>
+#include <cstdlib>
+
+// 测试用的断言，失败时和assert一样打印表达式和位置然后abort
+// 和assert不同，定义了NDEBUG（Release构建）时也照样检查，条件里的表达式总会执行
+#define CHECK(cond) ((cond) ? void(0) : ::fool::htest::checkFailed(#cond, __FILE__, __LINE__, __func__))
+
+namespace fool
+{
+    namespace htest
+    {
+        [[noreturn]] inline void checkFailed(const char *expr, const char *file, int line, const char *func)
+        {
+            fprintf(stderr, "%s:%d: %s: Check `%s' failed.\n", file, line, func, expr);
+            abort();
+        }
+    }
+}
+
+#endif
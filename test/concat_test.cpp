@@ -0,0 +1,56 @@
+#include "../hconcat.h"
+#include "check.h"
+
+#include <iostream>
+#include <climits>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace fool;
+
+int main()
+{
+    // 各种类型的段
+    hstring tenant("acme");
+    string shard = "eu-west";
+    auto const key = hconcat(tenant, ':', shard, ':', 42, ":", string_view("x"));
+    CHECK(string_view(key) == "acme:eu-west:42:x");
+    CHECK(hconcat().empty());
+    CHECK(hconcat("", string()).empty());
+
+    // 整数的边界
+    CHECK(string_view(hconcat(0)) == "0");
+    CHECK(string_view(hconcat(-1, ' ', 9, ' ', 10, ' ', 99, ' ', 100)) == "-1 9 10 99 100");
+    CHECK(string_view(hconcat(INT64_MIN)) == to_string(INT64_MIN));
+    CHECK(string_view(hconcat(UINT64_MAX)) == to_string(UINT64_MAX));
+    CHECK(string_view(hconcat(short(-300), (unsigned char)7)) == "-3007");
+    for (uint64_t v = 1, i = 0; i < 20; ++i, v *= 10)
+    {
+        CHECK(string_view(hconcat(v - 1, '|', v)) == to_string(v - 1) + "|" + to_string(v));
+    }
+
+    // 按总长度一次选好存储方式，容量正好
+    auto const medium = hconcat(string(100, 'a'), '-', string(100, 'b'));
+    CHECK(medium.size() == 201 && medium.capacity() == slab_allocator::goodSize(202) - 1);
+    auto const large = hconcat(string(1000, 'a'), 12345);
+    CHECK(large.size() == 1005 && large.capacity() < 1005 + 32);
+    auto const local = hconcat<local_hstring>("local-", 1);
+    CHECK(string_view(local) == "local-1");
+
+    // join
+    vector<hstring> parts = {"a", "bb", "ccc"};
+    CHECK(string_view(hjoin(parts, ", ")) == "a, bb, ccc");
+    CHECK(string_view(hjoin(parts, '/')) == "a/bb/ccc");
+    CHECK(hjoin(vector<string>(), ",").empty());
+    list<int> ids = {1, -2, 300};
+    CHECK(string_view(hjoin(ids, ',')) == "1,-2,300");
+    vector<string> one = {string(500, 'z')};
+    auto const j = hjoin(one, "--");
+    CHECK(j.size() == 500 && j.capacity() < 500 + 32);
+
+    cout << "concat test passed" << endl;
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "../hconv.h"
+#include "../hconcat.h"
+#include "check.h"
+
+#include <iostream>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace fool;
+
+template <class F>
+static bool throws(F &&f)
+{
+    try
+    {
+        f();
+    }
+    catch (const exception &)
+    {
+        return true;
+    }
+    return false;
+}
+
+int main()
+{
+    // 整数
+    hstring s("v=");
+    append_int(s, 0);
+    append_int(s, -123);
+    CHECK(string_view(s) == "v=0-123");
+    CHECK(string_view(to_hstring(INT64_MIN)) == to_string(INT64_MIN));
+    CHECK(string_view(to_hstring(UINT64_MAX)) == to_string(UINT64_MAX));
+    for (uint64_t v = 1, i = 0; i < 20; ++i, v *= 10)
+    {
+        CHECK(string_view(to_hstring(v - 1)) == to_string(v - 1));
+        CHECK(string_view(to_hstring(v)) == to_string(v));
+    }
+    // 追加到中字符串和大字符串
+    hstring m(100, 'm');
+    append_int(m, 42);
+    CHECK(m.size() == 102 && m[100] == '4' && m[101] == '2');
+
+    // 浮点数，最短表示能原样读回来
+    CHECK(string_view(to_hstring(0.1)) == "0.1");
+    CHECK(string_view(to_hstring(-2.5)) == "-2.5");
+    CHECK(string_view(to_hstring(1e300)) == "1e+300");
+    const double values[] = {0.0, 1.0 / 3, 123456.789, 5e-324, 1.7976931348623157e308, -2.2250738585072014e-308};
+    for (double d : values)
+    {
+        auto const h = to_hstring(d);
+        CHECK(parse_double(h) == d);
+        CHECK(strtod(h.c_str(), nullptr) == d);
+    }
+    hstring big(200, 'x');
+    big.reserve(300);
+    auto const cap = big.capacity();
+    append_double(big, -2.2250738585072014e-308);
+    CHECK(string_view(big).substr(200) == "-2.2250738585072014e-308" && big.capacity() == cap);
+    hstring small("pi=");
+    append_double(small, 3.14);
+    CHECK(string_view(small) == "pi=3.14" && small.capacity() == 23);
+    CHECK(string_view(to_hstring(INFINITY)) == "inf");
+    CHECK(std::isnan(parse_double("nan")));
+
+    // 解析
+    CHECK(parse_int("12345") == 12345);
+    CHECK(parse_int<int>("-77") == -77);
+    CHECK(parse_int(to_hstring(INT64_MIN)) == INT64_MIN);
+    size_t used = 0;
+    CHECK(parse_int<unsigned>("42 rest", &used) == 42 && used == 2);
+    CHECK(parse_double("1.5e3xyz", &used) == 1500 && used == 5);
+    CHECK(throws([] { parse_int(""); }));
+    CHECK(throws([] { parse_int("12a"); }));
+    CHECK(throws([] { parse_int<uint8_t>("256"); }));
+    CHECK(throws([] { parse_int<unsigned>("-1"); }));
+    CHECK(throws([] { parse_double("1e999"); }));
+    CHECK(throws([] { parse_double("abc"); }));
+
+    // hconcat和append_int用同样的整数格式
+    CHECK(hconcat(-5, 10) == to_hstring(-510));
+
+    cout << "conv test passed" << endl;
+    return 0;
+}
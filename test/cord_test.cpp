@@ -0,0 +1,102 @@
+#include "../hcord.h"
+#include "check.h"
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace fool;
+
+static string flat(const hcord &c)
+{
+    string s;
+    c.forEachChunk([&](string_view v) { s.append(v.data(), v.size()); });
+    return s;
+}
+
+// 随机地在两头追加各种长度的片段，结果必须和std::string拼出来的一样
+int main()
+{
+    mt19937 rng(2024);
+    for (int round = 0; round < 200; ++round)
+    {
+        hcord c;
+        string expect;
+        for (int i = 0; i < 50; ++i)
+        {
+            size_t const len = rng() % 4 == 0 ? 300 + rng() % 5000 : rng() % 200;
+            string piece(len, char('a' + rng() % 26));
+            if (rng() % 3 == 0)
+            {
+                c.prepend(hstring(piece.data(), piece.size()));
+                expect.insert(0, piece);
+            }
+            else if (rng() % 2 == 0)
+            {
+                c.append(hstring(piece.data(), piece.size()));
+                expect.append(piece);
+            }
+            else
+            {
+                c.append(piece);
+                expect.append(piece);
+            }
+            CHECK(c.size() == expect.size());
+        }
+        CHECK(flat(c) == expect);
+        for (auto &chunk : c)
+        {
+            CHECK(!chunk.empty());
+        }
+        auto const s = c.toString();
+        CHECK(string(s.data(), s.size()) == expect);
+    }
+
+    // 大字符串追加只增加引用计数，块和原字符串共享内存
+    hstring big(10000, 'b');
+    hcord c;
+    c.append("head:");
+    c.append(big);
+    c.append(big);
+    c.prepend(big);
+    CHECK(c.size() == 30005 && c.chunkCount() == 4);
+    size_t shared = 0;
+    for (auto &chunk : c)
+    {
+        shared += as_const(chunk).data() == as_const(big).data();
+    }
+    CHECK(shared == 3);
+
+    // 短片段合并进相邻的块，块数不会跟着片段数涨
+    hcord small;
+    for (int i = 0; i < 1000; ++i)
+    {
+        small.append("0123456789");
+    }
+    CHECK(small.size() == 10000 && small.chunkCount() < 10);
+
+    // iovec
+    struct iovec iov[2];
+    CHECK(c.fillIovec(iov, 2) == 2 && iov[0].iov_len == 10000 && iov[1].iov_len == 5);
+    CHECK(c.fillIovec(iov, 2, 3) == 1 && iov[0].iov_base == as_const(big).data());
+
+    // 拼接cord，包括自己拼自己
+    hcord twice = c;
+    twice.append(twice);
+    CHECK(twice.size() == 2 * c.size() && flat(twice) == flat(c) + flat(c));
+    twice.prepend(c);
+    CHECK(flat(twice) == flat(c) + flat(c) + flat(c));
+
+    // flatten之后只剩一块，再调用不拷贝
+    auto const expect = flat(c);
+    auto const &f = c.flatten();
+    CHECK(c.chunkCount() == 1 && string(f.data(), f.size()) == expect);
+    CHECK(&c.flatten() == &f);
+    CHECK(hcord().flatten().empty());
+
+    cout << "cord_test passed" << endl;
+    return 0;
+}
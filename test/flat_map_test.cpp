@@ -0,0 +1,151 @@
+#include "../hflat_map.h"
+#include "check.h"
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+using namespace fool;
+
+static hstring makeKey(mt19937 &rng)
+{
+    // 小、中、大三种长度的键都有
+    static const size_t kLens[] = {0, 3, 16, 23, 24, 60, 254, 255, 400};
+    auto const len = kLens[rng() % 9];
+    hstring s(len, 'k');
+    auto const id = to_string(rng() % 3000);
+    s.append(id);
+    return s;
+}
+
+int main()
+{
+    // hash()和std::hash<string_view>一致，修改之后缓存作废
+    {
+        hstring big(500, 'h');
+        auto const h0 = big.hash();
+        CHECK(h0 == std::hash<string_view>()(big));
+        hstring const copy = big;
+        CHECK(copy.hash() == h0);
+        big.append("!");
+        CHECK(big.hash() == std::hash<string_view>()(big) && big.hash() != h0);
+        CHECK(copy.hash() == h0);
+        big[0] = 'x';
+        CHECK(big.hash() == std::hash<string_view>()(big));
+        big.resize(300);
+        CHECK(big.hash() == std::hash<string_view>()(big));
+        big.assign(string(400, 'y').data(), 400);
+        CHECK(big.hash() == std::hash<string_view>()(big));
+        big.reserve(4000);
+        CHECK(big.hash() == std::hash<string_view>()(big));
+        auto const slice = big.substr(10, 200);
+        CHECK(slice.hash() == std::hash<string_view>()(slice));
+        hstring small("short");
+        CHECK(small.hash() == std::hash<string_view>()("short") && std::hash<hstring>()(small) == small.hash());
+    }
+
+    // 随机操作，和std::unordered_map对比
+    mt19937 rng(99);
+    flat_hstring_map<int> m;
+    unordered_map<string, int> ref;
+    for (int round = 0; round < 200000; ++round)
+    {
+        auto const key = makeKey(rng);
+        string const skey(key);
+        switch (rng() % 6)
+        {
+        case 0:
+        case 1:
+        {
+            auto const v = int(rng());
+            auto const r = m.try_emplace(key, v);
+            auto const e = ref.emplace(skey, v);
+            CHECK(r.second == e.second && r.first->second == e.first->second);
+            break;
+        }
+        case 2:
+        {
+            // string_view插入
+            auto const r = m.insert_or_assign(string_view(skey), round);
+            ref[skey] = round;
+            CHECK(r.first->second == round);
+            break;
+        }
+        case 3:
+            CHECK(m.erase(string_view(skey)) == ref.erase(skey));
+            break;
+        default:
+        {
+            auto const it = m.find(key);
+            auto const e = ref.find(skey);
+            CHECK((it == m.end()) == (e == ref.end()));
+            CHECK(it == m.end() || it->second == e->second);
+            CHECK(m.contains(skey) == (e != ref.end()));
+            break;
+        }
+        }
+        CHECK(m.size() == ref.size());
+    }
+    size_t n = 0;
+    for (auto const &kv : m)
+    {
+        CHECK(ref.at(string(kv.first)) == kv.second);
+        ++n;
+    }
+    CHECK(n == ref.size());
+
+    // 遍历时删除
+    for (auto it = m.begin(); it != m.end();)
+    {
+        if (it->second % 2 == 0)
+        {
+            ref.erase(string(it->first));
+            it = m.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    CHECK(m.size() == ref.size());
+
+    // 拷贝、移动、operator[]、at
+    auto copy = m;
+    CHECK(copy.size() == m.size());
+    for (auto const &kv : ref)
+    {
+        CHECK(copy.at(kv.first) == kv.second);
+    }
+    auto moved = std::move(copy);
+    CHECK(moved.size() == m.size() && copy.empty());
+    moved["new key"] += 5;
+    CHECK(moved.at("new key") == 5);
+    bool threw = false;
+    try
+    {
+        m.at("missing");
+    }
+    catch (const out_of_range &)
+    {
+        threw = true;
+    }
+    CHECK(threw);
+    m.clear();
+    CHECK(m.empty() && m.begin() == m.end() && !m.contains("k1"));
+
+    // 大字符串的键：插入时算过的哈希值缓存在共享的内存里，拷贝拿来查找不用再算
+    flat_hstring_map<size_t> big;
+    big.reserve(100);
+    CHECK(big.capacity() >= 100 && big.capacity() * 7 / 8 >= 100);
+    hstring const url = hstring(300, 'u') + hstring("/path");
+    big.try_emplace(url, 1);
+    hstring const sameBuffer = url;
+    CHECK(big.find(sameBuffer) != big.end() && big.find(string_view(url))->second == 1);
+    // 值在别的内存里的相同内容也能找到
+    CHECK(big.find(hstring(string_view(url))) != big.end());
+
+    cout << "flat_map test passed" << endl;
+    return 0;
+}
@@ -0,0 +1,366 @@
+#include "../hstring.h"
+#include "check.h"
+
+#include <iostream>
+#include <cstring>
+#include <string>
+#include <list>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace fool;
+
+// 每个操作都和std::string做一遍，结果必须一致
+template <class S>
+static void check(const S &hs, const string &ss)
+{
+    CHECK(hs.size() == ss.size());
+    CHECK(memcmp(hs.data(), ss.data(), ss.size()) == 0);
+    CHECK(hs.c_str()[hs.size()] == '\0');
+}
+
+// 三种长度都要覆盖到：小、中、大
+template <class S>
+static void run()
+{
+    const size_t lens[] = {0, 5, 23, 24, 100, 254, 255, 1000};
+    for (size_t len : lens)
+    {
+        string ss(len, 'x');
+        for (size_t i = 0; i < len; ++i)
+        {
+            ss[i] = char('a' + i % 26);
+        }
+        S hs(ss.data(), ss.size());
+        check(hs, ss);
+
+        // 拷贝之后修改，不能影响原来的字符串
+        S copy(hs);
+        copy.append("tail");
+        check(hs, ss);
+        check(copy, ss + "tail");
+
+        hs.append(hs);
+        ss.append(ss);
+        check(hs, ss);
+
+        hs.insert(0, "head");
+        ss.insert(0, "head");
+        check(hs, ss);
+
+        hs.insert(hs.size() / 2, hs.c_str() + 1, 3);
+        ss.insert(ss.size() / 2, ss.c_str() + 1, 3);
+        check(hs, ss);
+
+        hs.replace(2, 5, "replacement-that-is-long");
+        ss.replace(2, 5, "replacement-that-is-long");
+        check(hs, ss);
+
+        hs.replace(1, 10, "ab");
+        ss.replace(1, 10, "ab");
+        check(hs, ss);
+
+        hs.erase(3, 4);
+        ss.erase(3, 4);
+        check(hs, ss);
+
+        hs.erase(hs.size() / 2);
+        ss.erase(ss.size() / 2);
+        check(hs, ss);
+
+        S sub = hs.substr(1, 7);
+        check(sub, ss.substr(1, 7));
+
+        hs += 'z';
+        ss += 'z';
+        check(hs, ss);
+
+        hs.resize(len + 30, '-');
+        ss.resize(len + 30, '-');
+        check(hs, ss);
+
+        hs.assign(hs.data() + 2, 5);
+        ss.assign(ss.data() + 2, 5);
+        check(hs, ss);
+
+        // 赋值复用空间
+        S target(300, 'q');
+        target = copy;
+        check(target, string(copy.data(), copy.size()));
+        CHECK(target == copy);
+    }
+}
+
+// 大字符串的子串是切片，不拷贝数据
+template <class S>
+static void slices()
+{
+    string body(100000, 'x');
+    for (size_t i = 0; i < body.size(); ++i)
+    {
+        body[i] = char('a' + i % 26);
+    }
+    const S *whole = new S(body.data(), body.size());
+    const char *base = whole->data();
+
+    // 切到结尾的切片后面就是\0，和原字符串共享内存，切片的切片也一样
+    S suffix = whole->substr(90000);
+    CHECK(as_const(suffix).data() == base + 90000 && suffix.isSlice());
+    CHECK(as_const(suffix).c_str() == base + 90000);
+    S tail(suffix, 9000);
+    CHECK(as_const(tail).data() == base + 99000 && tail.isSlice());
+    CHECK(suffix.capacity() == suffix.size());
+    check(tail, body.substr(99000));
+    // 短的子串放进自己的空间里
+    S tiny = whole->substr(10, 20);
+    CHECK(as_const(tiny).data() != base + 10 && !tiny.isSlice());
+    check(tiny, body.substr(10, 20));
+
+    // 中间的子串后面不是\0，原字符串还在用，只能复制；通过const引用取c_str()照样是C字符串
+    S middle = whole->substr(2000, 1000);
+    CHECK(as_const(middle).data() != base + 2000 && !middle.isSlice());
+    auto const cstr = [](const S &str) { return str.c_str(); };
+    CHECK(strlen(cstr(middle)) == 1000 && memcmp(cstr(middle), body.data() + 2000, 1000) == 0);
+    S inner(suffix, 100, 300);
+    CHECK(!inner.isSlice() && strlen(cstr(inner)) == 300);
+    check(inner, body.substr(90100, 300));
+    check(*whole, body);
+
+    // 修改切片会复制出自己的一份，原字符串不变
+    S edited(suffix);
+    edited[0] = '#';
+    CHECK(as_const(edited).data() != base + 90000 && !edited.isSlice());
+    check(*whole, body);
+    edited.append(suffix);
+    check(edited, "#" + body.substr(90001) + body.substr(90000));
+
+    // 共享的大字符串缩短，新的结尾后面不是\0，复制
+    S shrunk(*whole);
+    shrunk.resize(50000);
+    CHECK(as_const(shrunk).data() != base && !shrunk.isSlice());
+    check(shrunk, body.substr(0, 50000));
+    S appended(shrunk);
+    appended += "end";
+    check(appended, body.substr(0, 50000) + "end");
+    check(*whole, body);
+
+    // 原字符串先析构，切片还持有整块内存；只剩自己持有时原地写\0，中间的子串也是切片
+    delete whole;
+    tail = S();
+    S last = std::move(suffix).substr(100, 250);
+    CHECK(as_const(last).data() == base + 90100 && last.isSlice());
+    CHECK(cstr(last) == base + 90100);
+    check(last, body.substr(90100, 250));
+    // 共享的切片缩短要复制，独占的切片原地缩短
+    S sharedLast(last);
+    sharedLast.resize(200);
+    CHECK(as_const(sharedLast).data() != base + 90100);
+    check(sharedLast, body.substr(90100, 200));
+    last.resize(240);
+    // 自动收缩的存储在这里已经复制出了自己的一份
+    CHECK(cstr(last) == as_const(last).data() && (!last.isSlice() || as_const(last).data() == base + 90100));
+    check(last, body.substr(90100, 240));
+    auto const lastData = as_const(last).data();
+    S moved = std::move(last).substr(50, 100);
+    CHECK(as_const(moved).data() == lastData + 50 || !moved.isSlice());
+    check(moved, body.substr(90150, 100));
+}
+
+int main()
+{
+    run<hstring>();
+    run<basic_hstring<char, basic_hstring_core<malloc_allocator>>>();
+    run<local_hstring>();
+    slices<hstring>();
+    slices<local_hstring>();
+    run<deferred_hstring>();
+    slices<deferred_hstring>();
+    // pmr资源必须在使用它的字符串全部析构之后才能销毁
+    std::pmr::unsynchronized_pool_resource pool;
+    pmr_allocator<>::setResource(&pool);
+    run<basic_hstring<char, basic_hstring_core<pmr_allocator<>>>>();
+    slices<basic_hstring<char, basic_hstring_core<pmr_allocator<>>>>();
+    pmr_allocator<>::setResource(nullptr);
+
+    // 换了分界的存储，行为不变，只是共享的范围不同
+    typedef basic_hstring<char, basic_hstring_core<slab_allocator, atomic_refcount, nocow_hstring_traits>> nocow_hstring;
+    typedef basic_hstring<char, basic_hstring_core<slab_allocator, atomic_refcount, wide_medium_hstring_traits>> wide_hstring;
+    run<nocow_hstring>();
+    run<wide_hstring>();
+    {
+        nocow_hstring n(100000, 'n');
+        nocow_hstring copy(n);
+        CHECK(!n.isShared() && as_const(copy).data() != as_const(n).data());
+        wide_hstring w(600, 'w'), w2(w);
+        CHECK(!w.isShared() && as_const(w2).data() != as_const(w).data());
+        wide_hstring wl(2000, 'w'), wl2(wl);
+        CHECK(wl.isShared() && as_const(wl2).data() == as_const(wl).data());
+    }
+
+    // 容量按分配器实际给出的大小计算，不会超出malloc_usable_size
+    for (size_t n : {24, 30, 100, 200, 254})
+    {
+        basic_hstring<char, basic_hstring_core<malloc_allocator>> m(n, 'm');
+        CHECK(m.capacity() + 1 == goodMallocSize(n + 1));
+        CHECK(mallocUsableSize(const_cast<char *>(m.data())) >= m.capacity() + 1);
+        hstring h(n, 'h');
+        CHECK(h.capacity() + 1 == slab_allocator::goodSize(n + 1));
+    }
+    for (size_t n : {255, 1000, 5000})
+    {
+        hstring h(n, 'h');
+        CHECK(h.capacity() >= n && h.capacity() < n + 32);
+    }
+
+    // 共享的大字符串，修改只会脱离一次共享
+    hstring large(1000, 'a');
+    hstring shared(large);
+    shared.append(10, 'b');
+    CHECK(large.size() == 1000 && shared.size() == 1010);
+    CHECK(large.data() != shared.data());
+
+    // 非原子的引用计数，共享和脱离共享的行为不变
+    local_hstring localLarge(1000, 'a');
+    {
+        local_hstring c1(localLarge), c2(c1);
+        CHECK(c1.c_str() == localLarge.c_str() && c2.c_str() == localLarge.c_str());
+        c2[0] = 'b';
+        CHECK(c2.c_str() != localLarge.c_str() && c1.c_str() == localLarge.c_str());
+        CHECK(localLarge[0] == 'a' && c1[0] == 'a' && c2[0] == 'b');
+    }
+    CHECK(localLarge.capacity() >= 1000);
+
+    // 赋值复用现有的空间，大字符串的来源继续共享
+    {
+        hstring m(200, 'm');
+        auto const buf = as_const(m).data();
+        const hstring x(100, 'x');
+        m = x;
+        CHECK(as_const(m).data() == buf && string_view(m) == string(100, 'x'));
+        hstring src(150, 'y');
+        m = src;
+        CHECK(as_const(m).data() == buf && string_view(m) == string(150, 'y'));
+        m.assign("short", 5);
+        CHECK(as_const(m).data() == buf && m == "short");
+        m.assign(m.c_str() + 1, 3);
+        CHECK(m == "hor");
+        m = m;
+        CHECK(m == "hor");
+        hstring big(1000, 'b');
+        m = big;
+        CHECK(as_const(m).data() == as_const(big).data() && big.isShared());
+        // 共享的不能原地写
+        m.assign("abc", 3);
+        CHECK(m == "abc" && string_view(big) == string(1000, 'b'));
+        m = std::move(big);
+        CHECK(m.size() == 1000 && big.empty());
+        hstring s("small");
+        s = hstring(30, 'z');
+        CHECK(s.capacity() >= 30);
+        CHECK(string_view(s) == string(30, 'z'));
+        s.assign(s.c_str() + 5, 20);
+        CHECK(string_view(s) == string(20, 'z'));
+    }
+
+    // shrink_to_fit：按长度降级，共享的大字符串不复制
+    {
+        hstring s("tiny");
+        s.shrink_to_fit();
+        CHECK(s == "tiny" && s.capacity() == 23);
+        hstring m(200, 'm');
+        m.resize(10);
+        m.shrink_to_fit();
+        CHECK(string_view(m) == string(10, 'm') && m.capacity() == 23);
+        hstring r(100, 'r');
+        r.reserve(240);
+        r.shrink_to_fit();
+        CHECK(string_view(r) == string(100, 'r') && r.capacity() + 1 == slab_allocator::goodSize(101));
+        hstring l(5000, 'l');
+        l.resize(100);
+        l.shrink_to_fit();
+        CHECK(string_view(l) == string(100, 'l') && r.capacity() == l.capacity() && !l.isShared());
+        hstring big(5000, 'b');
+        big.reserve(20000);
+        auto const h = big.hash();
+        big.shrink_to_fit();
+        CHECK(big.capacity() < 5100 && big.hash() == h && string_view(big) == string(5000, 'b'));
+        auto const p = as_const(big).data();
+        big.shrink_to_fit();
+        CHECK(as_const(big).data() == p);
+
+        hstring copy(big);
+        copy.shrink_to_fit();
+        CHECK(as_const(copy).data() == p && copy.isShared());
+        hstring slice = big.substr(4700);
+        slice.shrink_to_fit();
+        CHECK(slice.isSlice() && as_const(slice).data() == p + 4700);
+        // 整块内存只剩切片自己在用，复制出来以后整块释放
+        big = hstring();
+        copy = hstring();
+        slice.shrink_to_fit();
+        CHECK(!slice.isSlice() && string_view(slice) == string(300, 'b') && slice.capacity() < 320);
+
+        vector<hstring> cache = {hstring("k"), hstring(100, 'x'), hstring(5000, 'y'), hstring(3000, 'z')};
+        cache[1].resize(5);
+        cache[2].resize(50);
+        CHECK(compact(cache) == 2);
+        CHECK(cache[1] == "xxxxx" && cache[1].capacity() == 23 && cache[2] == hstring(50, 'y'));
+        CHECK(compact(cache) == 0);
+    }
+
+    // 自动收缩：缩短到占用空间的1/4以下时重新分配
+    {
+        typedef basic_hstring<char, basic_hstring_core<slab_allocator, atomic_refcount, compacting_hstring_traits>> compact_hstring;
+        run<compact_hstring>();
+        slices<compact_hstring>();
+        compact_hstring s(10000, 'c');
+        s.resize(3000);
+        CHECK(s.capacity() >= 10000);
+        s.resize(2000);
+        CHECK(s.capacity() < 2100 && string_view(s) == string(2000, 'c'));
+        while (!s.empty())
+        {
+            s.pop_back();
+        }
+        CHECK(s.capacity() == 23);
+        compact_hstring m(250, 'm');
+        m.assign("0123456789", 10);
+        CHECK(m == "0123456789" && m.capacity() == 23);
+        compact_hstring n(250, 'n');
+        m = n;
+        m.assign(100, 'a');
+        CHECK(m.capacity() + 1 == slab_allocator::goodSize(101));
+        // 共享的缩短时复制出自己的一份，原字符串不动
+        compact_hstring shared(10000, 's'), other(shared);
+        other.resize(100);
+        CHECK(!other.isShared() && other == compact_hstring(100, 's') && shared.size() == 10000);
+    }
+
+    // 迭代器和比较
+    hstring a("abc"), b("abd");
+    CHECK(a < b && b > a && a != b && a == "abc" && "abc" == a);
+    CHECK(a.compare(b) < 0);
+    list<char> l = {'x', 'y'};
+    a.insert(a.begin() + 1, l.begin(), l.end());
+    CHECK(a == "axybc");
+    a.erase(a.begin(), a.begin() + 2);
+    CHECK(a == "ybc");
+    hstring c = a + "-" + b;
+    CHECK(c == "ybc-abd");
+    CHECK(std::hash<hstring>()(c) == std::hash<string_view>()("ybc-abd"));
+
+    bool thrown = false;
+    try
+    {
+        a.substr(100);
+    }
+    catch (const out_of_range &)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    cout << "htest passed" << endl;
+    return 0;
+}
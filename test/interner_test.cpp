@@ -0,0 +1,91 @@
+#include "../hinterner.h"
+#include "check.h"
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace fool;
+
+static string token(size_t i)
+{
+    return "tenant-" + to_string(i) + "-" + string(30, char('a' + i % 26));
+}
+
+int main()
+{
+    hstring_interner pool;
+
+    // 同一个值返回同一份内存，中字符串也是共享的
+    auto const a = pool.intern(token(1));
+    auto const b = pool.intern(string_view(token(1)));
+    CHECK(string_view(a) == token(1) && a.data() == b.data() && a.isShared());
+    auto const c = pool.intern(token(2));
+    CHECK(c.data() != a.data());
+    // 拷贝出来的值修改不影响池子
+    hstring d(b);
+    d[0] = 'T';
+    CHECK(string_view(pool.intern(token(1))) == token(1));
+
+    // 小字符串不进池子
+    auto const small = pool.intern("GET");
+    CHECK(small == "GET" && !pool.contains("GET"));
+    // 分界就是小字符串的长度
+    {
+        hstring_interner edgePool;
+        const string edge(hstring::inline_capacity, 'e');
+        edgePool.intern(edge);
+        edgePool.intern(edge + "e");
+        CHECK(!edgePool.contains(edge) && edgePool.contains(edge + "e"));
+    }
+    CHECK(pool.contains(token(1)) && !pool.contains(token(3)));
+
+    auto s = pool.stats();
+    CHECK(s.entries == 2 && s.lookups == 4 && s.hits == 2);
+    CHECK(s.bytesSaved == 2 * token(1).size() && s.bytes == token(1).size() + token(2).size());
+
+    // 多线程同时驻留同一批值，每个值最后只有一份
+    pool.clear();
+    constexpr size_t kValues = 500;
+    constexpr int kThreads = 4;
+    vector<vector<hstring>> results(kThreads);
+    vector<thread> threads;
+    for (int t = 0; t < kThreads; ++t)
+    {
+        threads.emplace_back([&, t] {
+            for (int round = 0; round < 10; ++round)
+            {
+                for (size_t i = 0; i < kValues; ++i)
+                {
+                    results[t].push_back(pool.intern(token((i * 7 + t) % kValues)));
+                }
+            }
+        });
+    }
+    for (auto &th : threads)
+    {
+        th.join();
+    }
+    CHECK(pool.size() == kValues);
+    for (int t = 0; t < kThreads; ++t)
+    {
+        for (auto &v : results[t])
+        {
+            auto const canonical = pool.intern(string_view(v));
+            CHECK(as_const(v).data() == canonical.data());
+        }
+    }
+    s = pool.stats();
+    CHECK(s.entries == kValues && s.hits + kValues == s.lookups);
+
+    // 外面还有人持有时不会被释放
+    CHECK(pool.purge() == 0);
+    results.clear();
+    CHECK(pool.purge() == kValues && pool.size() == 0 && pool.stats().bytes == 0);
+
+    cout << "interner_test passed" << endl;
+    return 0;
+}
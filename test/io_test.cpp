@@ -0,0 +1,166 @@
+#include "../hio.h"
+#include "check.h"
+
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace fool;
+
+static string makeContent(size_t len)
+{
+    string s(len, 'x');
+    for (size_t i = 0; i < len; ++i)
+    {
+        s[i] = i % 61 == 60 ? '\n' : char('a' + i % 26);
+    }
+    return s;
+}
+
+static string writeTemp(const string &content)
+{
+    char path[] = "/tmp/hio_testXXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    auto const written = write(fd, content.data(), content.size());
+    CHECK(written == ssize_t(content.size()));
+    close(fd);
+    return path;
+}
+
+int main()
+{
+    // readAll：有没有长度提示结果都一样，给了准确的长度时容量不会多出一轮增长
+    for (size_t len : {0, 10, 200, 5000, 100000, 1000000})
+    {
+        auto const content = makeContent(len);
+        auto const path = writeTemp(content);
+        for (size_t hint : {size_t(0), len})
+        {
+            int fd = open(path.c_str(), O_RDONLY);
+            hstring s("prefix:");
+            auto const got = hio::readAll(fd, s, hint);
+            close(fd);
+            CHECK(got == len && s.size() == 7 + len);
+            CHECK(string_view(s).substr(7) == content);
+            CHECK(s.c_str()[s.size()] == '\0');
+            if (hint > 0 && len > 254)
+            {
+                CHECK(s.capacity() < (7 + len) * 5 / 4);
+            }
+        }
+
+        // getline和按\n切分的结果一致，缓冲区比行短也可以
+        for (size_t bufferSize : {7, 64 * 1024})
+        {
+            int fd = open(path.c_str(), O_RDONLY);
+            hio::LineReader<hstring> reader(fd, bufferSize);
+            hstring line;
+            size_t pos = 0;
+            while (reader.getline(line))
+            {
+                auto const nl = content.find('\n', pos);
+                auto const expect = content.substr(pos, nl == string::npos ? string::npos : nl - pos);
+                CHECK(string_view(line) == expect);
+                pos = nl == string::npos ? content.size() : nl + 1;
+            }
+            CHECK(pos == content.size());
+            auto const more = reader.getline(line);
+            CHECK(!more);
+            close(fd);
+        }
+        unlink(path.c_str());
+    }
+
+    // 空行和没有\n结尾的最后一行
+    {
+        int fds[2];
+        auto const piped = pipe(fds);
+        CHECK(piped == 0);
+        auto const written = write(fds[1], "a\n\nlast", 7);
+        CHECK(written == 7);
+        close(fds[1]);
+        hio::LineReader<hstring> reader(fds[0]);
+        hstring line;
+        auto got = reader.getline(line);
+        CHECK(got && line == "a");
+        got = reader.getline(line);
+        CHECK(got && line.empty());
+        got = reader.getline(line);
+        CHECK(got && line == "last");
+        got = reader.getline(line);
+        CHECK(!got);
+        close(fds[0]);
+    }
+
+    // readAppend把没用上的尾巴截掉
+    {
+        int fds[2];
+        auto const piped = pipe(fds);
+        CHECK(piped == 0);
+        auto const written = write(fds[1], "hello", 5);
+        CHECK(written == 5);
+        hstring s;
+        auto got = hio::readAppend(fds[0], s, 1000);
+        CHECK(got == 5 && s == "hello");
+        close(fds[1]);
+        got = hio::readAppend(fds[0], s, 1000);
+        CHECK(got == 0 && s == "hello");
+        close(fds[0]);
+    }
+
+    // readAll读管道里的一小段：先读进栈上的小缓冲区，确认结束以后不会为它扩容
+    {
+        int fds[2];
+        auto const piped = pipe(fds);
+        CHECK(piped == 0);
+        auto const written = write(fds[1], "hello", 5);
+        CHECK(written == 5);
+        close(fds[1]);
+        hstring s;
+        auto const got = hio::readAll(fds[0], s);
+        CHECK(got == 5 && s == "hello" && s.capacity() == hstring::inline_capacity);
+        close(fds[0]);
+    }
+
+    // writeAll：多于一批的字符串，写出来和拼起来的一样，大字符串仍然共享
+    {
+        vector<hstring> parts;
+        string expect;
+        hstring shared(1000, 's');
+        for (size_t i = 0; i < 3000; ++i)
+        {
+            parts.push_back(i % 100 == 0 ? shared : hstring(i % 50, char('a' + i % 26)));
+            expect.append(string_view(parts.back()));
+        }
+        auto const path = writeTemp("");
+        int fd = open(path.c_str(), O_WRONLY | O_TRUNC);
+        hio::writeAll(fd, parts.begin(), parts.end());
+        close(fd);
+        CHECK(parts[0].isShared());
+        fd = open(path.c_str(), O_RDONLY);
+        hstring back;
+        hio::readAll(fd, back);
+        close(fd);
+        CHECK(string_view(back) == expect);
+        unlink(path.c_str());
+    }
+
+    bool thrown = false;
+    try
+    {
+        hstring s;
+        hio::readAll(-1, s);
+    }
+    catch (const system_error &)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    cout << "io test passed" << endl;
+    return 0;
+}
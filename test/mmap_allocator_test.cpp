@@ -0,0 +1,148 @@
+#include "../hstring.h"
+#include "check.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <vector>
+
+using namespace std;
+using namespace fool;
+
+// 阈值调小到64KB，不用真的分配几百MB就能走到每一条路径
+typedef mmap_allocator<slab_allocator, 64 * 1024> small_mmap_allocator;
+typedef mmap_allocator<slab_allocator, 64 * 1024, true> huge_mmap_allocator;
+typedef basic_hstring<char, basic_hstring_core<small_mmap_allocator>> test_hstring;
+typedef basic_hstring<char, basic_hstring_core<huge_mmap_allocator>> huge_hstring;
+// 没有写时复制时中字符串也会越过阈值，走的是中字符串的reallocate
+typedef basic_hstring<char, basic_hstring_core<small_mmap_allocator, atomic_refcount, nocow_hstring_traits>> nocow_test_hstring;
+
+static bool isMapped(const void *p)
+{
+    unsigned char vec;
+    auto const page = reinterpret_cast<uintptr_t>(p) & ~uintptr_t(hmmap::pageSize() - 1);
+    return mincore(reinterpret_cast<void *>(page), 1, &vec) == 0;
+}
+
+static string pattern(size_t n)
+{
+    string s(n, '\0');
+    for (size_t i = 0; i < n; ++i)
+    {
+        s[i] = char('a' + i * 7 % 26);
+    }
+    return s;
+}
+
+template <class Alloc>
+static void allocatorPaths(size_t granule)
+{
+    // 阈值以下交给slab
+    CHECK(Alloc::goodSize(100) == slab_allocator::goodSize(100));
+    CHECK(Alloc::goodSize(64 * 1024) % granule == 0 && Alloc::goodSize(64 * 1024) >= 64 * 1024);
+
+    // 阈值以上按页（或大页）对齐，扩容时内容不变，释放以后不再映射
+    auto const cap = Alloc::goodSize(100 * 1024);
+    auto p = static_cast<char *>(Alloc::allocate(cap));
+    CHECK(reinterpret_cast<uintptr_t>(p) % granule == 0);
+    memset(p, 'x', 100 * 1024);
+    auto const newCap = Alloc::goodSize(8 << 20);
+    p = static_cast<char *>(Alloc::reallocate(p, 100 * 1024, cap, newCap));
+    CHECK(reinterpret_cast<uintptr_t>(p) % granule == 0);
+    for (size_t i = 0; i < 100 * 1024; i += 4096)
+    {
+        CHECK(p[i] == 'x');
+    }
+    p[newCap - 1] = 'y';
+    Alloc::deallocate(p, newCap);
+    CHECK(!isMapped(p));
+
+    // 后面的地址被占用，mremap只能换地址：换过去以后照样按页（或大页）对齐
+    p = static_cast<char *>(Alloc::allocate(cap));
+    memset(p, 'w', cap);
+    auto const blocker = mmap(p + cap, hmmap::pageSize(), PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    // 已经被别的映射占着也一样
+    auto const blocked = blocker == p + cap;
+    CHECK(blocked || (blocker == MAP_FAILED && errno == EEXIST));
+    auto const moved = static_cast<char *>(Alloc::reallocate(p, cap, cap, newCap));
+    CHECK(moved != p && reinterpret_cast<uintptr_t>(moved) % granule == 0);
+    CHECK(moved[0] == 'w' && moved[cap - 1] == 'w');
+    moved[newCap - 1] = 'y';
+    if (blocked)
+    {
+        munmap(blocker, hmmap::pageSize());
+    }
+    Alloc::deallocate(moved, newCap);
+
+    // 从阈值以下越过阈值：拷贝用到的部分，搬进映射
+    auto q = static_cast<char *>(Alloc::allocate(1000));
+    memset(q, 'z', 1000);
+    q = static_cast<char *>(Alloc::reallocate(q, 1000, 1000, cap));
+    CHECK(reinterpret_cast<uintptr_t>(q) % granule == 0 && q[0] == 'z' && q[999] == 'z');
+    Alloc::deallocate(q, cap);
+}
+
+template <class S>
+static void growAndShare()
+{
+    auto const expect = pattern(20 << 20);
+    // 一路append到20MB：中字符串 -> 大字符串 -> 越过阈值 -> 多次mremap
+    S s;
+    for (size_t i = 0; i < expect.size(); i += 1000)
+    {
+        s.append(expect.data() + i, min<size_t>(1000, expect.size() - i));
+    }
+    CHECK(s.size() == expect.size() && string_view(as_const(s).data(), s.size()) == expect);
+    CHECK(as_const(s).c_str()[s.size()] == '\0');
+
+    // 共享和切片照常工作，最后一个引用释放时munmap
+    {
+        S c(s);
+        S tail = s.substr(s.size() - 5000);
+        CHECK(c == s);
+        c[0] = '#';
+        CHECK(s[0] == expect[0] && c[0] == '#');
+        CHECK(string_view(as_const(tail).data(), tail.size()) == string_view(expect).substr(expect.size() - 5000));
+    }
+
+    // 缩回阈值以下再shrink_to_fit，回到slab/malloc
+    auto const data = as_const(s).data();
+    s.resize(1000);
+    s.shrink_to_fit();
+    CHECK(as_const(s).data() != data && !isMapped(data));
+    CHECK(string_view(as_const(s).data(), s.size()) == string_view(expect).substr(0, 1000));
+
+    // 直接reserve到很大，再缩短：大字符串变成同一块映射上的切片
+    S r;
+    r.reserve(3 << 20);
+    r.assign(expect.data(), 2 << 20);
+    r.resize(100);
+    CHECK(string_view(as_const(r).data(), r.size()) == string_view(expect).substr(0, 100));
+
+    vector<S> v;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        v.emplace_back(expect.data(), (i + 1) * 100000);
+    }
+    for (size_t i = 0; i < 8; ++i)
+    {
+        v[i].append(v[i]);
+        CHECK(v[i].size() == (i + 1) * 200000);
+        CHECK(string_view(as_const(v[i]).data() + (i + 1) * 100000, 100) == string_view(expect).substr(0, 100));
+    }
+}
+
+int main()
+{
+    allocatorPaths<small_mmap_allocator>(hmmap::pageSize());
+    allocatorPaths<huge_mmap_allocator>(hmmap::kHugePageSize);
+    growAndShare<test_hstring>();
+    growAndShare<huge_hstring>();
+    growAndShare<nocow_test_hstring>();
+    growAndShare<mmap_hstring>();
+
+    cout << "mmap_allocator_test passed" << endl;
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include "../hstring.h"
+#include "../hmmap.h"
+#include "check.h"
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+using namespace fool;
+
+static string writeTemp(const string &content)
+{
+    char path[] = "/tmp/hmmap_testXXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    auto const written = write(fd, content.data(), content.size());
+    CHECK(written == ssize_t(content.size()));
+    close(fd);
+    return path;
+}
+
+static string makeContent(size_t len)
+{
+    string s(len, 'x');
+    for (size_t i = 0; i < len; ++i)
+    {
+        s[i] = char('a' + i % 26);
+    }
+    return s;
+}
+
+// 各种长度都要和直接读出来的内容一致：读进来的小文件、刚过映射门槛的、不满一页的、正好整页的
+int main()
+{
+    auto const page = hmmap::pageSize();
+    const size_t lens[] = {0, 10, 200, 255, 1000, page, 3 * page, 64 * page, 64 * page + 1, 100 * page, 100 * page + 10};
+    for (size_t len : lens)
+    {
+        auto const content = makeContent(len);
+        auto const path = writeTemp(content);
+        {
+            auto const s = hstring::mapFile(path.c_str());
+            CHECK(s.size() == len && string(s.data(), s.size()) == content);
+            CHECK(s.c_str()[len] == '\0');
+            // 不超过64页的读进来，更大的映射成切片
+            CHECK(s.isSlice() == (len > 64 * page));
+            if (len > 254)
+            {
+                // 大字符串的c_str()不会复制，映射出来的后面也有\0
+                CHECK(s.c_str() == s.data());
+            }
+
+            // 拷贝和切片都共享映射
+            hstring copy(s);
+            CHECK((as_const(copy).data() == s.data()) == (len > 254));
+            hstring sub = s.substr(len / 4, len / 2);
+            CHECK(string(sub.data(), sub.size()) == content.substr(len / 4, len / 2));
+
+            // 修改会复制出来，映射的页不会被写
+            copy.append("!");
+            CHECK(copy.size() == len + 1 && string(s.data(), s.size()) == content);
+            if (len > 0)
+            {
+                hstring edited(s);
+                edited[0] = '#';
+                CHECK(edited[0] == '#' && s[0] == content[0]);
+                edited.resize(len / 2);
+                CHECK(s.size() == len);
+            }
+        }
+        // 非原子引用计数的字符串也能映射
+        auto const local = local_hstring::mapFile(path.c_str());
+        CHECK(string(local.data(), local.size()) == content);
+        unlink(path.c_str());
+    }
+
+    {
+        auto const content = makeContent(100 * page);
+        auto const path = writeTemp(content);
+        hstring tail;
+        {
+            hstring whole(path.c_str(), MapReadOnlyFile());
+            CHECK(whole.isSlice());
+            tail = whole.substr(content.size() - 1000);
+        }
+        // 最后一个引用是切片，释放时munmap
+        CHECK(tail.size() == 1000 && tail[999] == content.back());
+        unlink(path.c_str());
+    }
+
+    bool thrown = false;
+    try
+    {
+        hstring::mapFile("/nonexistent/hmmap_test");
+    }
+    catch (const system_error &e)
+    {
+        thrown = e.code().value() == ENOENT;
+    }
+    CHECK(thrown);
+
+    cout << "mmap_test passed" << endl;
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "../hstring.h"
+#include "check.h"
+
+#include <atomic>
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace fool;
+
+// 数一下还没释放的块，缓存在线程里的引用还回去之后必须全部释放
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    std::atomic<long> live{0};
+
+private:
+    void *do_allocate(size_t bytes, size_t align) override
+    {
+        live.fetch_add(1);
+        return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+    void do_deallocate(void *p, size_t bytes, size_t align) override
+    {
+        live.fetch_sub(1);
+        std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+};
+
+struct CountingTag;
+typedef basic_hstring<char, basic_hstring_core<pmr_allocator<CountingTag>, deferred_refcount>> counted_hstring;
+
+int main()
+{
+    CountingResource resource;
+    pmr_allocator<CountingTag>::setResource(&resource);
+
+    // 只有自己缓存的引用时不算共享，可以原地修改
+    {
+        counted_hstring s(1000, 'a');
+        auto const p = as_const(s).data();
+        {
+            counted_hstring c1(s), c2(s), c3(s);
+            CHECK(s.isShared() && as_const(c3).data() == p);
+        }
+        CHECK(!s.isShared());
+        s[0] = 'b';
+        CHECK(as_const(s).data() == p && s[0] == 'b');
+
+        // 真的有别的拷贝时修改先复制
+        counted_hstring c(s), d(s);
+        s[1] = 'c';
+        CHECK(as_const(s).data() != p && as_const(c).data() == p && c[1] == 'a' && d == c);
+    }
+    deferred_refcount::flush();
+    CHECK(resource.live == 0);
+
+    // 所有字符串析构以后，线程缓存的引用还拖着内存，flush()时释放
+    {
+        counted_hstring s(2000, 'x');
+        vector<counted_hstring> copies(10, s);
+    }
+    CHECK(resource.live == 1);
+    deferred_refcount::flush();
+    CHECK(resource.live == 0);
+
+    // 很多个字符串轮流拷贝，表项互相挤掉时还回去的引用不能出错
+    {
+        vector<counted_hstring> originals;
+        for (size_t i = 0; i < 200; ++i)
+        {
+            originals.emplace_back(500 + i, char('a' + i % 26));
+        }
+        vector<counted_hstring> copies;
+        for (int round = 0; round < 3; ++round)
+        {
+            for (auto const &s : originals)
+            {
+                copies.push_back(s);
+                copies.push_back(s);
+            }
+        }
+        for (size_t i = 0; i < copies.size(); ++i)
+        {
+            CHECK(copies[i] == originals[(i / 2) % originals.size()]);
+        }
+        originals.clear();
+        copies.resize(copies.size() / 2);
+    }
+    deferred_refcount::flush();
+    CHECK(resource.live == 0);
+
+    // 多个线程拷贝、互相交换、修改同一个模板，线程退出时还回缓存的引用
+    {
+        const counted_hstring tmpl(4096, 't');
+        const unsigned kThreads = 8;
+        vector<vector<counted_hstring>> handoff(kThreads);
+        vector<thread> threads;
+        for (unsigned t = 0; t < kThreads; ++t)
+        {
+            threads.emplace_back([&, t] {
+                vector<counted_hstring> keep;
+                for (int i = 0; i < 20000; ++i)
+                {
+                    counted_hstring c(tmpl);
+                    if (i % 100 == 0)
+                    {
+                        keep.push_back(c);
+                    }
+                    if (i % 1000 == 0)
+                    {
+                        c[i % 4096] = 'm';
+                        CHECK(c[i % 4096] == 'm' && tmpl[i % 4096] == 't');
+                    }
+                }
+                for (auto const &c : keep)
+                {
+                    CHECK(c == tmpl);
+                }
+                handoff[t] = std::move(keep);
+            });
+        }
+        for (auto &th : threads)
+        {
+            th.join();
+        }
+        // 别的线程拷贝出来的字符串在这个线程析构
+        handoff.clear();
+        CHECK(tmpl == counted_hstring(4096, 't'));
+    }
+    deferred_refcount::flush();
+    CHECK(resource.live == 0);
+
+    pmr_allocator<CountingTag>::setResource(nullptr);
+    cout << "refcount_test passed" << endl;
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include "../hstring.h"
+#include "../hsearch.h"
+#include "check.h"
+
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace std;
+using namespace fool;
+
+// 用小字母表随机生成数据，保证有足够多的命中和部分匹配，每个级别的结果都要和std::string一致
+int main()
+{
+    mt19937 rng(12345);
+    const hsearch::Level levels[] = {hsearch::Level::Scalar, hsearch::Level::SSE2, hsearch::Level::AVX2};
+    for (auto lv : levels)
+    {
+        hsearch::setLevel(lv);
+        for (int round = 0; round < 3000; ++round)
+        {
+            size_t const n = rng() % 300;
+            size_t const m = rng() % 6;
+            string hay(n, 'a'), needle(m, 'a');
+            for (auto &c : hay)
+            {
+                c = char('a' + rng() % 3);
+            }
+            for (auto &c : needle)
+            {
+                c = char('a' + rng() % 3);
+            }
+            // 带上高位字节，检查半字节查表对0x80以上的字节也正确
+            if (round % 5 == 0 && n > 0)
+            {
+                hay[rng() % n] = char(0xE4);
+                needle += char(0xE4);
+            }
+            hstring hs(hay.data(), hay.size());
+            size_t const pos = rng() % (n + 2);
+            CHECK(hs.find(needle.data(), pos, needle.size()) == hay.find(needle, pos));
+            CHECK(hs.find(needle.data(), 0, needle.size()) == hay.find(needle));
+            CHECK(hs.rfind(needle.data(), pos, needle.size()) == hay.rfind(needle, pos));
+            CHECK(hs.rfind(needle.data(), hstring::npos, needle.size()) == hay.rfind(needle));
+            CHECK(hs.find_first_of(needle.data(), pos, needle.size()) == hay.find_first_of(needle, pos));
+            CHECK(hs.find_first_not_of(needle.data(), pos, needle.size()) == hay.find_first_not_of(needle, pos));
+            CHECK(hs.contains(string_view(needle)) == (hay.find(needle) != string::npos));
+        }
+    }
+    hstring h("GET /index.html HTTP/1.1\r\nHost: example.com\r\n");
+    CHECK(h.find("Host") == 26);
+    CHECK(h.rfind("\r\n") == h.size() - 2);
+    CHECK(h.find_first_of(":\r") == 24);
+    CHECK(h.find_first_not_of("GET ") == 4);
+    CHECK(h.find('/') == 4 && h.rfind('/') == 20);
+    cout << "search_test passed (best level " << hsearch::levelName(hsearch::bestLevel()) << ")" << endl;
+    return 0;
+}
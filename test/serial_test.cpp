@@ -0,0 +1,186 @@
+#include "../hserial.h"
+#include "check.h"
+
+#include <fcntl.h>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace fool;
+
+static string tempPath()
+{
+    char path[] = "/tmp/hserial_testXXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    close(fd);
+    return path;
+}
+
+static string makeContent(size_t len, char seed)
+{
+    string s(len, 'x');
+    for (size_t i = 0; i < len; ++i)
+    {
+        s[i] = char('a' + (i + size_t(seed)) % 26);
+    }
+    return s;
+}
+
+static void writeRaw(const string &path, const string &bytes)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_TRUNC);
+    CHECK(fd >= 0);
+    auto const written = write(fd, bytes.data(), bytes.size());
+    CHECK(written == ssize_t(bytes.size()));
+    close(fd);
+}
+
+static string readRaw(const string &path)
+{
+    auto const s = hstring::mapFile(path.c_str());
+    return string(s.data(), s.size());
+}
+
+static bool throwsInvalid(const string &path)
+{
+    try
+    {
+        hserial::load(path.c_str());
+    }
+    catch (const invalid_argument &)
+    {
+        return true;
+    }
+    return false;
+}
+
+int main()
+{
+    auto const path = tempPath();
+
+    // 各种长度的边界：空串、小字符串上限、中字符串上限、writev的分界
+    {
+        const size_t lens[] = {0, 1, 7, 8, 23, 24, 254, 255, 511, 512, 513, 5000, 100000};
+        vector<hstring> in;
+        for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); ++i)
+        {
+            auto const c = makeContent(lens[i], char(i));
+            in.emplace_back(c.data(), c.size());
+        }
+        auto const bytes = hserial::save(path.c_str(), in.begin(), in.end());
+        size_t expect = hserial::kHeaderSize + hserial::kFooterSize + in.size() * sizeof(uint64_t);
+        for (auto const &s : in)
+        {
+            expect += hserial::recordSize(s.size());
+        }
+        CHECK(bytes == expect && readRaw(path).size() == expect);
+
+        auto out = hserial::load(path.c_str());
+        CHECK(out == in);
+        for (auto const &s : out)
+        {
+            // inline_capacity以内的在对象里，长的是映射上的切片，内容后面的\0让c_str()不用复制
+            CHECK(s.isSlice() == (s.size() > hstring::inline_capacity));
+            CHECK(s.c_str() == as_const(s).data());
+        }
+
+        // 中间的子串后面不是\0，映射的页又是只读的，只能复制
+        hstring inner = out.back().substr(1, 1000);
+        out.clear();
+        CHECK(!inner.isSlice());
+        auto const p = as_const(inner).c_str();
+        CHECK(p[1000] == '\0' && string_view(p, 1000) == string_view(in.back()).substr(1, 1000));
+
+        // 修改加载出来的字符串时先复制，不影响其他共享映射的字符串
+        auto again = hserial::load(path.c_str());
+        auto copy = again[11];
+        again[11][0] = '!';
+        CHECK(again[11][0] == '!' && copy == in[11] && !again[11].isSlice());
+        again[12].append("tail");
+        CHECK(again[12].size() == in[12].size() + 4 && copy == in[11]);
+    }
+
+    // 空序列
+    {
+        vector<hstring> none;
+        CHECK(hserial::save(path.c_str(), none.begin(), none.end()) == hserial::kHeaderSize + hserial::kFooterSize);
+        CHECK(hserial::load(path.c_str()).empty());
+    }
+
+    // 很多个长字符串，iovec和缓冲区都要写满好几次；长字符串是临时对象，写出之前已经销毁
+    {
+        mt19937 rng(5);
+        vector<hstring> in;
+        for (size_t i = 0; i < 5000; ++i)
+        {
+            auto const len = rng() % 4 == 0 ? 512 + rng() % 3000 : rng() % 300;
+            auto const c = makeContent(len, char(i));
+            in.emplace_back(c.data(), c.size());
+        }
+        int fd = open(path.c_str(), O_WRONLY | O_TRUNC);
+        CHECK(fd >= 0);
+        hserial::Writer<> w(fd);
+        for (auto const &s : in)
+        {
+            w.add(hstring(s.data(), s.size()));
+        }
+        CHECK(w.count() == in.size());
+        w.finish();
+        close(fd);
+        CHECK(hserial::load(path.c_str()) == in);
+    }
+
+    // 加载出来的字符串比映射活得久：最后一个释放时才munmap
+    {
+        vector<hstring> in = {hstring(3000, 'q'), hstring("short")};
+        hserial::save(path.c_str(), in.begin(), in.end());
+        hstring keep;
+        {
+            keep = hserial::load(path.c_str())[0];
+        }
+        CHECK(keep == in[0]);
+    }
+
+    // 损坏的文件
+    {
+        vector<hstring> in = {hstring(300, 'a'), hstring(400, 'b')};
+        hserial::save(path.c_str(), in.begin(), in.end());
+        auto const good = readRaw(path);
+
+        writeRaw(path, good.substr(0, good.size() - 1));
+        CHECK(throwsInvalid(path));
+        writeRaw(path, "not a string sequence");
+        CHECK(throwsInvalid(path));
+
+        // 记录的长度越过了索引
+        auto bad = good;
+        uint64_t huge = 1 << 20;
+        memcpy(&bad[hserial::kHeaderSize], &huge, sizeof(huge));
+        writeRaw(path, bad);
+        CHECK(throwsInvalid(path));
+
+        // 索引里的偏移指到文件尾
+        bad = good;
+        auto const index = hserial::loadU64(good.data() + good.size() - 16);
+        uint64_t const past = good.size();
+        memcpy(&bad[index + sizeof(uint64_t)], &past, sizeof(past));
+        writeRaw(path, bad);
+        CHECK(throwsInvalid(path));
+
+        // 个数和索引的长度对不上
+        bad = good;
+        uint64_t const count = 3;
+        memcpy(&bad[good.size() - 24], &count, sizeof(count));
+        writeRaw(path, bad);
+        CHECK(throwsInvalid(path));
+    }
+
+    unlink(path.c_str());
+    cout << "serial_test passed" << endl;
+    return 0;
+}
@@ -0,0 +1,194 @@
+#include "../small_vector.h"
+#include "../hstring.h"
+#include "check.h"
+
+#include <iostream>
+#include <list>
+#include <malloc.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace fool;
+
+// 记录存活的对象个数，检查构造和析构是否成对
+struct Counted
+{
+    static int live;
+    int v;
+    Counted(int x = 0) : v(x) { ++live; }
+    Counted(const Counted &o) : v(o.v) { ++live; }
+    Counted(Counted &&o) noexcept : v(o.v) { ++live; }
+    Counted &operator=(const Counted &) = default;
+    Counted &operator=(Counted &&) = default;
+    ~Counted() { --live; }
+    bool operator==(const Counted &o) const { return v == o.v; }
+};
+int Counted::live = 0;
+
+// 第几次拷贝时抛出异常
+struct ThrowOnCopy
+{
+    static int copiesLeft;
+    int v;
+    ThrowOnCopy(int x = 0) : v(x) {}
+    ThrowOnCopy(const ThrowOnCopy &o) : v(o.v)
+    {
+        if (--copiesLeft < 0)
+        {
+            throw runtime_error("copy");
+        }
+    }
+    ThrowOnCopy(ThrowOnCopy &&o) noexcept : v(o.v) {}
+    ThrowOnCopy &operator=(const ThrowOnCopy &) = default;
+};
+int ThrowOnCopy::copiesLeft = 0;
+
+static size_t heapInUse()
+{
+    return mallinfo2().uordblks;
+}
+
+template <class SV, class V>
+static bool same(const SV &sv, const V &v)
+{
+    return sv.size() == v.size() && equal(sv.begin(), sv.end(), v.begin());
+}
+
+// 和std::vector做同样的操作，结果必须一致
+template <class T, size_t N, class Make>
+static void run(Make make)
+{
+    small_vector<T, N> sv;
+    vector<T> v;
+    CHECK(sv.isInline() && sv.capacity() == N && sv.empty());
+    for (int i = 0; i < 100; ++i)
+    {
+        sv.push_back(make(i));
+        v.push_back(make(i));
+        CHECK(same(sv, v));
+        CHECK(sv.isInline() == (sv.size() <= N));
+    }
+    // 参数引用自己的元素，扩容时不能失效
+    small_vector<T, N> self(N, make(7));
+    self.push_back(self[0]);
+    CHECK(self.size() == N + 1 && self.back() == make(7));
+
+    // 拷贝和移动，内部的和堆上的都要覆盖
+    for (size_t n : {size_t(0), N, N + 1, size_t(50)})
+    {
+        small_vector<T, N> a(v.begin(), v.begin() + n);
+        auto b(a);
+        CHECK(same(b, vector<T>(v.begin(), v.begin() + n)));
+        auto c(std::move(b));
+        CHECK(same(c, a) && b.empty());
+        small_vector<T, N> d(3, make(1));
+        d = a;
+        CHECK(d == a);
+        small_vector<T, N> e(60, make(2));
+        e = std::move(c);
+        CHECK(e == a && c.empty());
+        swap(e, sv);
+        CHECK(same(e, v) && sv == a);
+        swap(e, sv);
+    }
+
+    // insert/erase/resize
+    sv.insert(sv.begin() + 3, make(-1));
+    v.insert(v.begin() + 3, make(-1));
+    sv.insert(sv.end(), make(-2));
+    v.insert(v.end(), make(-2));
+    CHECK(same(sv, v));
+    sv.erase(sv.begin() + 1, sv.begin() + 10);
+    v.erase(v.begin() + 1, v.begin() + 10);
+    sv.erase(sv.begin());
+    v.erase(v.begin());
+    CHECK(same(sv, v));
+    sv.resize(2);
+    v.resize(2);
+    CHECK(same(sv, v));
+    sv.resize(N + 5, make(9));
+    v.resize(N + 5, make(9));
+    CHECK(same(sv, v));
+    sv.pop_back();
+    v.pop_back();
+    CHECK(same(sv, v));
+    sv.assign({make(1), make(2)});
+    CHECK(sv.size() == 2 && sv[1] == make(2));
+    sv.clear();
+    CHECK(sv.empty());
+}
+
+int main()
+{
+    run<int, 4>([](int i) { return i; });
+    run<Counted, 2>([](int i) { return Counted(i); });
+    run<hstring, 3>([](int i) { return hstring(size_t(i + 10) % 40, char('a' + (i + 10) % 26)); });
+    CHECK(Counted::live == 0);
+
+    // 小元素时对象只比std::vector多一个字
+    static_assert(sizeof(small_vector<int, 4>) == 3 * sizeof(size_t), "layout");
+    static_assert(sizeof(small_vector<char, 1>) == 3 * sizeof(size_t), "layout");
+
+    // 只能移动的元素
+    small_vector<unique_ptr<int>, 2> ptrs;
+    for (int i = 0; i < 10; ++i)
+    {
+        ptrs.emplace_back(new int(i));
+    }
+    ptrs.erase(ptrs.begin());
+    CHECK(ptrs.size() == 9 && *ptrs.front() == 1 && *ptrs.back() == 9);
+    auto moved = std::move(ptrs);
+    CHECK(moved.size() == 9 && ptrs.empty());
+
+    // 输入迭代器
+    list<int> l = {1, 2, 3, 4, 5, 6};
+    small_vector<int, 4> fromList(l.begin(), l.end());
+    CHECK(fromList.size() == 6 && !fromList.isInline() && fromList[5] == 6);
+    CHECK(fromList.capacity() * sizeof(int) <= goodMallocSize(fromList.capacity() * sizeof(int)));
+
+    bool thrown = false;
+    try
+    {
+        fromList.at(6);
+    }
+    catch (const out_of_range &)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    // 拷贝构造到一半抛出异常，已经分配的堆空间要释放掉
+    {
+        small_vector<ThrowOnCopy, 2> src;
+        for (int i = 0; i < 100; ++i)
+        {
+            src.emplace_back(i);
+        }
+        // 第一次抛异常时运行库会分配一些以后一直留着的空间，跳过这一轮再比较
+        size_t before = 0;
+        for (int copies : {99, 0, 50, 99})
+        {
+            ThrowOnCopy::copiesLeft = copies;
+            bool threw = false;
+            try
+            {
+                small_vector<ThrowOnCopy, 2> copy(src);
+            }
+            catch (const runtime_error &)
+            {
+                threw = true;
+            }
+            CHECK(threw && (before == 0 || heapInUse() == before));
+            before = heapInUse();
+        }
+        ThrowOnCopy::copiesLeft = 100;
+        small_vector<ThrowOnCopy, 2> copy(src);
+        CHECK(copy.size() == 100 && copy.back().v == 99);
+    }
+
+    cout << "small_vector test passed" << endl;
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "../hstring.h"
+#include "../hstats.h"
+#include "check.h"
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+
+using namespace std;
+using namespace fool;
+using hstats::Event;
+
+static_assert(hstats::kEnabled, "stats_test必须定义FOOL_HSTRING_STATS");
+
+int main()
+{
+    hstats::reset();
+
+    // 构造时按类型记录长度
+    {
+        hstring a("abc");
+        hstring b(string(100, 'm'));
+        hstring c(string(1000, 'l'));
+    }
+    auto s = hstats::snapshot();
+    auto const sizeOf = [&](hstats::Category c, size_t bucket) { return s.sizes[size_t(c)][bucket]; };
+    CHECK(sizeOf(hstats::Category::Small, 2) == 1);
+    CHECK(sizeOf(hstats::Category::Medium, 7) == 1);
+    CHECK(sizeOf(hstats::Category::Large, 10) == 1);
+    CHECK(s[Event::Allocate] == 2 && s[Event::Free] == 2);
+
+    // 类型转换
+    hstats::reset();
+    {
+        hstring small("abc");
+        small.reserve(100);
+        hstring small2("abc");
+        small2.reserve(1000);
+        hstring medium(string(100, 'm'));
+        medium.reserve(1000);
+        CHECK(medium.size() == 100);
+    }
+    s = hstats::snapshot();
+    CHECK(s[Event::SmallToMedium] == 1 && s[Event::SmallToLarge] == 1 && s[Event::MediumToLarge] == 1);
+    CHECK(s[Event::Allocate] == s[Event::Free]);
+
+    // 写时复制和中字符串的深拷贝
+    hstats::reset();
+    {
+        hstring large(string(1000, 'l'));
+        hstring copy(large);
+        copy[0] = 'L';
+        hstring medium(string(100, 'm'));
+        hstring mcopy(medium);
+        auto const sub = large.substr(10);
+        CHECK(sub.isSlice());
+    }
+    s = hstats::snapshot();
+    CHECK(s[Event::Unshare] == 1 && s[Event::UnshareBytesCopied] == 1000);
+    CHECK(s[Event::MediumCopy] == 1 && s[Event::MediumBytesCopied] == 100);
+    CHECK(s[Event::Slice] == 1);
+
+    // 扩容
+    hstats::reset();
+    {
+        hstring m(string(40, 'm'));
+        for (int i = 0; i < 200; ++i)
+        {
+            m.push_back('x');
+        }
+    }
+    s = hstats::snapshot();
+    CHECK(s[Event::Reallocate] > 0);
+
+    // 往共享的大字符串后面追加：脱离共享时直接按新的长度分配，只拷贝一次
+    {
+        hstring large(string(1000, 'l'));
+        hstring copy(large);
+        hstats::reset();
+        copy.append(string(38, 'a').c_str(), 38);
+        s = hstats::snapshot();
+        CHECK(copy.size() == 1038 && large.size() == 1000);
+    }
+    CHECK(s[Event::Unshare] == 1 && s[Event::Reallocate] == 0 && s[Event::Allocate] == 1);
+
+    // 退出的线程的计数不会丢
+    hstats::reset();
+    thread t([] {
+        for (int i = 0; i < 10; ++i)
+        {
+            hstring m(string(100, 'm'));
+            hstring copy(m);
+        }
+    });
+    t.join();
+    s = hstats::snapshot();
+    CHECK(s[Event::MediumCopy] == 10);
+
+    auto const text = hstats::toText(s);
+    CHECK(text.find("medium_copy 10") != string::npos);
+    auto const json = hstats::toJson(s);
+    CHECK(json.front() == '{' && json.back() == '}');
+    CHECK(json.find("\"medium_copy\":10") != string::npos);
+
+    hstats::reset();
+    s = hstats::snapshot();
+    CHECK(s[Event::MediumCopy] == 0);
+
+    cout << text;
+    cout << "stats test passed" << endl;
+    return 0;
+}
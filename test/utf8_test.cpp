@@ -0,0 +1,280 @@
+#include "../hutf8.h"
+#include "check.h"
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace fool;
+
+// 另一种写法的参考实现：按首字节定长度，解出码点后再检查范围
+static bool refValid(const string &s)
+{
+    size_t i = 0;
+    while (i < s.size())
+    {
+        auto const c = static_cast<unsigned char>(s[i]);
+        size_t len;
+        char32_t cp, minCp;
+        if (c < 0x80)
+        {
+            len = 1, cp = c, minCp = 0;
+        }
+        else if ((c & 0xE0) == 0xC0)
+        {
+            len = 2, cp = c & 0x1F, minCp = 0x80;
+        }
+        else if ((c & 0xF0) == 0xE0)
+        {
+            len = 3, cp = c & 0x0F, minCp = 0x800;
+        }
+        else if ((c & 0xF8) == 0xF0)
+        {
+            len = 4, cp = c & 0x07, minCp = 0x10000;
+        }
+        else
+        {
+            return false;
+        }
+        if (i + len > s.size())
+        {
+            return false;
+        }
+        for (size_t k = 1; k < len; ++k)
+        {
+            auto const d = static_cast<unsigned char>(s[i + k]);
+            if ((d & 0xC0) != 0x80)
+            {
+                return false;
+            }
+            cp = cp << 6 | (d & 0x3F);
+        }
+        if (cp < minCp || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+        {
+            return false;
+        }
+        i += len;
+    }
+    return true;
+}
+
+static void append8(string &s, char32_t cp)
+{
+    if (cp < 0x80)
+    {
+        s += char(cp);
+    }
+    else if (cp < 0x800)
+    {
+        s += char(0xC0 | (cp >> 6));
+        s += char(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+        s += char(0xE0 | (cp >> 12));
+        s += char(0x80 | ((cp >> 6) & 0x3F));
+        s += char(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+        s += char(0xF0 | (cp >> 18));
+        s += char(0x80 | ((cp >> 12) & 0x3F));
+        s += char(0x80 | ((cp >> 6) & 0x3F));
+        s += char(0x80 | (cp & 0x3F));
+    }
+}
+
+static void append16(u16string &s, char32_t cp)
+{
+    if (cp < 0x10000)
+    {
+        s += char16_t(cp);
+    }
+    else
+    {
+        s += char16_t(0xD800 + ((cp - 0x10000) >> 10));
+        s += char16_t(0xDC00 + ((cp - 0x10000) & 0x3FF));
+    }
+}
+
+// 大部分是ASCII，夹杂各种长度的码点，ASCII的连续段有长有短，覆盖向量实现的快慢两条路
+static char32_t randomCodePoint(mt19937 &rng)
+{
+    switch (rng() % 8)
+    {
+    case 0:
+        return 0x80 + rng() % (0x800 - 0x80);
+    case 1:
+    {
+        char32_t cp;
+        do
+        {
+            cp = 0x800 + rng() % (0x10000 - 0x800);
+        } while (cp >= 0xD800 && cp <= 0xDFFF);
+        return cp;
+    }
+    case 2:
+        return 0x10000 + rng() % (0x110000 - 0x10000);
+    default:
+        return rng() % 0x80;
+    }
+}
+
+static void checkLevel(hsearch::Level lv)
+{
+    hutf8::setLevel(lv);
+    mt19937 rng(2024);
+
+    // 合法的文本：长度、码点数和两个方向的转换
+    for (int round = 0; round < 2000; ++round)
+    {
+        string s8;
+        u16string s16;
+        size_t const n = rng() % 200;
+        for (size_t i = 0; i < n; ++i)
+        {
+            auto const cp = rng() % 3 == 0 ? randomCodePoint(rng) : char32_t('a' + rng() % 26);
+            append8(s8, cp);
+            append16(s16, cp);
+        }
+        CHECK(utf8_validate(s8));
+        CHECK(utf8_length(s8) == n);
+        CHECK(hutf8::utf16Length(s8.data(), s8.size()) == s16.size());
+        CHECK(utf8_to_utf16(s8) == s16);
+        CHECK(hutf8::utf8Length(s16.data(), s16.size()) == s8.size());
+        auto const back = utf16_to_utf8(s16);
+        CHECK(string_view(back) == s8);
+        // 追加到已有的内容后面
+        hstring prefix("prefix:");
+        append_utf8(prefix, s16);
+        CHECK(string_view(prefix) == "prefix:" + s8);
+    }
+
+    // 随机破坏合法的文本，结果要和参考实现一致
+    for (int round = 0; round < 20000; ++round)
+    {
+        string s;
+        size_t const n = rng() % 100;
+        for (size_t i = 0; i < n; ++i)
+        {
+            append8(s, randomCodePoint(rng));
+        }
+        if (!s.empty())
+        {
+            for (int k = rng() % 3; k >= 0; --k)
+            {
+                s[rng() % s.size()] = char(rng());
+            }
+            if (rng() % 4 == 0)
+            {
+                s.resize(rng() % s.size());
+            }
+        }
+        auto const expect = refValid(s);
+        CHECK(utf8_validate(s) == expect);
+        if (!expect)
+        {
+            u16string out(u"kept");
+            bool threw = false;
+            try
+            {
+                append_utf16(out, s);
+            }
+            catch (const invalid_argument &)
+            {
+                threw = true;
+            }
+            CHECK(threw && out == u"kept");
+        }
+    }
+
+    // 每个两字节组合放在块内、跨块和末尾的各个位置
+    string pad(70, 'x');
+    for (unsigned a = 0x80; a < 0x100; ++a)
+    {
+        for (unsigned b = 0; b < 0x100; ++b)
+        {
+            string s;
+            s += char(a);
+            s += char(b);
+            auto const expect = refValid(s);
+            CHECK(utf8_validate(s) == expect);
+            for (size_t off : {13u, 15u, 30u, 31u, 47u, 62u, 63u, 68u})
+            {
+                auto t = pad;
+                t[off] = char(a);
+                t[off + 1] = char(b);
+                CHECK(utf8_validate(t) == expect);
+            }
+        }
+    }
+
+    // 典型的错误
+    const char *const bad[] = {
+        "\x80", "\xBF", "\xC0\x80", "\xC1\xBF", "\xE0\x80\x80", "\xE0\x9F\xBF", "\xED\xA0\x80", "\xED\xBF\xBF",
+        "\xF0\x80\x80\x80", "\xF0\x8F\xBF\xBF", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xFF", "\xFE",
+        "\xC3", "\xE4\xB8", "\xF0\x9F\x98", "\xE4\xB8\xAD\xAD", "\xF0\x9F\x98\x80\x80"};
+    for (auto b : bad)
+    {
+        for (size_t off = 0; off < 70; ++off)
+        {
+            auto s = pad;
+            s.insert(off, b);
+            CHECK(!utf8_validate(s));
+            // 放在最后，被截断的序列只能靠末尾的检查发现
+            CHECK(!utf8_validate(string(off, 'y') + b));
+        }
+    }
+    const char *const good[] = {"\xC2\x80", "\xDF\xBF", "\xE0\xA0\x80", "\xED\x9F\xBF", "\xEE\x80\x80", "\xEF\xBF\xBF",
+                                "\xF0\x90\x80\x80", "\xF4\x8F\xBF\xBF", "\xE4\xB8\xAD"};
+    for (auto g : good)
+    {
+        for (size_t off = 0; off < 70; ++off)
+        {
+            auto s = pad;
+            s.insert(off, g);
+            CHECK(utf8_validate(s));
+            CHECK(utf8_validate(string(off, 'y') + g));
+        }
+    }
+
+    // 落单的代理
+    for (size_t off = 0; off < 40; ++off)
+    {
+        for (char16_t bad16 : {char16_t(0xD800), char16_t(0xDBFF), char16_t(0xDC00), char16_t(0xDFFF)})
+        {
+            u16string s(40, u'z');
+            s.insert(s.begin() + off, bad16);
+            hstring out("kept");
+            bool threw = false;
+            try
+            {
+                append_utf8(out, s);
+            }
+            catch (const invalid_argument &)
+            {
+                threw = true;
+            }
+            CHECK(threw && out == "kept");
+        }
+        // 高代理在最后
+        u16string s(off, u'z');
+        s += char16_t(0xD83D);
+        CHECK(hutf8::toUtf8(s.data(), s.size(), &string(s.size() * 3, '\0')[0]) == hutf8::npos);
+    }
+}
+
+int main()
+{
+    const hsearch::Level levels[] = {hsearch::Level::Scalar, hsearch::Level::SSE2, hsearch::Level::AVX2};
+    for (auto lv : levels)
+    {
+        checkLevel(lv);
+    }
+    CHECK(utf8_length("h\xC3\xA9llo \xE4\xB8\xAD\xE6\x96\x87 \xF0\x9F\x98\x80") == 10);
+    CHECK(utf8_to_utf16("\xF0\x9F\x98\x80") == u"\U0001F600");
+    cout << "utf8_test passed (best level " << hsearch::levelName(hsearch::bestLevel()) << ")" << endl;
+    return 0;
+}